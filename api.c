@@ -1,10 +1,28 @@
 #include <stdint.h>
+#include <stddef.h>
 
 #include "inc/gpio.h"
 #include "inc/rcc.h"
 #include "api.h"
 #include "button.h"
 #include "screen.h"
+#include "kvstore.h"
+#include "clock.h"
+#include "power.h"
+#include "log.h"
+#include "serial.h"
+#include "link.h"
+#include "sound.h"
+#include "assets.h"
+#include "memstat.h"
+#include "memmap.h"
+#include "memops.h"
+#include "common/memops.h"
+#include "divops.h"
+#include "common/divops.h"
+#include "frame.h"
+#include "tick.h"
+#include "probe.h"
 
 //=========================================================
 
@@ -37,8 +55,43 @@ const struct API API_host =
     .scrn_yline = scrn_yline,
     .scrn_box = scrn_box,
     .scrn_puts = scrn_puts,
+    .kv_read = kv_read,
+    .kv_write = kv_write,
+    .kv_erase = kv_erase,
+    .set_perf_level = clock_set_level,
+    .idle = power_idle,
+    .log_write = log_write,
+    .serial_write = serial_write,
+    .serial_read = serial_read,
+    .link_start = link_start,
+    .link_step = link_step,
+    .sound_play = sound_play,
+    .sound_stop = sound_stop,
+    .asset_size = asset_size,
+    .asset_map = asset_map,
+    .asset_read = asset_read,
+    .mem_usage = memstat_usage,
+    .mem_map = memmap_get,
+    .mem_copy = mem_copy,
+    .mem_fill = mem_fill,
+    .mem_move = mem_move,
+    .div_u32 = div_u32,
+    .div_s32 = div_s32,
+    .frame_run = frame_run,
+    .scrn_select = scrn_select,
+    .scrn_draw_all = scrn_draw_all,
+    .probe_now = probe_now,
+    .probe_add = probe_guest_add,
+    .probe_take = probe_take,
 };
 
+// user.S jumps through these
+_Static_assert(offsetof(struct API, mem_copy) == API_MEM_COPY_OFFS, "API_MEM_COPY_OFFS is stale");
+_Static_assert(offsetof(struct API, mem_fill) == API_MEM_FILL_OFFS, "API_MEM_FILL_OFFS is stale");
+_Static_assert(offsetof(struct API, mem_move) == API_MEM_MOVE_OFFS, "API_MEM_MOVE_OFFS is stale");
+_Static_assert(offsetof(struct API, div_u32) == API_DIV_U32_OFFS, "API_DIV_U32_OFFS is stale");
+_Static_assert(offsetof(struct API, div_s32) == API_DIV_S32_OFFS, "API_DIV_S32_OFFS is stale");
+
 __attribute__ ((section (".api"))) 
 static struct Button buttons[BUTTONS_NUM] = { 0 };
 
@@ -63,6 +116,13 @@ int api_init(void)
         if (err < 0) return err;
     }
 
+    power_init();
+    sound_init();
+    probe_init();
+
+    int err = kv_init();
+    if (err < 0) return err;
+
     SPI_init(BAUD_DIV128);
     scrn_init(0);
 
@@ -75,11 +135,18 @@ void api_update(unsigned handler_ticks)
 {
     (void) handler_ticks;
 
+    bool settling = false;
+
     for (unsigned iter = 0; iter < BUTTONS_NUM; iter++)
     {
-        button_update(&(buttons[iter]));
+        if (button_update(&(buttons[iter])) > 0)
+            settling = true;
     }
 
+    // Sampled every tick until lines are steady, an edge starts it again (see power.c)
+    if (settling == true)
+        tick_request(1U);
+
     // static bool led_is_on = false;
 
     // if ((handler_ticks % SYSTICK_FREQ) == 0)
@@ -99,6 +166,21 @@ void api_update(unsigned handler_ticks)
 
 //---------------------------------------------------------
 
+unsigned api_buttons(void)
+{
+    unsigned mask = 0U;
+
+    for (unsigned iter = 0; iter < BUTTONS_NUM; iter++)
+    {
+        if (button_is_pressed(&(buttons[iter])) == true)
+            mask |= 1U << iter;
+    }
+
+    return mask;
+}
+
+//---------------------------------------------------------
+
 int is_button_pressed(unsigned num)
 {
     if (num >= BUTTONS_NUM)
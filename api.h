@@ -10,4 +10,7 @@ void blue_led_on (void);
 void green_led_on(void);
 
 void blue_led_off (void);
-void green_led_off(void);
\ No newline at end of file
+void green_led_off(void);
+
+// Bit n is set while button n is pressed
+unsigned api_buttons(void);
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "flash.h"
+#include "fwup.h"
+#include "log.h"
+#include "memops.h"
+#include "assets.h"
+
+//=========================================================
+
+// Symbols from entry.lds
+extern uint8_t __assets_start[];
+extern uint8_t __assets_size[];
+
+#define ASSETS_START ((uint32_t) __assets_start)
+#define ASSETS_SIZE  ((uint32_t) __assets_size)
+
+#define LZSS_MIN_LEN 3U
+
+//=========================================================
+
+static const struct Asset_pack* assets_pack(void)
+{
+    const struct Asset_pack* pack = (const struct Asset_pack*) __assets_start;
+
+    if (pack->magic != ASSETS_MAGIC || pack->size > ASSETS_SIZE)
+        return NULL;
+
+    if (sizeof(*pack) + pack->count * sizeof(struct Asset_entry) > pack->size)
+        return NULL;
+
+    return pack;
+}
+
+//---------------------------------------------------------
+
+static const struct Asset_entry* assets_find(const struct Asset_pack* pack, uint32_t id)
+{
+    const struct Asset_entry* entries = (const struct Asset_entry*) (pack + 1);
+    unsigned low = 0U, high = pack->count;
+
+    while (low < high)
+    {
+        unsigned mid = (low + high) / 2U;
+
+        if (entries[mid].id == id)
+            return &entries[mid];
+
+        if (entries[mid].id < id)
+            low = mid + 1U;
+        else
+            high = mid;
+    }
+
+    return NULL;
+}
+
+//---------------------------------------------------------
+
+// Entry of id with its blob inside the pack
+static const struct Asset_entry* assets_lookup(unsigned id, const uint8_t** blob)
+{
+    const struct Asset_pack* pack = assets_pack();
+    if (pack == NULL)
+        return NULL;
+
+    const struct Asset_entry* entry = assets_find(pack, id);
+    if (entry == NULL || (uint32_t) entry->offset + entry->size > pack->size)
+        return NULL;
+
+    *blob = (const uint8_t*) pack + entry->offset;
+    return entry;
+}
+
+//=========================================================
+
+int assets_receive(struct Uart* uart)
+{
+    int size = fwup_receive_pages(uart, ASSETS_START, ASSETS_SIZE);
+
+    const struct Asset_pack* pack = assets_pack();
+
+    if (size >= 0 && (pack == NULL || pack->size > (uint32_t) size))
+        size = ASSET_CORRUPT;
+
+    if (size < 0)
+    {
+        // Pack header goes first: without it nothing else is looked at
+        flash_unlock();
+        flash_page_erase(ASSETS_START);
+        flash_lock();
+
+        return size;
+    }
+
+    LOG("assets: %u asset(s), %u bytes", pack->count, pack->size);
+    return 0;
+}
+
+//---------------------------------------------------------
+
+int asset_size(unsigned id)
+{
+    const uint8_t* blob = NULL;
+    const struct Asset_entry* entry = assets_lookup(id, &blob);
+
+    return (entry == NULL)? ASSET_NOT_FOUND : entry->raw_size;
+}
+
+//---------------------------------------------------------
+
+const void* asset_map(unsigned id)
+{
+    const uint8_t* blob = NULL;
+    const struct Asset_entry* entry = assets_lookup(id, &blob);
+
+    if (entry == NULL || entry->codec != ASSET_CODEC_STORED)
+        return NULL;
+
+    return blob;
+}
+
+//---------------------------------------------------------
+
+// Output is its own window, unpacking stops once size bytes are out
+static int lzss_unpack(const uint8_t* src, unsigned src_size, uint8_t* dst, unsigned size)
+{
+    unsigned in = 0U, out = 0U;
+    unsigned flags = 0U;
+
+    while (out < size && in < src_size)
+    {
+        flags >>= 1;
+
+        if ((flags & 0x100U) == 0U)
+        {
+            flags = src[in++] | 0xFF00U;
+            if (in == src_size)
+                break;
+        }
+
+        if ((flags & 1U) != 0U)
+        {
+            dst[out++] = src[in++];
+            continue;
+        }
+
+        if (in + 2U > src_size)
+            return ASSET_CORRUPT;
+
+        unsigned dist = ((unsigned) (src[in + 1U] >> 4) << 8 | src[in]) + 1U;
+        unsigned len = (src[in + 1U] & 0x0FU) + LZSS_MIN_LEN;
+        in += 2U;
+
+        if (dist > out)
+            return ASSET_CORRUPT;
+
+        for (; len != 0U && out < size; len--, out++)
+            dst[out] = dst[out - dist];
+    }
+
+    return (int) out;
+}
+
+//---------------------------------------------------------
+
+int asset_read(unsigned id, void* buf, unsigned size)
+{
+    if (buf == NULL)
+        return ASSET_INV_ARG;
+
+    const uint8_t* blob = NULL;
+    const struct Asset_entry* entry = assets_lookup(id, &blob);
+    if (entry == NULL)
+        return ASSET_NOT_FOUND;
+
+    if (size > entry->raw_size)
+        size = entry->raw_size;
+
+    switch (entry->codec)
+    {
+        case ASSET_CODEC_STORED:
+            mem_copy(buf, blob, size);
+            return (int) size;
+
+        case ASSET_CODEC_LZSS:
+            return lzss_unpack(blob, entry->size, buf, size);
+
+        default:
+            return ASSET_CORRUPT;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+#include "common/assets.h"
+#include "uart.h"
+
+//=========================================================
+
+/*
+    Asset pack upload and lookup (format in common/assets.h).
+
+        [ASSETS_MAGIC][pack size][pack ... padded to word][crc32 of pack]
+
+    Pack goes page by page straight into its flash area the same way
+    as firmware update (see fwup.h). Upload that fails its CRC or pack
+    checks erases the area, so a half-written pack is never served.
+*/
+
+//=========================================================
+
+// Receive pack after ASSETS_MAGIC word
+int assets_receive(struct Uart* uart);
+
+// Unpacked size of asset
+int asset_size(unsigned id);
+
+// Asset data in flash, NULL if it is compressed or missing
+const void* asset_map(unsigned id);
+
+// Unpack up to size bytes of asset into buf, returns bytes written
+int asset_read(unsigned id, void* buf, unsigned size);
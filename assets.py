@@ -0,0 +1,224 @@
+#!/usr/bin/python3
+
+#=========================================================
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+#=========================================================
+
+# Asset pack builder, pack format is described in common/assets.h
+#
+#   ./assets.py [-o pack.bin] [-H assets_ids.h] [--stored] file [name=file ...]
+#
+# Asset name is the file name without extension unless given as
+# name=file. Every blob is LZSS compressed when that makes it smaller,
+# --stored keeps them all as is so guests can use asset_map on them.
+
+ASSETS_MAGIC = 0x54455341 # "ASET"
+
+ASSET_FNV_BASIS = 0x811C9DC5
+ASSET_FNV_PRIME = 0x01000193
+
+ASSET_CODEC_STORED = 0
+ASSET_CODEC_LZSS   = 1
+
+PACK_HEADER  = '<IHHI'
+ENTRY_FORMAT = '<IHHHBB'
+
+# Flash between staging slot and key-value pages, see entry.lds
+PACK_MAX_SIZE = 0x10000 - 0x400 - 2 * 0x6800 - 0x800
+
+LZSS_MIN_LEN = 3
+LZSS_MAX_LEN = LZSS_MIN_LEN + 0x0F
+LZSS_WINDOW  = 0x1000
+
+#=========================================================
+
+def asset_id(name):
+    value = ASSET_FNV_BASIS
+
+    for byte in name.encode():
+        value = ((value ^ byte) * ASSET_FNV_PRIME) & 0xFFFFFFFF
+
+    return value
+
+#---------------------------------------------------------
+
+def lzss_pack(data):
+    out = bytearray()
+    pos = 0
+
+    # Positions of every 3-byte prefix seen so far, newest last
+    chains = {}
+
+    while pos < len(data):
+        flags_at = len(out)
+        out.append(0)
+
+        for bit in range(8):
+            if pos >= len(data):
+                break
+
+            best_len, best_dist = 0, 0
+
+            for start in reversed(chains.get(data[pos:pos + LZSS_MIN_LEN], [])):
+                if pos - start > LZSS_WINDOW:
+                    break
+
+                length = 0
+                while (length < LZSS_MAX_LEN and pos + length < len(data) and
+                       data[start + length] == data[pos + length]):
+                    length += 1
+
+                if length > best_len:
+                    best_len, best_dist = length, pos - start
+                    if length == LZSS_MAX_LEN:
+                        break
+
+            if best_len >= LZSS_MIN_LEN:
+                dist = best_dist - 1
+                out += bytes([dist & 0xFF, (dist >> 8) << 4 | (best_len - LZSS_MIN_LEN)])
+                step = best_len
+            else:
+                out[flags_at] |= 1 << bit
+                out.append(data[pos])
+                step = 1
+
+            for ind in range(pos, pos + step):
+                chains.setdefault(data[ind:ind + LZSS_MIN_LEN], []).append(ind)
+
+            pos += step
+
+    return bytes(out)
+
+#---------------------------------------------------------
+
+def lzss_unpack(data, size):
+    out = bytearray()
+    pos = 0
+
+    while len(out) < size:
+        flags = data[pos]
+        pos += 1
+
+        for bit in range(8):
+            if len(out) >= size:
+                break
+
+            if flags & (1 << bit):
+                out.append(data[pos])
+                pos += 1
+                continue
+
+            dist = (data[pos + 1] >> 4 << 8 | data[pos]) + 1
+            length = (data[pos + 1] & 0x0F) + LZSS_MIN_LEN
+            pos += 2
+
+            for _ in range(length):
+                out.append(out[-dist])
+
+    return bytes(out[:size])
+
+#=========================================================
+
+def build_pack(assets, stored):
+    entries = []
+
+    for name, data in assets:
+        if len(data) > 0xFFFF:
+            raise ValueError("asset '%s' is %d bytes, 65535 at most" % (name, len(data)))
+
+        codec, blob = ASSET_CODEC_STORED, data
+
+        if not stored:
+            packed = lzss_pack(data)
+            assert lzss_unpack(packed, len(data)) == data
+
+            if len(packed) < len(data):
+                codec, blob = ASSET_CODEC_LZSS, packed
+
+        entries.append((asset_id(name), name, codec, blob, len(data)))
+
+    entries.sort()
+
+    for prev, cur in zip(entries, entries[1:]):
+        if prev[0] == cur[0]:
+            raise ValueError("assets '%s' and '%s' have the same id" % (prev[1], cur[1]))
+
+    offset = struct.calcsize(PACK_HEADER) + len(entries) * struct.calcsize(ENTRY_FORMAT)
+    table = b''
+    blobs = b''
+
+    for ident, name, codec, blob, raw_size in entries:
+        # Stored blobs may hold words and halfwords read in place
+        pad = -(offset + len(blobs)) % 4
+        blobs += b'\0' * pad
+
+        table += struct.pack(ENTRY_FORMAT, ident, offset + len(blobs), len(blob), raw_size, codec, 0)
+        blobs += blob
+
+    blobs += b'\0' * (-(offset + len(blobs)) % 4)
+
+    size = offset + len(blobs)
+    if size > PACK_MAX_SIZE:
+        raise ValueError("pack is %d bytes, %d at most" % (size, PACK_MAX_SIZE))
+
+    return struct.pack(PACK_HEADER, ASSETS_MAGIC, len(entries), 0, size) + table + blobs, entries
+
+#---------------------------------------------------------
+
+def write_header(path, entries):
+    with open(path, 'w') as header:
+        header.write("#pragma once\n\n// Generated by assets.py, ids for asset_size / asset_map / asset_read\n\n")
+
+        for ident, name, codec, blob, raw_size in sorted(entries, key=lambda entry: entry[1]):
+            macro = 'ASSET_' + re.sub(r'\W', '_', name).upper()
+            header.write("#define %-24s 0x%08XU\n" % (macro, ident))
+
+#=========================================================
+
+def main():
+    parser = argparse.ArgumentParser(description="Build asset pack (see common/assets.h)")
+    parser.add_argument('files', nargs='+', metavar='[name=]file')
+    parser.add_argument('-o', '--output', default='build/assets.bin')
+    parser.add_argument('-H', '--header', help="write asset ids as C defines")
+    parser.add_argument('--stored', action='store_true', help="do not compress, all assets can be mapped")
+    args = parser.parse_args()
+
+    assets = []
+
+    for arg in args.files:
+        name, sep, path = arg.partition('=')
+        if not sep:
+            path = arg
+            name = os.path.splitext(os.path.basename(arg))[0]
+
+        with open(path, 'rb') as source:
+            assets.append((name, source.read()))
+
+    try:
+        pack, entries = build_pack(assets, args.stored)
+    except ValueError as err:
+        print("assets: %s" % err)
+        sys.exit(1)
+
+    with open(args.output, 'wb') as output:
+        output.write(pack)
+
+    if args.header:
+        write_header(args.header, entries)
+
+    for ident, name, codec, blob, raw_size in entries:
+        print("  0x%08X %-16s %5d -> %5d%s" % (ident, name, raw_size, len(blob),
+                                              " lzss" if codec == ASSET_CODEC_LZSS else ""))
+
+    print("%s: %d asset(s), %d bytes" % (args.output, len(entries), len(pack)))
+
+#---------------------------------------------------------
+
+if __name__ == '__main__':
+    main()
@@ -5,6 +5,7 @@
 
 #include "inc/gpio.h"
 #include "inc/rcc.h"
+#include "probe.h"
 #include "button.h"
 
 //=========================================================
@@ -62,6 +63,8 @@ int button_update(struct Button* button)
     if (button == NULL)
         return BTN_INV_PTR;
 
+    PROBE_BEGIN(PROBE_BUTTON_UPDATE);
+
     bool active = (bool) GPIO_IDR_GET_PIN(button->GPIOx, button->pin);
 
     if (active == true)
@@ -81,5 +84,10 @@ int button_update(struct Button* button)
             button->is_pressed = false;
     }
 
-    return 0;
+    // Counter rests at either end once the input is steady
+    int settling = (active == true)? (button->saturation < Saturation_max)
+                                   : (button->saturation > 0U);
+
+    PROBE_END(PROBE_BUTTON_UPDATE);
+    return settling;
 }
\ No newline at end of file
@@ -29,7 +29,7 @@ enum Button_error
 // Setup button on GPIOx:pin
 int button_setup(struct Button* button, uint32_t GPIOx, uint8_t pin);
 
-// Read from input and update state of button
+// Read from input and update state of button, 1 while it is still settling
 int button_update(struct Button* button);
 
 static inline bool button_is_pressed(struct Button* button)
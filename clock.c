@@ -0,0 +1,185 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "inc/rcc.h"
+#include "inc/flash.h"
+#include "inc/arm.h"
+#include "inc/spi.h"
+#include "uart.h"
+#include "sound.h"
+#include "tick.h"
+#include "clock.h"
+
+//=========================================================
+
+#define HSE_FREQUENCY 8000000U
+#define HSE_PREDIV    2U
+
+// Max SYSCLK with zero flash wait states
+#define FLASH_0WS_MAX_FREQUENCY 24000000U
+
+//---------------------------------------------------------
+
+struct Clock_level_conf
+{
+    uint32_t frequency;
+    uint8_t pllmul; // 0 - PLL is not used, SYSCLK = HSE
+};
+
+static const struct Clock_level_conf Levels[CLOCK_LEVELS_NUM] =
+{
+    [CLOCK_LEVEL_LOW]  = { .frequency =  8000000U, .pllmul = 0U  },
+    [CLOCK_LEVEL_MED]  = { .frequency = 24000000U, .pllmul = 6U  },
+    [CLOCK_LEVEL_HIGH] = { .frequency = 48000000U, .pllmul = 12U },
+};
+
+struct Clock_state
+{
+    uint8_t level;
+};
+
+__attribute__ ((section (".api")))
+static struct Clock_state Clock = { .level = CLOCK_LEVEL_LOW };
+
+//---------------------------------------------------------
+
+static void clock_switch_sysclk(uint32_t sw);
+static void clock_tree_setup(unsigned level);
+
+//=========================================================
+
+void clock_init(void)
+{
+    // (1) Clock HSE and wait for oscillations to setup.
+    SET_BIT(REG_RCC_CR, REG_RCC_CR_HSEON);
+    while (CHECK_BIT(REG_RCC_CR, REG_RCC_CR_HSERDY) == 0U)
+        continue;
+
+    // (2) Configure PREDIV output: HSE/2 = 4 MHz
+    SET_REG_RCC_CFGR2_PREDIV(HSE_PREDIV);
+
+    // (3) Select PREDIV output as PLL input (4 MHz):
+    SET_REG_RCC_CFGR_PLLSRC(REG_RCC_CFGR_PLLSRC_HSE_PREDIV);
+
+    // (4) AHB & APB are not divided: HCLK = PCLK = SYSCLK
+    SET_REG_RCC_CFGR_HPRE_NOT_DIV();
+    SET_REG_RCC_CFGR_PPRE(REG_RCC_CFGR_PPRE_NOT_DIV);
+
+    // (5) Prefetch buffer is required with wait states
+    SET_BIT(FLASH_ACR, FLASH_ACR_PRFTBE);
+
+    clock_tree_setup(CLOCK_LEVEL_HIGH);
+    Clock.level = CLOCK_LEVEL_HIGH;
+}
+
+//---------------------------------------------------------
+
+static void clock_switch_sysclk(uint32_t sw)
+{
+    SET_REG_RCC_CFGR_SW(sw);
+
+    // SWS encoding matches SW
+    while (GET_REG_RCC_CFGR_SWS() != sw)
+        continue;
+}
+
+//---------------------------------------------------------
+
+static void clock_tree_setup(unsigned level)
+{
+    const struct Clock_level_conf* conf = &Levels[level];
+
+    // Wait states must be added before frequency goes up
+    if (conf->frequency > FLASH_0WS_MAX_FREQUENCY)
+    {
+        SET_FLASH_ACR_LATENCY(FLASH_ACR_LATENCY_1WS);
+    }
+
+    // PLL can be reconfigured only while it is off & not used
+    clock_switch_sysclk(REG_RCC_CFGR_SW_HSE);
+
+    CLEAR_BIT(REG_RCC_CR, REG_RCC_CR_PLLON);
+    while (CHECK_BIT(REG_RCC_CR, REG_RCC_CR_PLLRDY) != 0U)
+        continue;
+
+    if (conf->pllmul != 0U)
+    {
+        SET_REG_RCC_CFGR_PLLMUL(conf->pllmul);
+
+        SET_BIT(REG_RCC_CR, REG_RCC_CR_PLLON);
+        while (CHECK_BIT(REG_RCC_CR, REG_RCC_CR_PLLRDY) == 0U)
+            continue;
+
+        clock_switch_sysclk(REG_RCC_CFGR_SW_PLL);
+    }
+
+    // ... and removed only after it went down
+    if (conf->frequency <= FLASH_0WS_MAX_FREQUENCY)
+    {
+        SET_FLASH_ACR_LATENCY(FLASH_ACR_LATENCY_0WS);
+    }
+}
+
+//---------------------------------------------------------
+
+int clock_set_level(unsigned level)
+{
+    if (level >= CLOCK_LEVELS_NUM)
+        return CLOCK_INV_LEVEL;
+
+    if (level == Clock.level)
+        return 0;
+
+    // Let ongoing transfers finish at the old rate
+    uart_wait_idle();
+    SPI_wait_idle();
+
+    uint32_t primask = irq_save();
+
+    uint32_t frequency = Levels[level].frequency;
+
+    // Ticks so far are counted at the old rate
+    tick_set_frequency(frequency);
+
+    clock_tree_setup(level);
+    Clock.level = (uint8_t) level;
+
+    uart_set_frequency(frequency);
+    SPI_set_frequency(frequency);
+    sound_set_frequency(frequency);
+
+    irq_restore(primask);
+    return 0;
+}
+
+//---------------------------------------------------------
+
+void clock_resume(void)
+{
+    // Stop mode halts HSE & PLL and leaves HSI as SYSCLK
+    if (GET_REG_RCC_CFGR_SWS() != REG_RCC_CFGR_SWS_HSI)
+        return;
+
+    SET_BIT(REG_RCC_CR, REG_RCC_CR_HSEON);
+    while (CHECK_BIT(REG_RCC_CR, REG_RCC_CR_HSERDY) == 0U)
+        continue;
+
+    clock_tree_setup(Clock.level);
+}
+
+//---------------------------------------------------------
+
+unsigned clock_get_level(void)
+{
+    return Clock.level;
+}
+
+//---------------------------------------------------------
+
+uint32_t clock_get_frequency(void)
+{
+    return Levels[Clock.level].frequency;
+}
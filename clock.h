@@ -0,0 +1,45 @@
+#pragma once 
+
+//=========================================================
+
+#include <stdint.h>
+
+//=========================================================
+
+/*
+    Performance levels (HSE is 8 MHz):
+        - LOW:  SYSCLK = HSE            =  8 MHz
+        - MED:  SYSCLK = HSE / 2 * 6    = 24 MHz
+        - HIGH: SYSCLK = HSE / 2 * 12   = 48 MHz
+
+    AHB & APB are not divided. On level switch tick rate (see tick.h),
+    USART baud rate, SPI prescaler and sound sample rate are recomputed.
+*/
+
+enum Clock_level
+{
+    CLOCK_LEVEL_LOW  = 0,
+    CLOCK_LEVEL_MED  = 1,
+    CLOCK_LEVEL_HIGH = 2,
+
+    CLOCK_LEVELS_NUM
+};
+
+enum Clock_error
+{
+    CLOCK_INV_LEVEL = -1
+};
+
+//=========================================================
+
+// Start HSE and switch to CLOCK_LEVEL_HIGH
+void clock_init(void);
+
+int clock_set_level(unsigned level);
+unsigned clock_get_level(void);
+
+// Bring back clock tree of current level after Stop mode wakeup
+void clock_resume(void);
+
+// Current SYSCLK = HCLK = PCLK frequency
+uint32_t clock_get_frequency(void);
@@ -1,8 +1,33 @@
 #pragma once 
 
+#include "memmap.h"
+#include "memops.h"
+#include "divops.h"
+#include "frame.h"
+#include "probe.h"
+
 #define BUTTONS_NUM 4
 #define SCRN_WIDTH 128
 #define SCRN_HEIGHT 64
+#define SCRN_FB_BYTES (SCRN_WIDTH * SCRN_HEIGHT / 8)
+#define KV_MAX_KEYS 16
+
+#define PERF_LEVEL_LOW  0 //  8 MHz
+#define PERF_LEVEL_MED  1 // 24 MHz
+#define PERF_LEVEL_HIGH 2 // 48 MHz
+
+#define IDLE_MAX_TIMEOUT_MS 999
+#define IDLE_WAKE_TIMEOUT   0
+#define IDLE_WAKE_INPUT     1 // Button pressed
+
+#define LINK_DELAY_MAX    3  // Frames of input delay
+#define LINK_STEP_WAIT   -3  // Input of the other board has not arrived yet
+#define LINK_STEP_DESYNC -4  // State CRCs differ, boards diverged
+
+#define SOUND_VOICES     4
+#define SOUND_NOISE      3   // Last voice plays noise instead of square wave
+#define SOUND_ALL        SOUND_VOICES
+#define SOUND_MAX_VOLUME 15
 
 struct API
 {
@@ -27,6 +52,59 @@ struct API
     int (*scrn_yline)(unsigned x, unsigned y, unsigned len);
 
     int (*scrn_box)(unsigned x, unsigned y, unsigned x_len, unsigned y_len);
+
+    int (*kv_read) (unsigned key, void* data, unsigned size);
+    int (*kv_write)(unsigned key, const void* data, unsigned size);
+    int (*kv_erase)(unsigned key);
+
+    int (*set_perf_level)(unsigned level);
+
+    int (*idle)(unsigned timeout_ms);
+
+    void (*log_write)(uint32_t id, unsigned argc, const uint32_t* args); // Use API_LOG() from common/log.h
+
+    // Non-blocking, return number of bytes accepted / copied.
+    // serial_read fails once (UART_RECV_ORE, -11) after received bytes were lost to a full ring
+    int (*serial_write)(const void* buf, unsigned len);
+    int (*serial_read) (void* buf, unsigned max);
+
+    // Two-board lockstep: link_step returns local | remote << 8 buttons of frame
+    int (*link_start)(unsigned input_delay);
+    int (*link_step) (unsigned buttons, const void* state, unsigned state_size);
+
+    // Mixed by the host in background, tone keeps playing while the guest draws
+    int (*sound_play)(unsigned voice, unsigned freq_hz, unsigned duration_ms, unsigned volume);
+    int (*sound_stop)(unsigned voice);
+
+    // Uploaded asset pack (see common/assets.h), id is the hash from assets.py
+    int (*asset_size)(unsigned id);
+    const void* (*asset_map)(unsigned id);
+    int (*asset_read)(unsigned id, void* buf, unsigned size);
+
+    int (*mem_usage)(struct Mem_usage* usage);
+    int (*mem_map)  (struct Mem_map* map);
+
+    // Word-burst memcpy, memset and memmove, see common/memops.h
+    void* (*mem_copy)(void* dst, const void* src, unsigned size);
+    void* (*mem_fill)(void* dst, int value, unsigned size);
+    void* (*mem_move)(void* dst, const void* src, unsigned size);
+
+    // Quotient | remainder << 32, see common/divops.h
+    uint64_t (*div_u32)(uint32_t n, uint32_t d);
+    uint64_t (*div_s32)(int32_t n, int32_t d);
+
+    // Runs update and render at a fixed rate until update returns non-zero, see common/frame.h
+    int (*frame_run)(const struct Frame_loop* loop);
+
+    // Second display on boards built with DISPLAYS=2: drawing calls go to display id,
+    // fb (SCRN_FB_BYTES, NULL keeps the current one) is its framebuffer
+    int (*scrn_select)(unsigned id, uint8_t* fb);
+    // Frames of all displays back to back over DMA, frame_run does this after render
+    void (*scrn_draw_all)(void);
+    // Cycle counter and per-region timings, use API_PROBE_BEGIN/END from common/probe.h
+    uint32_t (*probe_now)(void);
+    int (*probe_add) (unsigned id, uint32_t cycles);
+    int (*probe_take)(unsigned id, struct Probe_stats* stats);
 };
 
 typedef int (*umain_t) (struct API* api);
@@ -0,0 +1,64 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+//=========================================================
+
+/*
+    Asset pack: sprites, maps, fonts and text uploaded once into the
+    flash area between the firmware staging slot and key-value pages,
+    shared by every guest that runs afterwards. ./assets.py builds it.
+
+        [Asset_pack][Asset_entry x count][blobs ...]
+
+    Entries are sorted by id, the 32-bit FNV-1a hash of the asset
+    name, so lookup is a binary search. assets.py writes the ids as
+    defines for guests. Offsets are from the pack start.
+
+    Stored blobs are read in place through asset_map (flash is memory
+    mapped). Compressed ones are unpacked on demand by asset_read into
+    guest RAM, the working set is the only copy there.
+
+    ASSET_CODEC_LZSS: flag byte, then 8 items, LSB flag first:
+        1 - literal byte
+        0 - two bytes [dist_lo] [dist_hi:4 | len:4], copy len + 3 bytes
+            starting dist + 1 bytes back in the output
+*/
+
+#define ASSETS_MAGIC 0x54455341U // "ASET"
+
+#define ASSET_FNV_BASIS 0x811C9DC5U
+#define ASSET_FNV_PRIME 0x01000193U
+
+enum Asset_codec
+{
+    ASSET_CODEC_STORED = 0,
+    ASSET_CODEC_LZSS   = 1
+};
+
+enum Asset_error
+{
+    ASSET_NOT_FOUND = -1, // Or no valid pack in flash
+    ASSET_INV_ARG   = -2,
+    ASSET_CORRUPT   = -3
+};
+
+struct Asset_pack
+{
+    uint32_t magic;
+    uint16_t count;
+    uint16_t reserved;
+    uint32_t size; // Whole pack
+};
+
+struct Asset_entry
+{
+    uint32_t id;
+    uint16_t offset;
+    uint16_t size;     // Stored bytes
+    uint16_t raw_size; // Bytes after unpacking
+    uint8_t codec;
+    uint8_t reserved;
+};
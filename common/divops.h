@@ -0,0 +1,45 @@
+#pragma once
+
+//=========================================================
+
+/*
+    Cortex-M0 has no divide instruction. The host exports div_u32 and
+    div_s32 (divops.S), and user.S provides weak __aeabi_uidiv(mod) and
+    __aeabi_idiv(mod) that jump to them, so every `/` and `%` of guest
+    code goes there instead of libgcc.
+
+    Both return the quotient in the low word and the remainder in the
+    high word, as __aeabi_uidivmod does in r0 and r1:
+
+        uint64_t qr = api->div_u32(n, d);
+        unsigned q = DIV_QUOT(qr), r = DIV_REM(qr);
+
+    Division by a constant needs no call at all when the numerator fits
+    in 16 bits: DIV_U16(n, 360) is a multiply, an add and two shifts,
+    exact for any n below 65536 and D from 1 to 65535. D must be a
+    constant expression, otherwise the magic number is computed with
+    a 64-bit division at run time.
+*/
+
+#define API_DIV_U32_OFFS 140
+#define API_DIV_S32_OFFS 144
+
+#define DIV_QUOT(QR) ((unsigned) (QR))
+#define DIV_REM(QR)  ((unsigned) ((QR) >> 32))
+
+// ceil(log2(D))
+#define DIV_SHIFT(D)                                                 \
+    (((D) > 0x1U)    + ((D) > 0x2U)    + ((D) > 0x4U)    + ((D) > 0x8U)    + \
+     ((D) > 0x10U)   + ((D) > 0x20U)   + ((D) > 0x40U)   + ((D) > 0x80U)   + \
+     ((D) > 0x100U)  + ((D) > 0x200U)  + ((D) > 0x400U)  + ((D) > 0x800U)  + \
+     ((D) > 0x1000U) + ((D) > 0x2000U) + ((D) > 0x4000U) + ((D) > 0x8000U))
+
+// floor(2^(16 + shift) / D) + 1 without its 2^16 bit, which is added back as n
+#define DIV_MAGIC(D) \
+    ((unsigned) ((0x10000ULL << DIV_SHIFT(D)) / (D) + 1U - 0x10000U))
+
+#define DIV_U16(N, D) \
+    (((((unsigned) (N) * DIV_MAGIC(D)) >> 16) + (unsigned) (N)) >> DIV_SHIFT(D))
+
+#define MOD_U16(N, D) \
+    ((unsigned) (N) - DIV_U16(N, D) * (unsigned) (D))
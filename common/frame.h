@@ -0,0 +1,38 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+//=========================================================
+
+/*
+    Host-driven frame loop. Instead of its own while (1) with delays,
+    a guest hands frame_run two callbacks and the host paces them:
+
+        wait for tick | buttons | update x 1..FRAME_MAX_CATCHUP | render | flush ...
+                                  ^ previous frame still going out over DMA
+
+    Buttons are sampled once per frame, bit n for button n. update gets
+    the same dt_ms every time; a guest that fell behind gets several
+    updates before the next render, and beyond FRAME_MAX_CATCHUP the
+    backlog is dropped. render draws into fb of the selected display
+    (NULL with MEM_NO_FRAMEBUFFER), frames of all displays are flushed
+    back to back as soon as it returns. With MEM_DOUBLE_BUFFER render
+    overlaps the transfer as well.
+
+    Non-zero update result ends the loop, frame_run returns it.
+*/
+
+#define FRAME_MAX_CATCHUP   4
+#define FRAME_MAX_PERIOD_MS 1000
+
+#define FRAME_RUN_INV_ARG -56 // Missing callback or period out of range
+
+struct Frame_loop
+{
+    int  (*update)(void* ctx, unsigned dt_ms, unsigned buttons);
+    void (*render)(void* ctx, uint8_t* fb);
+    void* ctx;
+    uint32_t period_ms;
+};
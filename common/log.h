@@ -0,0 +1,44 @@
+#pragma once 
+
+//=========================================================
+
+#include <stdint.h>
+
+//=========================================================
+
+/*
+    Tokenized logging:
+        Format string is placed in .logstr section, which is kept
+        in the ELF but not loaded to the board. Its address is the
+        message ID, so only ID and raw argument words are queued.
+        ./logdecode.py rebuilds messages from build/uart.elf and
+        build/user.elf.
+
+    Arguments are 32-bit words: integers, characters or pointers
+    cast to uintptr_t. Up to LOG_MAX_ARGS arguments are supported.
+
+    Frame on the wire (little-endian):
+        [0xA5][argc][seq:16][id:32][arg:32] x argc
+*/
+
+#define LOG_MAX_ARGS 4
+
+#define LOG_SYNC 0xA5U
+
+#define LOG_CALL(write, fmt, ...)                                                   \
+                                                                                    \
+    do                                                                              \
+    {                                                                               \
+        __attribute__ ((section (".logstr"))) static const char log_fmt_[] = fmt;   \
+        const uint32_t log_args_[] = { 0U, __VA_ARGS__ };                           \
+        const unsigned log_argc_ = sizeof(log_args_) / sizeof(uint32_t) - 1U;      \
+                                                                                    \
+        _Static_assert(sizeof(log_args_) / sizeof(uint32_t) - 1U <= LOG_MAX_ARGS,   \
+                       "Too many log arguments");                                   \
+                                                                                    \
+        (write)((uint32_t)(uintptr_t) log_fmt_, log_argc_, &log_args_[1]);          \
+                                                                                    \
+    } while (0)
+
+// Guest side: API_LOG(api, "score %u", score);
+#define API_LOG(api, fmt, ...) LOG_CALL((api)->log_write, fmt, __VA_ARGS__)
@@ -0,0 +1,67 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+//=========================================================
+
+/*
+    Guest memory map, negotiated at upload:
+
+        host data | framebuffer | guest image | heap ... | [back buffer] | stack
+                  ^ spare with MEM_NO_FRAMEBUFFER                         top of SRAM ^
+
+    Thumb guest may state what it needs with MEM_REQUEST() in one of its
+    sources; user.lds places the request right after the entry branch of
+    user.S, at image offset 4, where the loader looks for it. Images
+    without one (and bytecode) get the default map: framebuffer and
+    MEM_DEFAULT_STACK of stack.
+
+    Guest reads its regions back through mem_map. Addresses are guest
+    addresses as plain words, so the layout is the same in simulator.
+*/
+
+#define MEM_REQUEST_MAGIC 0x5251454DU // "MEQR"
+
+#define MEM_DEFAULT_STACK 0x400U
+#define MEM_MIN_STACK     0x100U
+
+// Rendering through streaming or direct SPI: host framebuffer slot is given to the guest
+#define MEM_NO_FRAMEBUFFER 0x1U
+// Second framebuffer below the stack, scrn_draw swaps them: each frame is drawn from scratch
+#define MEM_DOUBLE_BUFFER  0x2U
+
+struct Mem_request
+{
+    uint32_t magic;
+    uint16_t stack_size; // 0 for MEM_DEFAULT_STACK
+    uint16_t flags;
+};
+
+// MEM_REQUEST(0x200, MEM_NO_FRAMEBUFFER);
+#define MEM_REQUEST(STACK_SIZE, FLAGS)                                  \
+    __attribute__ ((section (".memreq"), used))                        \
+    static const struct Mem_request Mem_request_ =                     \
+        { MEM_REQUEST_MAGIC, (uint16_t) (STACK_SIZE), (uint16_t) (FLAGS) }
+
+struct Mem_map
+{
+    uint32_t heap;        // Free RAM right after the image
+    uint32_t heap_size;
+    uint32_t spare;       // Framebuffer slot with MEM_NO_FRAMEBUFFER, 0 otherwise
+    uint32_t spare_size;
+    uint32_t framebuffer; // Host framebuffer, 0 with MEM_NO_FRAMEBUFFER
+    uint32_t back_buffer; // Second one with MEM_DOUBLE_BUFFER, 0 otherwise
+    uint32_t stack_limit; // Stack grows down to here
+    uint32_t stack_size;
+};
+
+// Guest SRAM use so far, see memstat.h
+struct Mem_usage
+{
+    uint32_t image_size;     // Code, data and bss (bytecode globals)
+    uint32_t stack_max;      // Deepest stack so far, interrupt frames included
+    uint32_t free_min;       // From image end to the deepest stack, heap included
+    uint32_t stack_reserved; // Stack size of the memory map
+};
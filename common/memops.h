@@ -0,0 +1,13 @@
+#pragma once
+
+//=========================================================
+
+/*
+    user.S provides weak memcpy, memset and memmove that jump to the
+    host routines through struct API, so guests need not take them from
+    libc. Offsets of the entries in struct API, api.c checks them.
+*/
+
+#define API_MEM_COPY_OFFS 128
+#define API_MEM_FILL_OFFS 132
+#define API_MEM_MOVE_OFFS 136
@@ -0,0 +1,50 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+//=========================================================
+
+/*
+    Timing probes. TIM2 runs free at HCLK, one count per CPU cycle,
+    32 bits wide: a region of up to 89 s at 48 MHz is timed exactly.
+    Count, total, min and max cycles are kept per probe id in a table
+    on the host. Guests time their own regions with
+
+        API_PROBE_BEGIN(api, 0);
+        ...
+        API_PROBE_END(api, 0);
+
+    in one block; id is a number below PROBE_GUEST_IDS. A guest probe
+    includes two API calls (a few dozen cycles).
+
+    probe_take(id, stats) copies and clears a probe, ids of the whole
+    table are used: host regions first, guest ones from PROBE_GUEST.
+    Cycles are at the clock level the region ran at.
+*/
+
+#define PROBE_HOST_IDS  8
+#define PROBE_GUEST_IDS 8
+#define PROBE_IDS       (PROBE_HOST_IDS + PROBE_GUEST_IDS)
+
+#define PROBE_GUEST PROBE_HOST_IDS // Guest probe 0 in probe_take()
+
+// Host regions, probes in firmware are built with `make PROBES=1`
+#define PROBE_SCRN_DRAW     0 // scrn_draw(), wait for the panel included
+#define PROBE_BUTTON_UPDATE 1 // Debounce of one button
+#define PROBE_UART_IRQ      2 // USART1 handler
+#define PROBE_UART_DMA_IRQ  3 // DMA channels 2 & 3 handler
+
+#define PROBE_INV_ARG -60
+
+struct Probe_stats
+{
+    uint32_t count;
+    uint32_t total;
+    uint32_t min;
+    uint32_t max;
+};
+
+#define API_PROBE_BEGIN(api, ID) const uint32_t probe_start_##ID = (api)->probe_now()
+#define API_PROBE_END(api, ID)   (api)->probe_add((ID), (api)->probe_now() - probe_start_##ID)
@@ -0,0 +1,32 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+//=========================================================
+
+/*
+    Integer division for Cortex-M0 (divops.S), exported to guests
+    through struct API and standing in for libgcc's __aeabi_uidiv(mod)
+    and __aeabi_idiv(mod). Quotient is in the low word of the result,
+    remainder in the high one (DIV_QUOT / DIV_REM of common/divops.h).
+
+    Cycles on the simulator CPU, call included, against libgcc's
+    Thumb-1 shift-subtract:
+
+        4999999 / 1000    63   120
+        0xFFFFFFFF / 10   63   237
+        123456 / 7        63   119
+        5000 / 1000       37    38
+
+    Reciprocals of the last divisors are kept in an 8-slot table, a
+    divisor missing from it costs about 430 cycles once.
+*/
+
+//=========================================================
+
+uint64_t div_u32(uint32_t n, uint32_t d);
+
+// Rounded towards zero, remainder has the sign of n
+uint64_t div_s32(int32_t n, int32_t d);
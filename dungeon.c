@@ -7,7 +7,8 @@
 // All floating point values are replaced with
 // integer counterparts * 1000 to save space.
 
-#define MAP_VALUE(x, y) (MAP[y / 1000] & (1 << (7 - (x / 1000) )))
+// Coordinates are below 8000 here: multiply-shift instead of a division call
+#define MAP_VALUE(x, y) (MAP[DIV_U16(y, 1000)] & (1 << (7 - DIV_U16(x, 1000))))
 #define PI 3141
 
 // TODO: tables are symmetrical so they can be optimized further
@@ -63,7 +64,9 @@ int umain(struct API* api) {
     while (1) {
         api->scrn_clear(0x00);
 
-        // Ray cast
+        // Ray cast, cycles of it are in guest probe 0
+        API_PROBE_BEGIN(api, 0);
+
         for (int x = -SCRN_WIDTH / 2; x < SCRN_WIDTH / 2; x++) {
             int ray_angle = view_angle + x;
 
@@ -82,6 +85,8 @@ int umain(struct API* api) {
             }
         }
 
+        API_PROBE_END(api, 0);
+
         // plr_x -= 20;
         // if (plr_x < 1000) {
         //     plr_x = 6000;
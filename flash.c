@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "inc/flash.h"
+#include "flash.h"
+
+//=========================================================
+
+static int flash_wait_for_eop(void);
+
+//=========================================================
+
+void flash_unlock(void)
+{
+    if (CHECK_BIT(FLASH_CR, FLASH_CR_LOCK) == 0U)
+        return;
+
+    *FLASH_KEYR = FLASH_KEY1;
+    *FLASH_KEYR = FLASH_KEY2;
+}
+
+//---------------------------------------------------------
+
+void flash_lock(void)
+{
+    SET_BIT(FLASH_CR, FLASH_CR_LOCK);
+}
+
+//---------------------------------------------------------
+
+static int flash_wait_for_eop(void)
+{
+    while (CHECK_BIT(FLASH_SR, FLASH_SR_BSY) != 0U)
+        continue;
+
+    uint32_t status = *FLASH_SR;
+    *FLASH_SR = status; // EOP & error flags are cleared by writing 1
+
+    if (status & (1U << FLASH_SR_WRPRTERR))
+        return FLASH_WRPRT_ERR;
+
+    if (status & (1U << FLASH_SR_PGERR))
+        return FLASH_PROG_ERR;
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+int flash_page_erase(uint32_t addr)
+{
+    SET_BIT(FLASH_CR, FLASH_CR_PER);
+    *FLASH_AR = addr;
+    SET_BIT(FLASH_CR, FLASH_CR_STRT);
+
+    int err = flash_wait_for_eop();
+    CLEAR_BIT(FLASH_CR, FLASH_CR_PER);
+
+    return err;
+}
+
+//---------------------------------------------------------
+
+int flash_program_halfword(uint32_t addr, uint16_t data)
+{
+    if ((addr & 1U) != 0U)
+        return FLASH_INV_ARG;
+
+    SET_BIT(FLASH_CR, FLASH_CR_PG);
+    *(volatile uint16_t*)(uintptr_t) addr = data;
+
+    int err = flash_wait_for_eop();
+    CLEAR_BIT(FLASH_CR, FLASH_CR_PG);
+
+    return err;
+}
+
+//---------------------------------------------------------
+
+int flash_program(uint32_t addr, const void* data, size_t size)
+{
+    if (data == NULL || (addr & 1U) != 0U)
+        return FLASH_INV_ARG;
+
+    const uint8_t* bytes = (const uint8_t*) data;
+    int err = 0;
+
+    SET_BIT(FLASH_CR, FLASH_CR_PG);
+
+    for (size_t ind = 0; ind < size; ind += 2)
+    {
+        // Source buffer may be unaligned - assemble half-word bytewise
+        uint16_t half = bytes[ind];
+        half |= (ind + 1 < size)? (uint16_t) (bytes[ind + 1] << 8) : 0xFF00U;
+
+        *(volatile uint16_t*)(uintptr_t) (addr + ind) = half;
+
+        err = flash_wait_for_eop();
+        if (err < 0) break;
+    }
+
+    CLEAR_BIT(FLASH_CR, FLASH_CR_PG);
+    return err;
+}
@@ -0,0 +1,30 @@
+#pragma once 
+
+//=========================================================
+
+#include <stdlib.h>
+#include <stdint.h>
+
+//=========================================================
+
+enum Flash_error
+{
+    FLASH_INV_ARG   = -1,
+    FLASH_PROG_ERR  = -2,
+    FLASH_WRPRT_ERR = -3
+};
+
+//=========================================================
+
+// Unlock/lock flash control register for erase & program operations
+void flash_unlock(void);
+void flash_lock(void);
+
+// Erase flash page containing given address
+int flash_page_erase(uint32_t addr);
+
+// Program one half-word, address must be half-word aligned
+int flash_program_halfword(uint32_t addr, uint16_t data);
+
+// Program buffer of half-words, size in bytes (odd tail is padded with 0xFF)
+int flash_program(uint32_t addr, const void* data, size_t size);
@@ -0,0 +1,90 @@
+#include <stdint.h>
+#include <stddef.h>
+
+//---------------------------------------------------------
+
+#include "inc/arm.h"
+#include "api.h"
+#include "screen.h"
+#include "frame.h"
+#include "tick.h"
+
+//=========================================================
+
+#define TICKS_PER_MS (TICK_FREQ / 1000U)
+
+//=========================================================
+
+// Ticks from now until deadline, negative once it has passed
+static int frame_ahead(unsigned deadline)
+{
+    return (int) (deadline - tick_now());
+}
+
+//---------------------------------------------------------
+
+static void frame_wait(unsigned deadline)
+{
+    // Pending interrupt still ends WFI with PRIMASK set, handlers run after restore
+    uint32_t primask = irq_save();
+    int ahead = 0;
+
+    // Any interrupt wakes us up, SysTick may have been asked by someone else
+    while ((ahead = frame_ahead(deadline)) > 0)
+    {
+        tick_request((unsigned) ahead);
+        wfi();
+
+        irq_restore(primask);
+        primask = irq_save();
+    }
+
+    irq_restore(primask);
+}
+
+//---------------------------------------------------------
+
+int frame_run(const struct Frame_loop* loop)
+{
+    if (loop == NULL || loop->update == NULL || loop->render == NULL)
+        return FRAME_INV_ARG;
+
+    if (loop->period_ms == 0U || loop->period_ms > FRAME_MAX_PERIOD_MS)
+        return FRAME_INV_ARG;
+
+    unsigned period = loop->period_ms * TICKS_PER_MS;
+    unsigned deadline = tick_now();
+
+    while (1)
+    {
+        // Previous frame is flushed meanwhile, DMA needs no CPU
+        frame_wait(deadline);
+
+        unsigned buttons = api_buttons();
+
+        for (unsigned step = 0U; step < FRAME_MAX_CATCHUP; step++)
+        {
+            int res = loop->update(loop->ctx, loop->period_ms, buttons);
+            if (res != 0)
+            {
+                scrn_wait();
+                return res;
+            }
+
+            deadline += period;
+
+            if (frame_ahead(deadline) > 0)
+                break;
+        }
+
+        // Still behind: the rest is dropped rather than caught up with later
+        if (frame_ahead(deadline) <= 0)
+            deadline = tick_now() + period;
+
+        // Single buffer is waited for here, the other one is free already.
+        // Guest may draw on other displays too: all of them are flushed
+        loop->render(loop->ctx, scrn_buffer());
+
+        scrn_flush_all();
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+#include "common/frame.h"
+
+//=========================================================
+
+/*
+    Fixed-timestep loop run for the guest (see common/frame.h). Time
+    comes from tick_now(), the loop sleeps in plain Sleep mode with
+    SysTick asked to fire at the deadline: Stop mode would halt it.
+*/
+
+enum Frame_error
+{
+    FRAME_INV_ARG = -56 // FRAME_RUN_INV_ARG for guests
+};
+
+//=========================================================
+
+int frame_run(const struct Frame_loop* loop);
@@ -0,0 +1,164 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "inc/flash.h"
+#include "inc/scb.h"
+#include "flash.h"
+#include "crc.h"
+#include "uart.h"
+#include "loader.h"
+#include "fwup.h"
+
+//=========================================================
+
+// Symbols from entry.lds
+extern uint8_t __staging_start[];
+extern uint8_t __fwup_marker[];
+extern uint8_t __guest_start[];
+
+#define FWUP_STAGING ((uint32_t) __staging_start)
+#define FWUP_MARKER  ((uint32_t) __fwup_marker)
+
+//---------------------------------------------------------
+
+static int fwup_recv_wait(uint32_t size);
+
+//=========================================================
+
+static int fwup_recv_wait(uint32_t size)
+{
+    int32_t res = 0;
+
+    do 
+    {
+        res = is_recv_complete();
+        if (res < 0) return FWUP_RECV_ERR;
+
+    } while (res == 0);
+
+    // Receive timeout before the end of chunk
+    if ((uint32_t) res != size)
+        return FWUP_RECV_ERR;
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+int fwup_receive_pages(struct Uart* uart, uint32_t dst, uint32_t capacity)
+{
+    uint32_t size = 0;
+
+    int err = uart_recv_buffer(uart, &size, sizeof(size));
+    if (err < 0) return err;
+
+    err = fwup_recv_wait(sizeof(size));
+    if (err < 0) return err;
+
+    if (size == 0U || size > capacity || (size & 0b11) != 0U)
+        return FWUP_INV_SIZE;
+
+    // Guest area is idle: page buffers at its start
+    uint8_t* cur_buf  = __guest_start;
+    uint8_t* next_buf = __guest_start + FLASH_PAGE_SIZE;
+
+    uint32_t chunk = (size < FLASH_PAGE_SIZE)? size : FLASH_PAGE_SIZE;
+
+    err = uart_recv_buffer(uart, cur_buf, chunk);
+    if (err < 0) return err;
+
+    flash_unlock();
+
+    for (uint32_t offs = 0; offs < size; offs += FLASH_PAGE_SIZE)
+    {
+        err = fwup_recv_wait(chunk);
+        if (err < 0) break;
+
+        // Receive next page (or trailing CRC) while current one is programmed
+        uint32_t left = size - offs - chunk;
+        uint32_t next_chunk = (left == 0U)? sizeof(uint32_t) :
+                              (left < FLASH_PAGE_SIZE)? left : FLASH_PAGE_SIZE;
+
+        err = uart_recv_buffer(uart, next_buf, next_chunk);
+        if (err < 0) break;
+
+        err = flash_page_erase(dst + offs);
+        if (err == 0) err = flash_program(dst + offs, cur_buf, chunk);
+        
+        if (err < 0)
+        {
+            err = FWUP_FLASH_ERR;
+            break;
+        }
+
+        uint8_t* tmp = cur_buf;
+        cur_buf  = next_buf;
+        next_buf = tmp;
+
+        chunk = next_chunk;
+    }
+
+    if (err == 0)
+        err = fwup_recv_wait(sizeof(uint32_t));
+
+    flash_lock();
+
+    if (err < 0)
+        return err;
+
+    // Verify what was actually programmed, not what was received
+    uint32_t recv_hash = *(uint32_t*) cur_buf;
+
+    crc_init(0xFFFFFFFF);
+    uint32_t calc_hash = crc32_calc((uint8_t*) dst, size);
+
+    if (calc_hash != recv_hash)
+        return FWUP_CRC_ERR;
+
+    return (int) size;
+}
+
+//---------------------------------------------------------
+
+int fwup_receive(struct Uart* uart)
+{
+    // Marker words are not part of the slot image may take
+    int size = fwup_receive_pages(uart, FWUP_STAGING, FWUP_MARKER - FWUP_STAGING);
+    if (size < 0) return size;
+
+    const uint32_t marker[] = { FWUP_PENDING, (uint32_t) size, ~(uint32_t) size };
+    uint32_t marker_page = FWUP_MARKER & ~(FLASH_PAGE_SIZE - 1U);
+
+    flash_unlock();
+
+    // Image short of the last page did not erase it: an older upload may be there
+    int err = 0;
+    if (FWUP_STAGING + (uint32_t) size <= marker_page)
+        err = flash_page_erase(marker_page);
+
+    // Update is committed once the size complement is in: boot stub ignores a partial marker
+    if (err == 0) err = flash_program(FWUP_MARKER, marker, sizeof(marker));
+
+    flash_lock();
+
+    if (err < 0)
+        return FWUP_FLASH_ERR;
+
+    // Staging copy is verified and pending: answer now, the board resets without a word
+    static const uint32_t ack = LOADER_ACK;
+
+    while (uart_trns_buffer(uart, &ack, sizeof(ack)) == UART_TRNS_NOT_COMPL)
+        continue;
+
+    while (is_trns_complete() == 0)
+        continue;
+
+    // Boot stub copies staging slot over the active one
+    SCB_SYSTEM_RESET();
+
+    while (1)
+        continue;
+}
@@ -0,0 +1,50 @@
+#pragma once 
+
+//=========================================================
+
+#include <stdint.h>
+
+#include "uart.h"
+
+//=========================================================
+
+/*
+    Host firmware update over the UART loader protocol:
+
+        [FWUP_MAGIC][image size][image ... padded to word][crc32 of image]
+
+    Image is received page by page into SRAM buffers of the (idle) guest 
+    area and programmed into the staging slot, while DMA keeps receiving 
+    next page. Staging slot is checked with hardware CRC, then a pending 
+    marker is programmed into its last words:
+
+        [FWUP_PENDING][image size][~image size]
+
+    The image is answered with LOADER_ACK and the board resets. Boot stub
+    in the first flash page (boot.S) copies the staging slot over the
+    active one while the marker is there and erases it after the copy.
+    A reset or power loss midway repeats the copy on the next boot, so
+    the switch-over never leaves the board without firmware.
+
+    'make fwupdate' sends the image without the boot stub page.
+*/
+
+#define FWUP_MAGIC   0x50555746U // "FWUP"
+#define FWUP_PENDING 0x444E5046U // "FPND", see boot.S
+
+enum Fwup_error
+{
+    FWUP_INV_SIZE  = -1,
+    FWUP_RECV_ERR  = -2,
+    FWUP_FLASH_ERR = -3,
+    FWUP_CRC_ERR   = -4
+};
+
+//=========================================================
+
+// Receive image after FWUP_MAGIC word, resets into the boot stub on success
+int fwup_receive(struct Uart* uart);
+
+// Receive [size][data][crc32] page by page into flash at dst (page aligned),
+// returns size once programmed data matches crc. Buffers are in guest area.
+int fwup_receive_pages(struct Uart* uart, uint32_t dst, uint32_t capacity);
@@ -1,8 +1,47 @@
 #ifndef ARM_H
 #define ARM_H
 
+#include <stdint.h>
+
+#if defined(__arm__)
+
 inline __attribute__ ((always_inline)) void wfi(void) {
     __asm__ volatile ("wfi");
 }
 
+// Mask interrupts, returns previous PRIMASK value
+inline __attribute__ ((always_inline)) uint32_t irq_save(void) {
+    uint32_t primask = 0;
+    __asm__ volatile ("mrs %0, primask\n\tcpsid i" : "=r"(primask) :: "memory");
+    return primask;
+}
+
+inline __attribute__ ((always_inline)) void irq_restore(uint32_t primask) {
+    __asm__ volatile ("msr primask, %0" :: "r"(primask) : "memory");
+}
+
+// Memory accesses before it complete before any after it, DMA included
+inline __attribute__ ((always_inline)) void dmb(void) {
+    __asm__ volatile ("dmb" ::: "memory");
+}
+
+#else
+
+// Host builds of firmware modules (see sim/): no interrupts to wait for or mask
+static inline void wfi(void) {}
+
+static inline uint32_t irq_save(void) {
+    return 0;
+}
+
+static inline void irq_restore(uint32_t primask) {
+    (void) primask;
+}
+
+static inline void dmb(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif // __arm__
+
 #endif // ARM_H
@@ -111,7 +111,9 @@
 #define DMA_CCR_PSIZE_16 0b01
 #define DMA_CCR_PSIZE_32 0b10
 
-#define SET_DMA_CCR_PSIZE(REG, value) PUPER_MODIFY_REG(REG, 0b11, value, DMA_CCR_PSIZE)
+#define DMA_CCR_PSIZE_FIELD DMA_CCR_PSIZE, 2
+
+#define SET_DMA_CCR_PSIZE(REG, value) REG_UPDATE(REG, FIELD_VAR(DMA_CCR_PSIZE_FIELD, value))
 #define GET_DMA_CCR_PSIZE(REG) SUPER_CHECK_REG(REG, 0b11, DMA_CCR_PSIZE)
 
 #define DMA_CCR_MSIZE 10
@@ -120,7 +122,9 @@
 #define DMA_CCR_MSIZE_16 0b01
 #define DMA_CCR_MSIZE_32 0b10
 
-#define SET_DMA_CCR_MSIZE(REG, value) PUPER_MODIFY_REG(REG, 0b11, value, DMA_CCR_MSIZE)
+#define DMA_CCR_MSIZE_FIELD DMA_CCR_MSIZE, 2
+
+#define SET_DMA_CCR_MSIZE(REG, value) REG_UPDATE(REG, FIELD_VAR(DMA_CCR_MSIZE_FIELD, value))
 #define GET_DMA_CCR_MSIZE(REG) SUPER_CHECK_REG(REG, 0b11, DMA_CCR_MSIZE)
 
 #define DMA_CCR_PL 12
@@ -130,7 +134,9 @@
 #define DMA_CCR_PL_HIGH      0b10
 #define DMA_CCR_PL_VERY_HIGH 0b11
 
-#define SET_DMA_CCR_PL(REG, value) PUPER_MODIFY_REG(REG, 0b11, value, DMA_CCR_PL)
+#define DMA_CCR_PL_FIELD DMA_CCR_PL, 2
+
+#define SET_DMA_CCR_PL(REG, value) REG_UPDATE(REG, FIELD_VAR(DMA_CCR_PL_FIELD, value))
 #define GET_DMA_CCR_PL(REG) SUPER_CHECK_REG(REG, 0b11, DMA_CCR_PL)
 
 #define DMA_CCR_MEM2MEM 14
@@ -141,7 +147,9 @@
 
 #define DMA_CNDTR_NDT 0
 
-#define SET_DMA_CNDTR_NDT(REG, value) PUPER_MODIFY_REG(REG, 0xFFFF, value, DMA_CNDTR_NDT)
+#define DMA_CNDTR_NDT_FIELD DMA_CNDTR_NDT, 16
+
+#define SET_DMA_CNDTR_NDT(REG, value) REG_UPDATE(REG, FIELD_VAR(DMA_CNDTR_NDT_FIELD, value))
 #define GET_DMA_CNDTR_NDT(REG) SUPER_CHECK_REG(REG, 0xFFFF, DMA_CNDTR_NDT)
 
 //---------------------------------------------------------
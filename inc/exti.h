@@ -0,0 +1,35 @@
+#pragma once 
+
+//---------------------------------------------------------
+
+#include "modregs.h"
+
+//=========================================================
+
+// Extended interrupts and events controller
+#define EXTI 0x40010400U
+
+#define EXTI_IMR   (volatile uint32_t*)(uintptr_t)(EXTI + 0x00) // Interrupt mask register
+#define EXTI_EMR   (volatile uint32_t*)(uintptr_t)(EXTI + 0x04) // Event mask register
+#define EXTI_RTSR  (volatile uint32_t*)(uintptr_t)(EXTI + 0x08) // Rising trigger selection register
+#define EXTI_FTSR  (volatile uint32_t*)(uintptr_t)(EXTI + 0x0C) // Falling trigger selection register
+#define EXTI_SWIER (volatile uint32_t*)(uintptr_t)(EXTI + 0x10) // Software interrupt event register
+#define EXTI_PR    (volatile uint32_t*)(uintptr_t)(EXTI + 0x14) // Pending register (rc_w1)
+
+//---------------------------------------------------------
+
+// Lines 0..15 are GPIO pins, selected port is set in SYSCFG_EXTICRx (PA by default)
+
+#define EXTI_LINE_PVD       16
+#define EXTI_LINE_RTC_ALARM 17
+#define EXTI_LINE_RTC_TSTMP 19
+#define EXTI_LINE_USART1    25
+#define EXTI_LINE_USART2    26
+
+//---------------------------------------------------------
+
+// IRQ numbers
+
+#define EXTI0_1_IRQ  5U
+#define EXTI2_3_IRQ  6U
+#define EXTI4_15_IRQ 7U
@@ -0,0 +1,71 @@
+#pragma once
+
+//---------------------------------------------------------
+
+#include "modregs.h"
+
+//=========================================================
+
+// Embedded flash memory interface
+#define FLASH_IF 0x40022000U
+
+#define FLASH_ACR     (volatile uint32_t*)(uintptr_t)(FLASH_IF + 0x00) // Flash access control register
+#define FLASH_KEYR    (volatile uint32_t*)(uintptr_t)(FLASH_IF + 0x04) // Flash key register
+#define FLASH_OPTKEYR (volatile uint32_t*)(uintptr_t)(FLASH_IF + 0x08) // Flash option key register
+#define FLASH_SR      (volatile uint32_t*)(uintptr_t)(FLASH_IF + 0x0C) // Flash status register
+#define FLASH_CR      (volatile uint32_t*)(uintptr_t)(FLASH_IF + 0x10) // Flash control register
+#define FLASH_AR      (volatile uint32_t*)(uintptr_t)(FLASH_IF + 0x14) // Flash address register
+#define FLASH_OBR     (volatile uint32_t*)(uintptr_t)(FLASH_IF + 0x1C) // Option byte register
+#define FLASH_WRPR    (volatile uint32_t*)(uintptr_t)(FLASH_IF + 0x20) // Write protection register
+
+//---------------------------------------------------------
+
+#define FLASH_BASE      0x08000000U // Main flash memory (aliased at 0x00000000)
+#define FLASH_PAGE_SIZE 0x400U // 1 KB pages on STM32F051
+
+//---------------------------------------------------------
+
+// Flash access control register
+
+#define FLASH_ACR_LATENCY 0 // Latency: 0 - 0 < SYSCLK <= 24 MHz, 1 - 24 MHz < SYSCLK <= 48 MHz
+
+#define FLASH_ACR_LATENCY_0WS 0b000
+#define FLASH_ACR_LATENCY_1WS 0b001
+
+#define SET_FLASH_ACR_LATENCY(value) PUPER_MODIFY_REG(FLASH_ACR, 0b111, value, FLASH_ACR_LATENCY)
+#define GET_FLASH_ACR_LATENCY() SUPER_CHECK_REG(FLASH_ACR, 0b111, FLASH_ACR_LATENCY)
+
+#define FLASH_ACR_PRFTBE 4 // Prefetch buffer enable
+#define FLASH_ACR_PRFTBS 5 // Prefetch buffer status
+
+//---------------------------------------------------------
+
+// Flash key register
+
+#define FLASH_KEY1 0x45670123U
+#define FLASH_KEY2 0xCDEF89ABU
+
+//---------------------------------------------------------
+
+// Flash status register
+
+#define FLASH_SR_BSY      0 // Busy
+#define FLASH_SR_PGERR    2 // Programming error
+#define FLASH_SR_WRPRTERR 4 // Write protection error
+#define FLASH_SR_EOP      5 // End of operation
+
+//---------------------------------------------------------
+
+// Flash control register
+
+#define FLASH_CR_PG         0  // Programming
+#define FLASH_CR_PER        1  // Page erase
+#define FLASH_CR_MER        2  // Mass erase
+#define FLASH_CR_OPTPG      4  // Option byte programming
+#define FLASH_CR_OPTER      5  // Option byte erase
+#define FLASH_CR_STRT       6  // Start
+#define FLASH_CR_LOCK       7  // Lock
+#define FLASH_CR_OPTWRE     9  // Option bytes write enable
+#define FLASH_CR_ERRIE      10 // Error interrupt enable
+#define FLASH_CR_EOPIE      12 // End of operation interrupt enable
+#define FLASH_CR_OBL_LAUNCH 13 // Force option byte loading
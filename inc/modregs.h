@@ -2,6 +2,10 @@
 
 //=========================================================
 
+#include <stdint.h>
+
+//=========================================================
+
 #define SET_BIT(REG, BITNO) ((*(REG)) |=  (1 << (BITNO)))
 #define CLEAR_BIT(REG, BITNO) ((*(REG)) &= ~(1 << (BITNO)))
 #define CHECK_BIT(REG, BITNO) ((*(REG)) & (1 << BITNO))
@@ -22,4 +26,63 @@
     
 
 #define CHECK_REG(REG, MODIFYMASK) ((*(REG)) & (MODIFYMASK))
-#define SUPER_CHECK_REG(REG, MODIFYMASK, OFFSET) ((*(REG)) & ((MODIFYMASK) << (OFFSET)) >> OFFSET)
\ No newline at end of file
+#define SUPER_CHECK_REG(REG, MODIFYMASK, OFFSET) (((*(REG)) >> (OFFSET)) & (MODIFYMASK))
+
+//=========================================================
+
+/*
+    Register fields: updates of one register are OR-ed together into
+    a single read-modify-write (REG_UPDATE) or a plain write (REG_WRITE).
+
+    Field is described by "position, width", e.g.
+
+        #define DMA_CCR_PL_FIELD DMA_CCR_PL, 2
+
+    Each update packs mask into the high word and value into the low one,
+    so constant updates fold into two immediates at compile time:
+
+        REG_UPDATE(DMA_CCR2, FIELD(DMA_CCR_PL_FIELD, DMA_CCR_PL_MED)
+                           | FIELD_ON(DMA_CCR_MINC)
+                           | FIELD_OFF(DMA_CCR_CIRC));
+
+    Field out of the register or constant value wider than the field
+    fails the build. Values known only at run time go through FIELD_VAR,
+    which masks them. Fields of one update must not overlap, REG and
+    FIELDS are evaluated twice.
+*/
+
+// Zero-valued expression, fails to compile if COND is false
+#define FIELD_ASSERT(COND, MSG) (0U * sizeof(struct { _Static_assert(COND, MSG); int field_assert; }))
+
+#define FIELD_MASK_(POS, WIDTH) ((0xFFFFFFFFU >> (32 - (WIDTH))) << (POS))
+
+#define FIELD_PACK_(MASK, VALUE) (((uint64_t)(MASK) << 32) | (uint32_t)(VALUE))
+
+#define FIELD_CHECK_(POS, WIDTH)                                                \
+    FIELD_ASSERT((WIDTH) > 0 && (POS) >= 0 && (POS) + (WIDTH) <= 32, "field out of register")
+
+#define FIELD_(POS, WIDTH, VALUE)                                               \
+    (FIELD_CHECK_(POS, WIDTH) +                                                 \
+     FIELD_ASSERT(((VALUE) & ~(0xFFFFFFFFU >> (32 - (WIDTH)))) == 0, "value does not fit field") + \
+     FIELD_PACK_(FIELD_MASK_(POS, WIDTH), (uint32_t)(VALUE) << (POS)))
+
+#define FIELD_VAR_(POS, WIDTH, VALUE)                                           \
+    (FIELD_CHECK_(POS, WIDTH) +                                                 \
+     FIELD_PACK_(FIELD_MASK_(POS, WIDTH), ((uint32_t)(VALUE) << (POS)) & FIELD_MASK_(POS, WIDTH)))
+
+// Extra level expands FIELD descriptor into position and width
+#define FIELD(FIELD_DESC, VALUE)     FIELD_(FIELD_DESC, VALUE)
+#define FIELD_VAR(FIELD_DESC, VALUE) FIELD_VAR_(FIELD_DESC, VALUE)
+
+#define FIELD_ON(BITNO)  FIELD_(BITNO, 1, 1U)
+#define FIELD_OFF(BITNO) FIELD_(BITNO, 1, 0U)
+
+#define FIELDS_MASK_(FIELDS)  ((uint32_t)((FIELDS) >> 32))
+#define FIELDS_VALUE_(FIELDS) ((uint32_t)(FIELDS))
+
+// Fields not mentioned keep their value
+#define REG_UPDATE(REG, FIELDS) \
+    ((*(REG)) = ((*(REG)) & ~FIELDS_MASK_(FIELDS)) | FIELDS_VALUE_(FIELDS))
+
+// Fields not mentioned become zero, register is not read
+#define REG_WRITE(REG, FIELDS) ((*(REG)) = FIELDS_VALUE_(FIELDS))
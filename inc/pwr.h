@@ -0,0 +1,34 @@
+#pragma once 
+
+//---------------------------------------------------------
+
+#include "modregs.h"
+
+//=========================================================
+
+// Power control
+#define PWR 0x40007000U
+
+#define PWR_CR  (volatile uint32_t*)(uintptr_t)(PWR + 0x00) // Power control register
+#define PWR_CSR (volatile uint32_t*)(uintptr_t)(PWR + 0x04) // Power control/status register
+
+//---------------------------------------------------------
+
+// Power control register
+
+#define PWR_CR_LPDS 0 // Low-power deepsleep: voltage regulator in low-power mode during Stop
+#define PWR_CR_PDDS 1 // Power down deepsleep: 0 - Stop, 1 - Standby
+#define PWR_CR_CWUF 2 // Clear wakeup flag
+#define PWR_CR_CSBF 3 // Clear standby flag
+#define PWR_CR_PVDE 4 // Power voltage detector enable
+#define PWR_CR_DBP  8 // Disable RTC domain write protection
+
+//---------------------------------------------------------
+
+// Power control/status register
+
+#define PWR_CSR_WUF   0 // Wakeup flag
+#define PWR_CSR_SBF   1 // Standby flag
+#define PWR_CSR_PVDO  2 // PVD output
+#define PWR_CSR_EWUP1 8 // Enable WKUP pin 1
+#define PWR_CSR_EWUP2 9 // Enable WKUP pin 2
@@ -119,6 +119,33 @@
 
 //---------------------------------------------------------
 
+// RTC domain control register
+
+#define REG_RCC_BDCR_LSEON  0  // LSE oscillator enable
+#define REG_RCC_BDCR_LSERDY 1  // LSE oscillator ready
+#define REG_RCC_BDCR_RTCEN  15 // RTC clock enable
+#define REG_RCC_BDCR_BDRST  16 // RTC domain software reset
+
+#define REG_RCC_BDCR_RTCSEL 8 // RTC clock source selection, can be changed only after RTC domain reset
+
+#define REG_RCC_BDCR_RTCSEL_NONE 0b00
+#define REG_RCC_BDCR_RTCSEL_LSE  0b01
+#define REG_RCC_BDCR_RTCSEL_LSI  0b10
+#define REG_RCC_BDCR_RTCSEL_HSE  0b11 // HSE / 32
+
+#define SET_REG_RCC_BDCR_RTCSEL(value) PUPER_MODIFY_REG(REG_RCC_BDCR, 0b11, value, REG_RCC_BDCR_RTCSEL)
+#define GET_REG_RCC_BDCR_RTCSEL() SUPER_CHECK_REG(REG_RCC_BDCR, 0b11, REG_RCC_BDCR_RTCSEL)
+
+//---------------------------------------------------------
+
+// Control/status register
+
+#define REG_RCC_CSR_LSION  0  // LSI oscillator enable
+#define REG_RCC_CSR_LSIRDY 1  // LSI oscillator ready
+#define REG_RCC_CSR_RMVF   24 // Remove reset flags
+
+//---------------------------------------------------------
+
 // Clock configuration register 3
 
 #define REG_RCC_CFGR3_USARTSW_PCLK   0b00
@@ -164,7 +191,7 @@
 // PLL multiplication factor
 #define REG_RCC_CFGR_PLLMUL 18 
 // Values from 16 to 2
-#define SET_REG_RCC_CFGR_PLLMUL(value) SUPER_MODIFY_REG(REG_RCC_CFGR, 0b1111, (value) - 2, REG_RCC_CFGR_PLLMUL) 
+#define SET_REG_RCC_CFGR_PLLMUL(value) PUPER_MODIFY_REG(REG_RCC_CFGR, 0b1111, (value) - 2, REG_RCC_CFGR_PLLMUL) 
 #define GET_REG_RCC_CFGR_PLLMUL() ((SUPER_CHECK_REG(REG_RCC_CFGR, 0b1111), REG_RCC_CFGR_PLLMUL) + 2)
 
 // HCLK prescaler
@@ -183,7 +210,7 @@
 
 // System clock switch
 #define REG_RCC_CFGR_SW 0       
-#define SET_REG_RCC_CFGR_SW(value) SUPER_MODIFY_REG(REG_RCC_CFGR, 0b11, value, REG_RCC_CFGR_SW)
+#define SET_REG_RCC_CFGR_SW(value) PUPER_MODIFY_REG(REG_RCC_CFGR, 0b11, value, REG_RCC_CFGR_SW)
 #define GET_REG_RCC_CFGR_SW() SUPER_CHECK_REG(REG_RCC_CFGR, 0b11, REG_RCC_CFGR_SW)
 
 #define REG_RCC_CFGR_SW_HSI   0b00 
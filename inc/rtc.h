@@ -0,0 +1,82 @@
+#pragma once 
+
+//---------------------------------------------------------
+
+#include "modregs.h"
+
+//=========================================================
+
+// Real-time clock
+#define RTC 0x40002800U
+
+#define RTC_TR       (volatile uint32_t*)(uintptr_t)(RTC + 0x00) // Time register
+#define RTC_DR       (volatile uint32_t*)(uintptr_t)(RTC + 0x04) // Date register
+#define RTC_CR       (volatile uint32_t*)(uintptr_t)(RTC + 0x08) // Control register
+#define RTC_ISR      (volatile uint32_t*)(uintptr_t)(RTC + 0x0C) // Initialization and status register
+#define RTC_PRER     (volatile uint32_t*)(uintptr_t)(RTC + 0x10) // Prescaler register
+#define RTC_ALRMAR   (volatile uint32_t*)(uintptr_t)(RTC + 0x1C) // Alarm A register
+#define RTC_WPR      (volatile uint32_t*)(uintptr_t)(RTC + 0x24) // Write protection register
+#define RTC_SSR      (volatile uint32_t*)(uintptr_t)(RTC + 0x28) // Sub second register
+#define RTC_ALRMASSR (volatile uint32_t*)(uintptr_t)(RTC + 0x44) // Alarm A sub second register
+
+#define RTC_IRQ 2U // RTC interrupts combined with EXTI lines 17, 19 & 20
+
+//---------------------------------------------------------
+
+// Write protection register
+
+#define RTC_WPR_KEY1 0xCAU
+#define RTC_WPR_KEY2 0x53U
+#define RTC_WPR_LOCK 0xFFU
+
+#define RTC_UNLOCK()                \
+    do                              \
+    {                               \
+        *RTC_WPR = RTC_WPR_KEY1;    \
+        *RTC_WPR = RTC_WPR_KEY2;    \
+                                    \
+    } while (0)
+
+#define RTC_LOCK() (*RTC_WPR = RTC_WPR_LOCK)
+
+//---------------------------------------------------------
+
+// Control register
+
+#define RTC_CR_BYPSHAD 5  // Read SSR/TR/DR directly from counters
+#define RTC_CR_ALRAE   8  // Alarm A enable
+#define RTC_CR_ALRAIE  12 // Alarm A interrupt enable
+
+//---------------------------------------------------------
+
+// Initialization and status register
+
+#define RTC_ISR_ALRAWF 0 // Alarm A write flag
+#define RTC_ISR_INITS  4 // Initialization status flag
+#define RTC_ISR_RSF    5 // Registers synchronization flag
+#define RTC_ISR_INITF  6 // Initialization flag
+#define RTC_ISR_INIT   7 // Initialization mode
+#define RTC_ISR_ALRAF  8 // Alarm A flag (rc_w0)
+
+//---------------------------------------------------------
+
+// Prescaler register: f_ck_spre = f_rtcclk / ((PREDIV_A + 1) * (PREDIV_S + 1))
+
+#define RTC_PRER_PREDIV_S 0  // Synchronous prescaler, 15 bits
+#define RTC_PRER_PREDIV_A 16 // Asynchronous prescaler, 7 bits
+
+//---------------------------------------------------------
+
+// Alarm A register
+
+#define RTC_ALRMAR_MSK1 7  // Seconds don't care
+#define RTC_ALRMAR_MSK2 15 // Minutes don't care
+#define RTC_ALRMAR_MSK3 23 // Hours don't care
+#define RTC_ALRMAR_MSK4 31 // Date/day don't care
+
+//---------------------------------------------------------
+
+// Alarm A sub second register
+
+#define RTC_ALRMASSR_SS     0  // Sub seconds value, 15 bits
+#define RTC_ALRMASSR_MASKSS 24 // Number of SS bits compared, 4 bits
@@ -0,0 +1,41 @@
+#pragma once 
+
+//---------------------------------------------------------
+
+#include "modregs.h"
+
+//=========================================================
+
+// System Control Block
+
+#define SCB_CPUID (volatile uint32_t*)(uintptr_t)0xE000ED00U // RO - CPUID Base Register
+#define SCB_ICSR  (volatile uint32_t*)(uintptr_t)0xE000ED04U // RW - Interrupt Control and State Register
+#define SCB_AIRCR (volatile uint32_t*)(uintptr_t)0xE000ED0CU // RW - Application Interrupt and Reset Control Register
+#define SCB_SCR   (volatile uint32_t*)(uintptr_t)0xE000ED10U // RW - System Control Register
+#define SCB_CCR   (volatile uint32_t*)(uintptr_t)0xE000ED14U // RO - Configuration and Control Register
+#define SCB_SHPR2 (volatile uint32_t*)(uintptr_t)0xE000ED1CU // RW - System Handler Priority Register 2
+#define SCB_SHPR3 (volatile uint32_t*)(uintptr_t)0xE000ED20U // RW - System Handler Priority Register 3
+
+//---------------------------------------------------------
+
+// Interrupt Control and State Register
+
+#define SCB_ICSR_PENDSTCLR 25 // Remove pending state from SysTick exception
+#define SCB_ICSR_PENDSTSET 26 // SysTick exception is pending
+
+//---------------------------------------------------------
+
+// Application Interrupt and Reset Control Register
+
+#define SCB_AIRCR_VECTKEY       0x05FA0000U // Must be written together with any other bit
+#define SCB_AIRCR_SYSRESETREQ   2           // Request system level reset
+
+#define SCB_SYSTEM_RESET() (*(SCB_AIRCR) = SCB_AIRCR_VECTKEY | (1U << SCB_AIRCR_SYSRESETREQ))
+
+//---------------------------------------------------------
+
+// System Control Register
+
+#define SCB_SCR_SLEEPONEXIT 1 // Enter sleep on return from ISR to Thread mode
+#define SCB_SCR_SLEEPDEEP   2 // Use deep sleep (Stop/Standby) on WFI
+#define SCB_SCR_SEVONPEND   4 // Pending interrupts are wakeup events
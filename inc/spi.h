@@ -83,12 +83,27 @@
 #define SPI_RXNE    0U // Receive buffer not empty
 
 void SPI_init(unsigned divisor);
+void SPI_wait_idle(void);
+void SPI_set_frequency(uint32_t pclk);
 int SPI_send_byte(uint8_t value);
 uint16_t SPI_read(void);
 
+// Bytes go out on DMA channel 3 while the caller returns; buf must stay
+// intact until SPI_dma_busy() is false. Returns -E_DMA_BUSY if a transfer
+// is still running or channel 3 is taken by UART receive.
+int SPI_send_dma(const void* buf, unsigned size);
+int SPI_dma_busy(void);
+
+// Called from the interrupt once the last byte is out, may start the next transfer
+void SPI_dma_on_done(void (*done)(void));
+
+// Transfer complete on channel 3 while it carries SPI1 TX (see uart.c)
+void SPI_dma_handler(void);
+
 enum SND_ERRORS {
-    SPI_OK   = 0,
-    E_NO_SND = 1,
+    SPI_OK     = 0,
+    E_NO_SND   = 1,
+    E_DMA_BUSY = 2,
 };
 
 // Port A
@@ -0,0 +1,104 @@
+#pragma once
+
+//---------------------------------------------------------
+
+#include "modregs.h"
+
+//=========================================================
+
+// General purpose & basic timers, registers missing in a timer read as zero
+
+#define TIM2  0x40000000U
+#define TIM3  0x40000400U
+#define TIM14 0x40002000U
+#define TIM15 0x40014000U
+#define TIM16 0x40014400U
+#define TIM17 0x40014800U
+
+//---------------------------------------------------------
+
+#define TIM_CR1(TIMx)   (volatile uint32_t*)(uintptr_t)((TIMx) + 0x00)
+#define TIM_CR2(TIMx)   (volatile uint32_t*)(uintptr_t)((TIMx) + 0x04)
+#define TIM_SMCR(TIMx)  (volatile uint32_t*)(uintptr_t)((TIMx) + 0x08)
+#define TIM_DIER(TIMx)  (volatile uint32_t*)(uintptr_t)((TIMx) + 0x0C)
+#define TIM_SR(TIMx)    (volatile uint32_t*)(uintptr_t)((TIMx) + 0x10)
+#define TIM_EGR(TIMx)   (volatile uint32_t*)(uintptr_t)((TIMx) + 0x14)
+#define TIM_CCMR1(TIMx) (volatile uint32_t*)(uintptr_t)((TIMx) + 0x18)
+#define TIM_CCMR2(TIMx) (volatile uint32_t*)(uintptr_t)((TIMx) + 0x1C)
+#define TIM_CCER(TIMx)  (volatile uint32_t*)(uintptr_t)((TIMx) + 0x20)
+#define TIM_CNT(TIMx)   (volatile uint32_t*)(uintptr_t)((TIMx) + 0x24)
+#define TIM_PSC(TIMx)   (volatile uint32_t*)(uintptr_t)((TIMx) + 0x28)
+#define TIM_ARR(TIMx)   (volatile uint32_t*)(uintptr_t)((TIMx) + 0x2C)
+#define TIM_RCR(TIMx)   (volatile uint32_t*)(uintptr_t)((TIMx) + 0x30) // TIM1, TIM15..17
+#define TIM_CCR1(TIMx)  (volatile uint32_t*)(uintptr_t)((TIMx) + 0x34)
+#define TIM_CCR2(TIMx)  (volatile uint32_t*)(uintptr_t)((TIMx) + 0x38)
+#define TIM_CCR3(TIMx)  (volatile uint32_t*)(uintptr_t)((TIMx) + 0x3C)
+#define TIM_CCR4(TIMx)  (volatile uint32_t*)(uintptr_t)((TIMx) + 0x40)
+#define TIM_BDTR(TIMx)  (volatile uint32_t*)(uintptr_t)((TIMx) + 0x44) // TIM1, TIM15..17
+
+//---------------------------------------------------------
+
+// Control register 1
+
+#define TIM_CR1_CEN  0 // Counter enable
+#define TIM_CR1_UDIS 1 // Update disable
+#define TIM_CR1_URS  2 // Update request source
+#define TIM_CR1_OPM  3 // One-pulse mode
+#define TIM_CR1_DIR  4 // Direction, 1 - downcounter
+#define TIM_CR1_ARPE 7 // Auto-reload preload enable
+
+//---------------------------------------------------------
+
+// DMA/Interrupt enable register
+
+#define TIM_DIER_UIE   0 // Update interrupt enable
+#define TIM_DIER_CC1IE 1 // Capture/Compare 1 interrupt enable
+#define TIM_DIER_UDE   8 // Update DMA request enable
+#define TIM_DIER_CC1DE 9 // Capture/Compare 1 DMA request enable
+
+//---------------------------------------------------------
+
+// Status register
+
+#define TIM_SR_UIF   0 // Update interrupt flag
+#define TIM_SR_CC1IF 1 // Capture/compare 1 interrupt flag
+
+//---------------------------------------------------------
+
+// Event generation register
+
+#define TIM_EGR_UG 0 // Update generation: reload prescaler & counter
+
+//---------------------------------------------------------
+
+// Capture/compare mode register 1, output compare mode
+
+#define TIM_CCMR1_CC1S  0 // Capture/Compare 1 selection, 0b00 - output
+#define TIM_CCMR1_OC1PE 3 // Output compare 1 preload enable
+#define TIM_CCMR1_OC1M  4 // Output compare 1 mode
+
+#define TIM_CCMR1_CC1S_FIELD TIM_CCMR1_CC1S, 2
+#define TIM_CCMR1_OC1M_FIELD TIM_CCMR1_OC1M, 3
+
+#define TIM_OCM_FROZEN 0b000
+#define TIM_OCM_PWM1   0b110 // Active while CNT < CCR
+#define TIM_OCM_PWM2   0b111
+
+//---------------------------------------------------------
+
+// Capture/compare enable register
+
+#define TIM_CCER_CC1E 0 // Capture/Compare 1 output enable
+#define TIM_CCER_CC1P 1 // Capture/Compare 1 output polarity
+
+//---------------------------------------------------------
+
+// Break and dead-time register
+
+#define TIM_BDTR_MOE 15 // Main output enable, outputs stay off without it
+
+//---------------------------------------------------------
+
+#define TIM_ARR_FIELD 0, 16
+#define TIM_PSC_FIELD 0, 16
+#define TIM_RCR_FIELD 0, 8
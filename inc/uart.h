@@ -51,12 +51,16 @@
 #define USART_CR1_OVER8  15 // Oversampling mode
 #define USART_CR1_DEDT   16 // Driver Enable de-assertion time
 
-#define SET_USART_CR1_DEDT(USARTx, value) SUPER_MODIFY_REG(USART_CR1(USARTx), 0b11111, value, USART_CR1_DEDT)
+#define USART_CR1_DEDT_FIELD USART_CR1_DEDT, 5
+
+#define SET_USART_CR1_DEDT(USARTx, value) REG_UPDATE(USART_CR1(USARTx), FIELD_VAR(USART_CR1_DEDT_FIELD, value))
 #define GET_USART_CR1_DEDT(USARTx) SUPER_CHECK_REG(USART_CR1(USARTx), 0b11111, USART_CR1_DEDT)
 
 #define USART_CR1_DEAT   21 // Driver Enable assertion time
 
-#define SET_USART_CR1_DEAT(USARTx, value) SUPER_MODIFY_REG(USART_CR1(USARTx), 0b11111, value, USART_CR1_DEAT)
+#define USART_CR1_DEAT_FIELD USART_CR1_DEAT, 5
+
+#define SET_USART_CR1_DEAT(USARTx, value) REG_UPDATE(USART_CR1(USARTx), FIELD_VAR(USART_CR1_DEAT_FIELD, value))
 #define GET_USART_CR1_DEAT(USARTx) SUPER_CHECK_REG(USART_CR1(USARTx), 0b11111, USART_CR1_DEAT)
 
 #define USART_CR1_RTOIE  26 // Receiver timeout interrupt enable
@@ -81,7 +85,9 @@
 #define USART_CR2_STOP_2   0b10
 #define USART_CR2_STOP_1_5 0b11
 
-#define SET_USART_CR2_STOP(USARTx, value) SUPER_MODIFY_REG(USART_CR2(USARTx), 0b11, value, USART_CR2_STOP)
+#define USART_CR2_STOP_FIELD USART_CR2_STOP, 2
+
+#define SET_USART_CR2_STOP(USARTx, value) REG_UPDATE(USART_CR2(USARTx), FIELD_VAR(USART_CR2_STOP_FIELD, value))
 #define GET_USART_CR2_STOP(USARTx) SUPER_CHECK_REG(USART_CR2(USARTx), 0b11, USART_CR2_STOP)
 
 #define USART_CR2_LINEN    14 // LIN mode enable
@@ -98,13 +104,17 @@
 #define USART_CR2_ABRMOD_0x7F_FRM_DETECT 0b10
 #define USART_CR2_ABRMOD_0x55_FRM_DETECT 0b11
 
-#define SET_USART_CR2_ABRMOD(USARTx, value) SUPER_MODIFY_REG(USART_CR2(USARTx), 0b11, value, USART_CR2_ABRMOD)
+#define USART_CR2_ABRMOD_FIELD USART_CR2_ABRMOD, 2
+
+#define SET_USART_CR2_ABRMOD(USARTx, value) REG_UPDATE(USART_CR2(USARTx), FIELD_VAR(USART_CR2_ABRMOD_FIELD, value))
 #define GET_USART_CR2_ABRMOD(USARTx) SUPER_CHECK_REG(USART_CR2(USARTx), 0b11, USART_CR2_ABRMOD)
 
 #define USART_CR2_RTOEN 23 // Receiver timeout enable
 #define USART_CR2_ADD   24 // Address of the USART node
 
-#define SET_USART_CR2_ADD(USARTx, value) SUPER_MODIFY_REG(USART_CR2(USARTx), 0b11111111, value, USART_CR2_ADD)
+#define USART_CR2_ADD_FIELD USART_CR2_ADD, 8
+
+#define SET_USART_CR2_ADD(USARTx, value) REG_UPDATE(USART_CR2(USARTx), FIELD_VAR(USART_CR2_ADD_FIELD, value))
 #define GET_USART_CR2_ADD(USARTx) SUPER_CHECK_REG(USART_CR2(USARTx), 0b11111111, USART_CR2_ADD)        
 
 //---------------------------------------------------------
@@ -129,7 +139,9 @@
 #define USART_CR3_DEP     15 // Driver enable polarity selection
 #define USART_CR3_SCAPCNT 17 // Smartcard auto-retry count
 
-#define SET_USART_CR3_SCAPCNT(UARTx, value) SUPER_MODIFY_REG(USART_CR3(USARTx), 0b111, value, USART_CR3_SCAPCNT)
+#define USART_CR3_SCAPCNT_FIELD USART_CR3_SCAPCNT, 3
+
+#define SET_USART_CR3_SCAPCNT(USARTx, value) REG_UPDATE(USART_CR3(USARTx), FIELD_VAR(USART_CR3_SCAPCNT_FIELD, value))
 #define GET_USART_CR3_SCAPCNT(UARTx) SUPER_CHECK_REG(USART_CR3(USARTx), 0b111, USART_CR3_SCAPCNT)
 
 #define USART_CR3_WUS 20 // Wakeup from Stop mode interrupt flag selection
@@ -138,7 +150,9 @@
 #define USART_CR3_WUS_ACTIVE_START_BIT 0b10
 #define USART_CR3_WUS_ACTIVE_RXNE      0b11
 
-#define SET_USART_CR3_WUS(UARTx, value) SUPER_MODIFY_REG(USART_CR3(USARTx), 0b11, value, USART_CR3_WUS)
+#define USART_CR3_WUS_FIELD USART_CR3_WUS, 2
+
+#define SET_USART_CR3_WUS(USARTx, value) REG_UPDATE(USART_CR3(USARTx), FIELD_VAR(USART_CR3_WUS_FIELD, value))
 #define GET_USART_CR3_WUS(UARTx) SUPER_CHECK_REG(USART_CR3(USARTx), 0b11, USART_CR3_WUS)
 
 #define USART_CR3_WUFIE 22 // Wakeup from Stop mode interrupt enable
@@ -157,7 +171,9 @@
 #define SET_USART_BRR_LOW_4(USARTx, value) SUPER_MODIFY_REG(USART_BRR(USARTx), 0b1111, value, USART_BRR_BRR_LOW_4)
 #define GET_USART_BRR_LOW_4(USARTx) SUPER_MODIFY_REG(USART_BRR(USARTx), 0b1111, USART_BRR_BRR_LOW_4)
 
-#define SET_USART_BRR(USARTx, value) SUPER_MODIFY_REG(USART_BRR(USARTx), 0xFFFF, value, 0)
+#define USART_BRR_FIELD 0, 16
+
+#define SET_USART_BRR(USARTx, value) REG_UPDATE(USART_BRR(USARTx), FIELD_VAR(USART_BRR_FIELD, value))
 #define GET_USART_BRR(USARTx) SUPER_CHECK_REG(USART_BRR(USARTx), 0xFFFF, 0)
 //---------------------------------------------------------
 
@@ -165,12 +181,16 @@
 
 #define USART_GTPR_PSC 0 // Prescaler value
 
-#define SET_USART_GTPR_PSC(USARTx, value) SUPER_MODIFY_REG(USART_GTPR(USARTx), 0b11111111, value, USART_GTPR_PSC)
+#define USART_GTPR_PSC_FIELD USART_GTPR_PSC, 8
+
+#define SET_USART_GTPR_PSC(USARTx, value) REG_UPDATE(USART_GTPR(USARTx), FIELD_VAR(USART_GTPR_PSC_FIELD, value))
 #define GET_USART_GTPR_PSC(USARTx) SUPER_CHECK_REG(USART_GTPR(USARTx), 0b11111111, USART_GTPR_PSC)
 
 #define USART_GTPR_GT 8 // Guard time value
 
-#define SET_USART_GTPR_GT(USARTx, value) SUPER_MODIFY_REG(USART_GTPR(USARTx), 0b11111111, value, USART_GTPR_GT)
+#define USART_GTPR_GT_FIELD USART_GTPR_GT, 8
+
+#define SET_USART_GTPR_GT(USARTx, value) REG_UPDATE(USART_GTPR(USARTx), FIELD_VAR(USART_GTPR_GT_FIELD, value))
 #define GET_USART_GTPR_GT(USARTx) SUPER_CHECK_REG(USART_GTPR(USARTx), 0b11111111, USART_GTPR_GT)
 
 //---------------------------------------------------------
@@ -179,12 +199,16 @@
 
 #define USART_RTOR_RTO 0 // Receiver timeout value
 
-#define SET_USART_RTOR_RTO(USARTx, value) SUPER_MODIFY_REG(USART_RTOR(USARTx), 0xFFFFFF, value, USART_RTOR_RTO)
+#define USART_RTOR_RTO_FIELD USART_RTOR_RTO, 24
+
+#define SET_USART_RTOR_RTO(USARTx, value) REG_UPDATE(USART_RTOR(USARTx), FIELD_VAR(USART_RTOR_RTO_FIELD, value))
 #define GET_USART_RTOR_RTO(USARTx) SUPER_CHECK_REG(USART_RTOR(USARTx), 0xFFFFFF, USART_RTOR_RTO)
 
 #define USART_RTOR_BLEN 24 // Block Length
 
-#define SET_USART_RTOR_BLEN(USARTx, value) SUPER_MODIFY_REG(USART_RTOR(USARTx), 0b11111111, value, USART_RTOR_BLEN)
+#define USART_RTOR_BLEN_FIELD USART_RTOR_BLEN, 8
+
+#define SET_USART_RTOR_BLEN(USARTx, value) REG_UPDATE(USART_RTOR(USARTx), FIELD_VAR(USART_RTOR_BLEN_FIELD, value))
 #define GET_USART_RTOR_BLEN(USARTx) SUPER_CHECK_REG(USART_RTOR(USARTx), 0b11111111, USART_RTOR_BLEN)
 
 //---------------------------------------------------------
@@ -0,0 +1,326 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "inc/flash.h"
+#include "api.h"
+#include "flash.h"
+#include "memops.h"
+#include "kvstore.h"
+
+//=========================================================
+
+// First of two flash pages reserved in entry.lds
+extern uint8_t __kvs_start[];
+
+#define KV_PAGE(num) ((uint32_t) __kvs_start + (num) * FLASH_PAGE_SIZE)
+
+#define KV_PAGE_MAGIC 0x4B56U // "KV"
+#define KV_PAGE_HDR   4U      // magic + sequence number
+
+#define KV_FREE      0xFFFFU // Erased half-word
+#define KV_COMMIT    0x0000U // Written after record data
+#define KV_TOMBSTONE 0x7FFFU // Size field of erase record
+
+#define KV_REC_HDR  4U // key + size
+#define KV_REC_TAIL 2U // commit
+
+//---------------------------------------------------------
+
+struct Kv_state
+{
+    uint32_t page;    // Address of active page
+    uint16_t seq;     // Sequence number of active page
+    uint16_t wr_offs; // Offset of first free half-word in active page
+
+    uint16_t index[KV_MAX_KEYS]; // Offset of latest record, 0 - no record
+};
+
+__attribute__ ((section (".api")))
+static struct Kv_state Kv = { 0 };
+
+//---------------------------------------------------------
+
+static int kv_scan(void);
+static int kv_compact(unsigned key, const void* data, uint16_t size);
+static int kv_append(unsigned key, const void* data, uint16_t size);
+
+//=========================================================
+
+static inline uint16_t kv_halfword(uint32_t page, uint32_t offs)
+{
+    return *(const volatile uint16_t*)(uintptr_t) (page + offs);
+}
+
+//---------------------------------------------------------
+
+static inline uint32_t kv_rec_size(uint16_t size)
+{
+    uint32_t data_size = (size == KV_TOMBSTONE)? 0U : ((size + 1U) & ~1U);
+    return KV_REC_HDR + data_size + KV_REC_TAIL;
+}
+
+//---------------------------------------------------------
+
+static inline uint32_t kv_spare_page(void)
+{
+    return (Kv.page == KV_PAGE(0))? KV_PAGE(1) : KV_PAGE(0);
+}
+
+//---------------------------------------------------------
+
+int kv_init(void)
+{
+    bool valid_0 = (kv_halfword(KV_PAGE(0), 0) == KV_PAGE_MAGIC);
+    bool valid_1 = (kv_halfword(KV_PAGE(1), 0) == KV_PAGE_MAGIC);
+
+    int err = 0;
+    flash_unlock();
+
+    if (valid_0 == false && valid_1 == false)
+    {
+        // Blank or damaged storage - format first page
+        Kv.page = KV_PAGE(0);
+        Kv.seq  = 1U;
+
+        err = flash_page_erase(Kv.page);
+        if (err == 0) err = flash_program_halfword(Kv.page + 2U, Kv.seq);
+        if (err == 0) err = flash_program_halfword(Kv.page, KV_PAGE_MAGIC);
+    }
+    else
+    {
+        uint16_t seq_0 = kv_halfword(KV_PAGE(0), 2U);
+        uint16_t seq_1 = kv_halfword(KV_PAGE(1), 2U);
+
+        bool newer_1 = (valid_0 == false) ||
+                       (valid_1 == true && (int16_t) (seq_1 - seq_0) > 0);
+
+        Kv.page = (newer_1)? KV_PAGE(1) : KV_PAGE(0);
+        Kv.seq  = (newer_1)? seq_1 : seq_0;
+
+        // Both valid - compaction was interrupted before old page erase
+        if (valid_0 == true && valid_1 == true)
+            err = flash_page_erase(kv_spare_page());
+    }
+
+    flash_lock();
+
+    if (err < 0)
+        return KV_FLASH_ERR;
+
+    return kv_scan();
+}
+
+//---------------------------------------------------------
+
+static int kv_scan(void)
+{
+    for (unsigned key = 0; key < KV_MAX_KEYS; key++)
+        Kv.index[key] = 0U;
+
+    uint32_t offs = KV_PAGE_HDR;
+
+    while (offs + KV_REC_HDR + KV_REC_TAIL <= FLASH_PAGE_SIZE)
+    {
+        uint16_t key  = kv_halfword(Kv.page, offs);
+        uint16_t size = kv_halfword(Kv.page, offs + 2U);
+
+        if (key == KV_FREE)
+            break;
+
+        uint32_t next = offs + kv_rec_size(size);
+
+        if (size == KV_FREE || next > FLASH_PAGE_SIZE)
+        {
+            // Torn record header - seal the page, next write compacts it
+            offs = FLASH_PAGE_SIZE;
+            break;
+        }
+
+        if (kv_halfword(Kv.page, next - KV_REC_TAIL) == KV_COMMIT && key < KV_MAX_KEYS)
+            Kv.index[key] = (size == KV_TOMBSTONE)? 0U : (uint16_t) offs;
+
+        offs = next;
+    }
+
+    Kv.wr_offs = (uint16_t) offs;
+    return 0;
+}
+
+//---------------------------------------------------------
+
+static int kv_program_record(uint32_t addr, unsigned key, const void* data, uint16_t size)
+{
+    int err = flash_program_halfword(addr, (uint16_t) key);
+    if (err == 0) err = flash_program_halfword(addr + 2U, size);
+
+    if (err == 0 && size != KV_TOMBSTONE && size != 0U)
+        err = flash_program(addr + KV_REC_HDR, data, size);
+
+    // Record becomes visible only after commit half-word is written
+    if (err == 0) err = flash_program_halfword(addr + kv_rec_size(size) - KV_REC_TAIL, KV_COMMIT);
+
+    return err;
+}
+
+//---------------------------------------------------------
+
+static int kv_append(unsigned key, const void* data, uint16_t size)
+{
+    uint32_t addr = Kv.page + Kv.wr_offs;
+
+    // Space is consumed even if programming fails in the middle
+    Kv.wr_offs = (uint16_t) (Kv.wr_offs + kv_rec_size(size));
+
+    int err = kv_program_record(addr, key, data, size);
+    if (err < 0)
+        return KV_FLASH_ERR;
+
+    Kv.index[key] = (size == KV_TOMBSTONE)? 0U : (uint16_t) (addr - Kv.page);
+    return 0;
+}
+
+//---------------------------------------------------------
+
+// New record of key goes into the spare page along with live ones,
+// KV_TOMBSTONE size just leaves the key out
+static int kv_compact(unsigned key, const void* data, uint16_t size)
+{
+    uint32_t src = Kv.page;
+    uint32_t dst = kv_spare_page();
+
+    uint16_t index[KV_MAX_KEYS] = { 0 };
+    uint32_t offs = KV_PAGE_HDR;
+
+    int err = flash_page_erase(dst);
+
+    for (unsigned iter = 0; iter < KV_MAX_KEYS && err == 0; iter++)
+    {
+        if (Kv.index[iter] == 0U || iter == key)
+            continue;
+
+        // Copy committed record as is, including commit half-word
+        uint32_t rec_size = kv_rec_size(kv_halfword(src, Kv.index[iter] + 2U));
+        err = flash_program(dst + offs, (const void*)(uintptr_t) (src + Kv.index[iter]), rec_size);
+
+        index[iter] = (uint16_t) offs;
+        offs += rec_size;
+    }
+
+    // Old value stays valid on the active page until the new one is in:
+    // power loss before the header leaves the store as it was
+    if (err == 0 && size != KV_TOMBSTONE)
+    {
+        err = kv_program_record(dst + offs, key, data, size);
+
+        index[key] = (uint16_t) offs;
+        offs += kv_rec_size(size);
+    }
+
+    // Page header is written last: spare page becomes valid only when complete
+    uint16_t seq = (uint16_t) (Kv.seq + 1U);
+    if (seq == KV_FREE) seq = 1U;
+
+    if (err == 0) err = flash_program_halfword(dst + 2U, seq);
+    if (err == 0) err = flash_program_halfword(dst, KV_PAGE_MAGIC);
+
+    if (err < 0)
+        return KV_FLASH_ERR;
+
+    Kv.page = dst;
+    Kv.seq  = seq;
+    Kv.wr_offs = (uint16_t) offs;
+
+    for (unsigned iter = 0; iter < KV_MAX_KEYS; iter++)
+        Kv.index[iter] = index[iter];
+
+    err = flash_page_erase(src);
+    if (err < 0)
+        return KV_FLASH_ERR;
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+int kv_read(unsigned key, void* data, unsigned size)
+{
+    if (key >= KV_MAX_KEYS || (data == NULL && size != 0U))
+        return KV_INV_ARG;
+
+    if (Kv.index[key] == 0U)
+        return KV_NOT_FOUND;
+
+    uint32_t rec = Kv.page + Kv.index[key];
+    uint16_t rec_size = kv_halfword(rec, 2U);
+
+    const uint8_t* src = (const uint8_t*)(uintptr_t) (rec + KV_REC_HDR);
+    uint8_t* dst = (uint8_t*) data;
+
+    mem_copy(dst, src, (size < rec_size)? size : rec_size);
+
+    return (int) rec_size;
+}
+
+//---------------------------------------------------------
+
+int kv_write(unsigned key, const void* data, unsigned size)
+{
+    if (key >= KV_MAX_KEYS || size > KV_MAX_VALUE_SIZE || (data == NULL && size != 0U))
+        return KV_INV_ARG;
+
+    uint32_t rec_size = kv_rec_size((uint16_t) size);
+    int err = 0;
+
+    flash_unlock();
+
+    if (Kv.wr_offs + rec_size > FLASH_PAGE_SIZE)
+    {
+        // Check that live data fits before dropping anything
+        uint32_t live_size = KV_PAGE_HDR + rec_size;
+
+        for (unsigned iter = 0; iter < KV_MAX_KEYS; iter++)
+        {
+            if (Kv.index[iter] != 0U && iter != key)
+                live_size += kv_rec_size(kv_halfword(Kv.page, Kv.index[iter] + 2U));
+        }
+
+        err = (live_size > FLASH_PAGE_SIZE)? KV_NO_SPACE : kv_compact(key, data, (uint16_t) size);
+    }
+    else
+    {
+        err = kv_append(key, data, (uint16_t) size);
+    }
+
+    flash_lock();
+    return err;
+}
+
+//---------------------------------------------------------
+
+int kv_erase(unsigned key)
+{
+    if (key >= KV_MAX_KEYS)
+        return KV_INV_ARG;
+
+    if (Kv.index[key] == 0U)
+        return 0;
+
+    int err = 0;
+    flash_unlock();
+
+    if (Kv.wr_offs + kv_rec_size(KV_TOMBSTONE) > FLASH_PAGE_SIZE)
+    {
+        // Compaction alone drops the key
+        err = kv_compact(key, NULL, KV_TOMBSTONE);
+    }
+    else
+    {
+        err = kv_append(key, NULL, KV_TOMBSTONE);
+    }
+
+    flash_lock();
+    return err;
+}
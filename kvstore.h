@@ -0,0 +1,48 @@
+#pragma once 
+
+//=========================================================
+
+#include <stdlib.h>
+#include <stdint.h>
+
+//=========================================================
+
+/*
+    Log-structured key-value store over two dedicated flash pages.
+
+    Active page layout:
+        [magic][sequence] [record] [record] ... [0xFFFF - free space]
+
+    Record layout (half-words):
+        [key][size][data ... padded to half-word][commit = 0x0000]
+
+    New values are appended to the log, RAM index keeps the offset 
+    of the latest committed record for every key. When the active page 
+    is full, live records are copied to the spare page (compaction)
+    together with the value being written. Spare page header goes last,
+    so the old page with the old value stays current until then.
+*/
+
+#define KV_MAX_VALUE_SIZE 128U
+
+enum Kv_error
+{
+    KV_INV_ARG   = -1,
+    KV_NOT_FOUND = -2,
+    KV_NO_SPACE  = -3,
+    KV_FLASH_ERR = -4
+};
+
+//=========================================================
+
+// Find active page and rebuild RAM index
+int kv_init(void);
+
+// Read value of key, returns size of stored value
+int kv_read(unsigned key, void* data, unsigned size);
+
+// Append new value of key to the log
+int kv_write(unsigned key, const void* data, unsigned size);
+
+// Append erase record for key
+int kv_erase(unsigned key);
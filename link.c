@@ -0,0 +1,396 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "inc/gpio.h"
+#include "inc/uart.h"
+#include "inc/dma.h"
+#include "inc/arm.h"
+#include "uart.h"
+#include "crc.h"
+#include "clock.h"
+#include "tick.h"
+#include "common/api.h"
+#include "link.h"
+
+//=========================================================
+
+#define LINK_SYNC 0xC5U
+
+#define LINK_HISTORY 8U // Power of two
+#define LINK_MASK    (LINK_HISTORY - 1U)
+
+_Static_assert(2U * LINK_DELAY_MAX + 2U <= LINK_HISTORY, "Packet history must cover 2 * delay + 2 frames");
+
+// sync, frame, inputs, crc frame, state crc, checksum
+#define LINK_PACKET_SIZE (1U + 2U + LINK_HISTORY + 2U + 4U + 1U)
+
+#define LINK_RX_SIZE 64U // Power of two
+#define LINK_RX_MASK (LINK_RX_SIZE - 1U)
+
+// SysTick ticks (100 us) without sending before last packet is repeated
+#define LINK_RESEND_TICKS 167U // One frame at 60 fps
+
+//---------------------------------------------------------
+
+struct Link_state
+{
+    uint8_t rx[LINK_RX_SIZE];
+    uint8_t tx[LINK_PACKET_SIZE];
+
+    uint16_t rx_tail;
+
+    uint16_t frame;        // Current frame
+    uint16_t sent_frame;   // Last frame local input is scheduled for
+    uint16_t remote_frame; // Last frame remote input is known for
+
+    uint8_t local [LINK_HISTORY]; // Inputs indexed by frame & LINK_MASK
+    uint8_t remote[LINK_HISTORY];
+
+    uint32_t local_crc      [LINK_HISTORY]; // State CRC at the start of frame
+    uint16_t local_crc_frame[LINK_HISTORY];
+
+    uint32_t remote_crc; // Remote CRC for a frame not reached yet
+    uint16_t remote_crc_frame;
+    bool remote_crc_pending;
+
+    uint8_t delay;
+    bool stepped;  // Local input for current frame is scheduled
+    bool desync;
+    bool started;
+
+    volatile bool tx_pending;
+    volatile uint16_t tx_idle_ticks;
+
+    struct Uart uart;
+};
+
+__attribute__ ((section (".api")))
+static struct Link_state Link = { 0 };
+
+//---------------------------------------------------------
+
+static int link_uart_init(void);
+
+static void link_check_crc(uint16_t frame, uint32_t crc);
+static void link_receive(void);
+static void link_parse(const uint8_t* packet);
+
+//=========================================================
+
+static inline bool link_frame_after(uint16_t frame, uint16_t ref)
+{
+    return (int16_t) (frame - ref) > 0;
+}
+
+//---------------------------------------------------------
+
+int link_start(unsigned input_delay)
+{
+    if (input_delay > LINK_DELAY_MAX)
+        return LINK_INV_ARG;
+
+    if (Link.started == false)
+    {
+        int err = link_uart_init();
+        if (err < 0) return err;
+    }
+
+    uint32_t primask = irq_save();
+
+    Link.frame        = 0U;
+    Link.sent_frame   = 0U;
+    Link.remote_frame = (uint16_t) (input_delay - 1U); // Nobody presses anything before delay
+
+    for (unsigned iter = 0; iter < LINK_HISTORY; iter++)
+    {
+        Link.local [iter] = 0U;
+        Link.remote[iter] = 0U;
+
+        // Slots of negative frames: no match until overwritten
+        Link.local_crc_frame[iter] = (uint16_t) (iter - LINK_HISTORY);
+    }
+
+    Link.remote_crc_pending = false;
+
+    Link.delay   = (uint8_t) input_delay;
+    Link.stepped = false;
+    Link.desync  = false;
+    Link.started = true;
+
+    // Drop whatever came before the start
+    Link.rx_tail = (uint16_t) (LINK_RX_SIZE - GET_DMA_CNDTR_NDT(DMA_CNDTR5));
+    Link.tx_pending = false;
+
+    irq_restore(primask);
+
+    // Packets go out from SysTick
+    tick_request(1U);
+    return 0;
+}
+
+//---------------------------------------------------------
+
+static int link_uart_init(void)
+{
+    struct Uart_conf uart_conf = { .uartno = 2U,
+                                   .baudrate  = LINK_BAUDRATE,
+                                   .frequency = clock_get_frequency(),
+                                   .tx = {.port = GPIOA, .pin = 14U},
+                                   .rx = {.port = GPIOA, .pin = 15U},
+                                   .af_tx = GPIO_AF1,
+                                   .af_rx = GPIO_AF1 };
+
+    int err = uart_setup(&Link.uart, &uart_conf);
+    if (err < 0) return err;
+
+    uint32_t usart = Link.uart.UARTx;
+
+    // USART1 owns DMA channels 2 & 3 in uart.c, USART2 is mapped to 4 & 5.
+    // Both are polled, no DMA interrupts are needed.
+
+    SET_DMA_CPAR(DMA_CPAR4, (uint32_t) USART_TDR(usart));
+    SET_DMA_CCR_PL(DMA_CCR4, DMA_CCR_PL_HIGH);
+    SET_BIT(DMA_CCR4, DMA_CCR_DIR);
+    SET_BIT(DMA_CCR4, DMA_CCR_MINC);
+    SET_DMA_CCR_MSIZE(DMA_CCR4, DMA_CCR_MSIZE_8);
+    SET_DMA_CCR_PSIZE(DMA_CCR4, DMA_CCR_PSIZE_32);
+
+    SET_DMA_CPAR(DMA_CPAR5, (uint32_t) USART_RDR(usart));
+    SET_DMA_CMAR(DMA_CMAR5, (uint32_t) Link.rx);
+    SET_DMA_CNDTR_NDT(DMA_CNDTR5, LINK_RX_SIZE);
+    SET_DMA_CCR_PL(DMA_CCR5, DMA_CCR_PL_HIGH);
+    CLEAR_BIT(DMA_CCR5, DMA_CCR_DIR);
+    SET_BIT(DMA_CCR5, DMA_CCR_MINC);
+    SET_BIT(DMA_CCR5, DMA_CCR_CIRC);
+    SET_DMA_CCR_MSIZE(DMA_CCR5, DMA_CCR_MSIZE_8);
+    SET_DMA_CCR_PSIZE(DMA_CCR5, DMA_CCR_PSIZE_32);
+    SET_BIT(DMA_CCR5, DMA_CCR_EN);
+
+    SET_BIT(USART_CR3(usart), USART_CR3_DMAT);
+    SET_BIT(USART_CR3(usart), USART_CR3_DMAR);
+
+    SET_BIT(USART_CR1(usart), USART_CR1_TE);
+    SET_BIT(USART_CR1(usart), USART_CR1_RE);
+
+    while (CHECK_BIT(USART_ISR(usart), USART_ISR_TEACK) == 0U
+        || CHECK_BIT(USART_ISR(usart), USART_ISR_REACK) == 0U)
+        continue;
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+int link_step(unsigned buttons, const void* state, unsigned state_size)
+{
+    if (Link.started == false)
+        return LINK_NOT_STARTED;
+
+    if (state == NULL && state_size != 0U)
+        return LINK_INV_ARG;
+
+    if (Link.desync == true)
+        return LINK_DESYNC;
+
+    // (1) First call in a frame: schedule local input & state CRC for sending
+    if (Link.stepped == false)
+    {
+        uint32_t crc = (state_size != 0U)? crc32_calc((uint8_t*) state, state_size) : 0U;
+        uint16_t target = (uint16_t) (Link.frame + Link.delay);
+
+        // SysTick may be building a packet from these
+        uint32_t primask = irq_save();
+
+        Link.local[target & LINK_MASK] = (uint8_t) buttons;
+        Link.sent_frame = target;
+
+        Link.local_crc      [Link.frame & LINK_MASK] = crc;
+        Link.local_crc_frame[Link.frame & LINK_MASK] = Link.frame;
+
+        Link.tx_pending = true;
+        Link.stepped = true;
+
+        irq_restore(primask);
+
+        if (Link.remote_crc_pending == true && Link.remote_crc_frame == Link.frame)
+        {
+            Link.remote_crc_pending = false;
+            link_check_crc(Link.frame, Link.remote_crc);
+        }
+    }
+
+    // (2) Take in what the other board has sent
+    link_receive();
+
+    if (Link.desync == true)
+        return LINK_DESYNC;
+
+    if (link_frame_after(Link.frame, Link.remote_frame))
+        return LINK_WAIT;
+
+    // (3) Both inputs are known
+    unsigned slot = Link.frame & LINK_MASK;
+    int inputs = (int) (Link.local[slot] | (Link.remote[slot] << 8));
+
+    // SysTick picks the CRC to send from these two
+    uint32_t primask = irq_save();
+
+    Link.frame++;
+    Link.stepped = false;
+
+    irq_restore(primask);
+
+    return inputs;
+}
+
+//---------------------------------------------------------
+
+static void link_check_crc(uint16_t frame, uint32_t crc)
+{
+    unsigned slot = frame & LINK_MASK;
+
+    if (Link.local_crc_frame[slot] == frame && Link.local_crc[slot] != crc)
+        Link.desync = true;
+}
+
+//---------------------------------------------------------
+
+static void link_receive(void)
+{
+    uint16_t head = (uint16_t) (LINK_RX_SIZE - GET_DMA_CNDTR_NDT(DMA_CNDTR5));
+
+    while (((head - Link.rx_tail) & LINK_RX_MASK) >= LINK_PACKET_SIZE)
+    {
+        uint8_t packet[LINK_PACKET_SIZE];
+        uint8_t sum = 0U;
+
+        for (unsigned iter = 0; iter < LINK_PACKET_SIZE; iter++)
+        {
+            packet[iter] = Link.rx[(Link.rx_tail + iter) & LINK_RX_MASK];
+            sum = (uint8_t) (sum + packet[iter]);
+        }
+
+        // Not a packet start or damaged: resync on next byte
+        if (packet[0] != LINK_SYNC || sum != 0U)
+        {
+            Link.rx_tail = (Link.rx_tail + 1U) & LINK_RX_MASK;
+            continue;
+        }
+
+        link_parse(packet);
+        Link.rx_tail = (Link.rx_tail + LINK_PACKET_SIZE) & LINK_RX_MASK;
+    }
+}
+
+//---------------------------------------------------------
+
+static void link_parse(const uint8_t* packet)
+{
+    uint16_t frame = (uint16_t) (packet[1] | (packet[2] << 8));
+    const uint8_t* inputs = &packet[3];
+
+    // inputs[k] belong to frame - k, older ones are already known
+    for (unsigned iter = 0; iter < LINK_HISTORY; iter++)
+    {
+        uint16_t input_frame = (uint16_t) (frame - iter);
+
+        if (link_frame_after(input_frame, Link.remote_frame))
+            Link.remote[input_frame & LINK_MASK] = inputs[iter];
+    }
+
+    if (link_frame_after(frame, Link.remote_frame))
+        Link.remote_frame = frame;
+
+    const uint8_t* tail = &packet[3 + LINK_HISTORY];
+
+    uint16_t crc_frame = (uint16_t) (tail[0] | (tail[1] << 8));
+    uint32_t crc = (uint32_t) tail[2]         | ((uint32_t) tail[3] << 8)
+                | ((uint32_t) tail[4] << 16) | ((uint32_t) tail[5] << 24);
+
+    // Other board may be a frame ahead: compare once we get there
+    if (link_frame_after(crc_frame, Link.frame) ||
+        (crc_frame == Link.frame && Link.stepped == false))
+    {
+        Link.remote_crc = crc;
+        Link.remote_crc_frame = crc_frame;
+        Link.remote_crc_pending = true;
+    }
+    else
+    {
+        link_check_crc(crc_frame, crc);
+    }
+}
+
+//---------------------------------------------------------
+
+void link_update(void)
+{
+    if (Link.started == false)
+        return;
+
+    // Called every tick while the link is up
+    tick_request(1U);
+
+    if (Link.tx_idle_ticks < LINK_RESEND_TICKS)
+        Link.tx_idle_ticks++;
+
+    // Lost packets are recovered by repeating the last one
+    if (Link.tx_pending == false && Link.tx_idle_ticks < LINK_RESEND_TICKS)
+        return;
+
+    // Previous packet is still being sent
+    if (CHECK_BIT(DMA_CCR4, DMA_CCR_EN) != 0U && GET_DMA_CNDTR_NDT(DMA_CNDTR4) != 0U)
+        return;
+
+    CLEAR_BIT(DMA_CCR4, DMA_CCR_EN);
+
+    // Packet is rebuilt from history: only the latest state is ever sent
+    uint8_t* tx = Link.tx;
+    uint16_t frame = Link.sent_frame;
+    uint16_t crc_frame = (uint16_t) (Link.stepped? Link.frame : Link.frame - 1U);
+
+    // Slot of a frame not scheduled yet holds a CRC LINK_HISTORY frames old
+    if (Link.local_crc_frame[crc_frame & LINK_MASK] != crc_frame)
+        crc_frame--;
+
+    uint32_t crc = Link.local_crc[crc_frame & LINK_MASK];
+
+    tx[0] = LINK_SYNC;
+    tx[1] = (uint8_t) frame;
+    tx[2] = (uint8_t) (frame >> 8);
+
+    for (unsigned iter = 0; iter < LINK_HISTORY; iter++)
+        tx[3 + iter] = Link.local[(frame - iter) & LINK_MASK];
+
+    uint8_t* tail = &tx[3 + LINK_HISTORY];
+
+    tail[0] = (uint8_t) crc_frame;
+    tail[1] = (uint8_t) (crc_frame >> 8);
+    tail[2] = (uint8_t) crc;
+    tail[3] = (uint8_t) (crc >> 8);
+    tail[4] = (uint8_t) (crc >> 16);
+    tail[5] = (uint8_t) (crc >> 24);
+
+    uint8_t sum = 0U;
+    for (unsigned iter = 0; iter < LINK_PACKET_SIZE - 1U; iter++)
+        sum = (uint8_t) (sum + tx[iter]);
+
+    tx[LINK_PACKET_SIZE - 1U] = (uint8_t) (0U - sum);
+
+    SET_DMA_CMAR(DMA_CMAR4, (uint32_t) tx);
+    SET_DMA_CNDTR_NDT(DMA_CNDTR4, LINK_PACKET_SIZE);
+    SET_BIT(DMA_CCR4, DMA_CCR_EN);
+
+    Link.tx_pending = false;
+    Link.tx_idle_ticks = 0U;
+}
+
+//---------------------------------------------------------
+
+bool link_is_active(void)
+{
+    return Link.started;
+}
@@ -0,0 +1,43 @@
+#pragma once 
+
+//=========================================================
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//=========================================================
+
+/*
+    Lockstep link between two boards over USART2 (PA14 - TX, PA15 - RX).
+    NOTE: PA14 is SWCLK, debugger is cut off once link is started.
+
+    Each frame both boards send a packet with their buttons for 
+    frame + input_delay, inputs of previous frames for redundancy 
+    and CRC of the state at the start of current frame. A frame 
+    advances once inputs of both boards are known for it.
+*/
+
+#define LINK_BAUDRATE  115200U // Input delay is up to LINK_DELAY_MAX of common/api.h
+
+enum Link_error
+{
+    LINK_INV_ARG     = -1,
+    LINK_NOT_STARTED = -2,
+    LINK_WAIT        = -3, // Remote input for current frame is not here yet, LINK_STEP_WAIT for guests
+    LINK_DESYNC      = -4  // State CRCs differ, LINK_STEP_DESYNC for guests
+};
+
+//=========================================================
+
+// Set up USART2 on first call, restart from frame 0
+int link_start(unsigned input_delay);
+
+// Advance frame: returns local buttons | remote buttons << 8,
+// state is what both boards are expected to agree on
+int link_step(unsigned buttons, const void* state, unsigned state_size);
+
+// Transmit queued packet or resend the last one, called on SysTick
+void link_update(void);
+
+// Link receive would be lost in Stop mode
+bool link_is_active(void);
@@ -0,0 +1,173 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "uart.h"
+#include "crc.h"
+#include "fwup.h"
+#include "common/assets.h"
+#include "log.h"
+#include "loader.h"
+
+//=========================================================
+
+static const uint32_t Loader_ack = LOADER_ACK;
+static const uint32_t Loader_nak = LOADER_NAK;
+
+//=========================================================
+
+static int loader_wait_recv(void)
+{
+    int res = 0;
+
+    do 
+    {
+        res = is_recv_complete();
+        if (res < 0) return res;
+
+    } while (res == 0);
+
+    return res;
+}
+
+//---------------------------------------------------------
+
+static int loader_check_crc(uint8_t* code, uint32_t size)
+{
+    crc_init(0xFFFFFFFF);
+
+    uint32_t calc_hash = crc32_calc(code, (size_t) (size - 4));
+    uint32_t recv_hash = *(uint32_t*) (code + size - 4);
+
+    if (calc_hash != recv_hash)
+        return LOADER_CRC_ERR;
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+int loader_receive(const struct Loader* loader)
+{
+    // First word tells guest code from host firmware update
+    int err = uart_recv_buffer(loader->uart, loader->buffer, sizeof(uint32_t));
+    if (err < 0) return err;
+
+    int res = loader_wait_recv();
+    if (res < 0) return res;
+
+    if (res < 4)
+        return LOADER_TOO_SHORT;
+
+    if (*(uint32_t*) loader->buffer == FWUP_MAGIC)
+        return loader->fwup(loader->uart);
+
+    if (*(uint32_t*) loader->buffer == ASSETS_MAGIC)
+    {
+        if (loader->assets == NULL)
+            return LOADER_UNSUPPORTED;
+
+        err = loader->assets(loader->uart);
+        return (err < 0)? err : 0;
+    }
+
+    err = uart_recv_buffer(loader->uart, loader->buffer + 4, loader->capacity - 4);
+    if (err < 0) return err;
+
+    res = loader_wait_recv();
+    if (res < 0) return res;
+
+    res += 4;
+
+    if (res < 8)
+        return LOADER_TOO_SHORT; // Not enough data - 4 bytes are hash at the end 
+
+    err = loader_check_crc(loader->buffer, (uint32_t) res);
+    if (err < 0) return err;
+
+    if (loader->accept != NULL)
+    {
+        err = loader->accept(loader->buffer, (uint32_t) res - 4U);
+        if (err < 0) return err;
+    }
+
+    return res;
+}
+
+//---------------------------------------------------------
+
+// Skip the rest of a failed upload
+static void loader_drain(const struct Loader* loader)
+{
+    // Sender may still be transmitting: take in bytes until the line is quiet
+    if (uart_recv_buffer(loader->uart, loader->buffer, loader->capacity) < 0)
+        return;
+
+    size_t received = 0U;
+    unsigned quiet_since = loader->ticks();
+
+    while (loader->ticks() - quiet_since < loader->quiet_ticks)
+    {
+        // Buffer is full, or line error: the rest is garbage anyway
+        if (is_recv_complete() != 0)
+        {
+            if (uart_recv_buffer(loader->uart, loader->buffer, loader->capacity) < 0)
+                return;
+
+            received = 0U;
+            quiet_since = loader->ticks();
+            continue;
+        }
+
+        size_t now = uart_recv_pos();
+
+        if (now != received)
+        {
+            received = now;
+            quiet_since = loader->ticks();
+        }
+    }
+
+    uart_recv_abort();
+}
+
+//---------------------------------------------------------
+
+static void loader_reply(const struct Loader* loader, const uint32_t* reply)
+{
+    // Log drain may be holding the channel
+    while (uart_trns_buffer(loader->uart, reply, sizeof(uint32_t)) == UART_TRNS_NOT_COMPL)
+        continue;
+
+    while (is_trns_complete() == 0)
+        continue;
+}
+
+//---------------------------------------------------------
+
+int loader_run(const struct Loader* loader)
+{
+    int res = 0;
+
+    // Board waits for the same upload again until it gets through,
+    // asset pack is answered and followed by guest code
+    while ((res = loader_receive(loader)) <= 0)
+    {
+        if (res == 0)
+        {
+            loader_reply(loader, &Loader_ack);
+            continue;
+        }
+
+        LOG("loader: upload rejected, error %d", res);
+
+        loader_drain(loader);
+        loader_reply(loader, &Loader_nak);
+    }
+
+    loader_reply(loader, &Loader_ack);
+
+    return res;
+}
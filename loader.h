@@ -0,0 +1,75 @@
+#pragma once 
+
+//=========================================================
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "uart.h"
+
+//=========================================================
+
+/*
+    Guest code loader over USART:
+
+        [code ... padded to word][crc32 of code]
+
+    Code is either Thumb with umain at its start or a bytecode image
+    (see vm.h), told apart by VM_MAGIC when it is run.
+
+    Code is received by DMA straight into its place, receive ends once 
+    the buffer is full or the line is idle for 1.5 s. Packet starting 
+    with FWUP_MAGIC is handed over to firmware update (see fwup.h),
+    one with ASSETS_MAGIC to asset pack upload (see assets.h); the
+    pack is acknowledged and guest code is awaited after it.
+
+    Code that passed CRC may still be refused by the accept hook, e.g.
+    when its memory request does not fit (see common/memmap.h).
+
+    Rejected upload is drained until the line is quiet, then answered 
+    with LOADER_NAK and the uploader sends it again. Accepted code is 
+    answered with LOADER_ACK.
+
+    Only UART and CRC calls touch hardware, host builds run the same 
+    loader on a pseudo-terminal (see sim/ptyloader.c).
+*/
+
+#define LOADER_ACK 0x214B4341U // "ACK!"
+#define LOADER_NAK 0x214B414EU // "NAK!"
+
+// Uart errors are passed through as well
+enum Loader_error
+{
+    LOADER_TOO_SHORT   = -32, // Less than a word of code and crc
+    LOADER_CRC_ERR     = -33,
+    LOADER_UNSUPPORTED = -34  // Asset pack with no assets handler
+};
+
+struct Loader
+{
+    struct Uart* uart;
+
+    uint8_t* buffer;
+    size_t capacity;
+
+    // Tick counter (tick_now), line is quiet after quiet_ticks without bytes
+    unsigned (*ticks)(void);
+    unsigned quiet_ticks;
+
+    // Takes over after FWUP_MAGIC, does not return on success
+    int (*fwup)(struct Uart* uart);
+
+    // Takes over after ASSETS_MAGIC, NULL if packs are not accepted
+    int (*assets)(struct Uart* uart);
+
+    // Checks code without crc, negative error to reject it, NULL to take any
+    int (*accept)(const uint8_t* code, uint32_t size);
+};
+
+//=========================================================
+
+// Receive uploads until guest code is accepted, returns code size with crc
+int loader_run(const struct Loader* loader);
+
+// Single upload attempt, no reply: code size with crc, 0 for accepted asset pack
+int loader_receive(const struct Loader* loader);
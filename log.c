@@ -0,0 +1,101 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "inc/arm.h"
+#include "uart.h"
+#include "ring.h"
+#include "tick.h"
+#include "log.h"
+
+//=========================================================
+
+#define LOG_HDR_WORDS 2U // header + ID
+
+//---------------------------------------------------------
+
+struct Log_state
+{
+    uint32_t words[LOG_RING_WORDS];
+
+    // Messages are whole words: chunks stay word-aligned
+    struct Ring ring;
+
+    uint16_t inflight; // Bytes handed to DMA
+    uint16_t seq;      // Lets decoder spot dropped messages
+
+    struct Uart* uart;
+};
+
+__attribute__ ((section (".api")))
+static struct Log_state Log = { .ring = RING_INIT(Log.words, sizeof(Log.words), 0U) };
+
+//=========================================================
+
+void log_init(struct Uart* uart)
+{
+    Log.uart = uart;
+}
+
+//---------------------------------------------------------
+
+void log_write(uint32_t id, unsigned argc, const uint32_t* args)
+{
+    if (argc > LOG_MAX_ARGS)
+        argc = LOG_MAX_ARGS;
+
+    uint32_t msg[LOG_HDR_WORDS + LOG_MAX_ARGS];
+    msg[1] = id;
+
+    for (unsigned iter = 0; iter < argc; iter++)
+        msg[LOG_HDR_WORDS + iter] = args[iter];
+
+    // Producers from thread and handler mode: sequence number and
+    // message go into the ring together, with IRQs masked
+    uint32_t primask = irq_save();
+
+    uint16_t seq = Log.seq++;
+    msg[0] = LOG_SYNC | (argc << 8) | ((uint32_t) seq << 16);
+
+    ring_write_all(&Log.ring, msg, (LOG_HDR_WORDS + argc) * sizeof(uint32_t));
+
+    irq_restore(primask);
+
+    // Drained from SysTick
+    tick_request(1U);
+}
+
+//---------------------------------------------------------
+
+void log_flush(void)
+{
+    if (Log.uart == NULL)
+        return;
+
+    // Channel is busy: look again on the next tick if there is anything to send
+    if (is_trns_complete() == 0)
+    {
+        if (Log.inflight != 0U || ring_used(&Log.ring) != 0U)
+            tick_request(1U);
+
+        return;
+    }
+
+    // Previous chunk is out, its words can be reused
+    ring_consume(&Log.ring, Log.inflight);
+    Log.inflight = 0U;
+
+    // DMA needs contiguous memory: send up to the end of the ring first
+    unsigned chunk = 0U;
+    const void* start = ring_peek(&Log.ring, &chunk);
+
+    if (chunk == 0U)
+        return;
+
+    if (uart_trns_buffer(Log.uart, start, chunk) == 0)
+        Log.inflight = (uint16_t) chunk;
+
+    tick_request(1U);
+}
@@ -0,0 +1,26 @@
+#pragma once 
+
+//=========================================================
+
+#include <stdint.h>
+
+#include "common/log.h"
+#include "uart.h"
+
+//=========================================================
+
+#define LOG_RING_WORDS 32U // Power of two
+
+// Host side: LOG("restore %u us", restore_us);
+#define LOG(fmt, ...) LOG_CALL(log_write, fmt, __VA_ARGS__)
+
+//=========================================================
+
+// Start draining queued messages to uart
+void log_init(struct Uart* uart);
+
+// Queue message, dropped if the ring is full
+void log_write(uint32_t id, unsigned argc, const uint32_t* args);
+
+// Start DMA transmit of queued words, called on SysTick
+void log_flush(void);
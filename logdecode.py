@@ -0,0 +1,151 @@
+#!/usr/bin/python3
+
+#=========================================================
+
+import argparse
+import re
+import struct
+import sys
+
+#=========================================================
+
+LOG_SYNC = 0xA5 # see common/log.h
+
+# printf conversion, length modifiers are dropped
+CONV = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|t|j)?([diuxXoc%])')
+
+#=========================================================
+
+def elf_logstr(path):
+    # Returns {address: format string} from .logstr section of ELF32
+    with open(path, mode='rb') as elf:
+        data = elf.read()
+
+    if data[:4] != b'\x7fELF' or data[4] != 1:
+        raise ValueError(path + ": not an ELF32 file")
+
+    shoff, = struct.unpack_from('<I', data, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from('<HHH', data, 0x2E)
+
+    def section(ind):
+        # name, type, flags, addr, offset, size
+        return struct.unpack_from('<IIIIII', data, shoff + ind * shentsize)
+
+    strtab = section(shstrndx)
+
+    strings = {}
+
+    for ind in range(shnum):
+        name, _, _, addr, offset, size = section(ind)
+
+        end = data.index(b'\0', strtab[4] + name)
+        if data[strtab[4] + name : end] != b'.logstr':
+            continue
+
+        pos = 0
+        for fmt in data[offset : offset + size].split(b'\0'):
+            if fmt:
+                strings[addr + pos] = fmt.decode(errors='replace')
+            pos += len(fmt) + 1
+
+    return strings
+
+#---------------------------------------------------------
+
+def format_message(fmt, args):
+    args = iter(args)
+
+    def conv(match):
+        flags, spec = match.groups()
+        if spec == '%':
+            return '%'
+
+        word = next(args, 0)
+
+        if spec in 'di' and word & 0x80000000:
+            word -= 1 << 32
+        if spec == 'u':
+            spec = 'd'
+
+        return ('%' + flags + spec) % word
+
+    return CONV.sub(conv, fmt)
+
+#---------------------------------------------------------
+
+def read_exact(dev, size):
+    data = b''
+    while len(data) < size:
+        chunk = dev.read(size - len(data))
+        if not chunk:
+            return None
+        data += chunk
+
+    return data
+
+#---------------------------------------------------------
+
+def decode(dev, strings, out):
+    seq_next = None
+
+    while True:
+        sync = read_exact(dev, 1)
+        if sync is None:
+            return
+
+        if sync[0] != LOG_SYNC:
+            continue
+
+        hdr = read_exact(dev, 7)
+        if hdr is None:
+            return
+
+        argc, seq, msg_id = struct.unpack('<BHI', hdr)
+        if argc > 4:
+            continue # not a frame start, resync
+
+        args = read_exact(dev, 4 * argc)
+        if args is None:
+            return
+
+        if seq_next is not None and seq != seq_next:
+            out.write("<%d message(s) dropped>\n" % ((seq - seq_next) & 0xFFFF))
+        seq_next = (seq + 1) & 0xFFFF
+
+        fmt = strings.get(msg_id)
+        if fmt is None:
+            out.write("<unknown id 0x%08x>\n" % msg_id)
+            continue
+
+        out.write(format_message(fmt, struct.unpack('<%dI' % argc, args)) + '\n')
+        out.flush()
+
+#=========================================================
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode tokenized log stream")
+    parser.add_argument('elf', nargs='+', help="build/uart.elf [build/user.elf]")
+    parser.add_argument('--port', default='/dev/ttyUSB0')
+    parser.add_argument('--file', help="decode captured stream instead of port")
+    args = parser.parse_args()
+
+    strings = {}
+    for path in args.elf:
+        strings.update(elf_logstr(path))
+
+    if args.file:
+        dev = open(args.file, mode='rb')
+    else:
+        import serial
+        dev = serial.Serial(port=args.port, baudrate=9600, parity=serial.PARITY_ODD,
+                            stopbits=serial.STOPBITS_ONE, bytesize=serial.EIGHTBITS)
+
+    try:
+        decode(dev, strings, sys.stdout)
+    except KeyboardInterrupt:
+        pass
+
+#---------------------------------------------------------
+
+if __name__ == '__main__':
+    main()
@@ -7,7 +7,6 @@
 #include "inc/rcc.h"
 #include "inc/uart.h"
 #include "inc/sleep.h"
-#include "inc/systick.h"
 #include "inc/spi.h"
 
 #include "screen.h"
@@ -15,27 +14,38 @@
 #include "uart.h"
 #include "crc.h"
 #include "button.h"
+#include "fwup.h"
+#include "clock.h"
+#include "log.h"
+#include "serial.h"
+#include "link.h"
+#include "loader.h"
+#include "vm.h"
+#include "assets.h"
+#include "memstat.h"
+#include "memmap.h"
+#include "frame.h"
+#include "tick.h"
+#include "probe.h"
 
 extern int api_init(void);
-extern void api_update(unsigned handler_ticks);
+extern void api_update(unsigned now);
 
 extern struct API API_host;
 
+// Symbols from entry.lds
+extern uint8_t __framebuf_start[];
+extern uint8_t __framebuf_size[];
+
 //=========================================================
 
 // #define TEST_UART
 
 //=========================================================
 
-#define CPU_FREQENCY 48000000U // CPU frequency: 48 MHz
-#define REF_FREQUENCY_DIV 8 // SysTick reference clock frequency: 6MHz
-
 #define BLUE_LED_GPIOC_PIN   8U
 #define GREEN_LED_GPIOC_PIN  9U
 
-#define SYSTICK_PERIOD_US 100U
-#define SYSTICK_FREQ (1000000U / SYSTICK_PERIOD_US)
-
 #define UART_BAUDRATE 9600U
 
 //=========================================================
@@ -44,125 +54,61 @@ extern struct API API_host;
 #define SRAM_VADDR 0x20000000U
 #define SRAM_PADDR 0x20000000U
 
-#define USER_OFFS  0x00000500U
-#define USER_START SRAM_VADDR + USER_OFFS
-#define USER_STACK SRAM_VADDR + SRAM_SIZE
+#define USER_OFFS  0x00000A00U
+#define USER_START (SRAM_VADDR + USER_OFFS)
+#define USER_STACK (SRAM_VADDR + SRAM_SIZE)
 
-#define USER_EXEC_START USER_START + 1
-#define USER_MAX_STACK_SIZE 0x400
-#define USER_MAX_PROG_SIZE SRAM_SIZE - USER_OFFS - USER_MAX_STACK_SIZE
+#define USER_EXEC_START (USER_START + 1)
+// Host stack while loading must fit the smallest guest stack: image may take the rest,
+// memmap_plan() refuses it if the stack the guest asks for does not fit
+#define USER_LOAD_STACK_SIZE MEM_MIN_STACK
+#define USER_MAX_PROG_SIZE (SRAM_SIZE - USER_OFFS - USER_LOAD_STACK_SIZE)
 
 //=========================================================
 
-static void board_clocking_init(void);
-static void board_gpio_init(void);
-static void systick_init(uint32_t period_us);
-
-static int uart_init(struct Uart* uart);
+#define LOADER_QUIET_TICKS (TICK_FREQ / 2U) // Line is idle for 0.5 s
 
-static int receive_code(struct Uart* uart);
-static int code_check_crc(uint8_t* code, uint32_t size);
-
-static void run_code(void);
-
-#ifdef TEST_UART
-    
-    static int run_uart_tests(struct Uart* uart);
-
-#endif 
+#define MEMSTAT_REPORT_TICKS TICK_FREQ // Stack high-water mark checked every second
 
 //=========================================================
 
-static void board_clocking_init()
-{
-    // (1) Clock HSE and wait for oscillations to setup.
-    SET_BIT(REG_RCC_CR, REG_RCC_CR_HSEON);
-    while (CHECK_BIT(REG_RCC_CR, REG_RCC_CR_HSERDY))
-        continue;
-
-    // (2) Configure PLL:
-    // PREDIV output: HSE/2 = 4 MHz
-    SET_REG_RCC_CFGR2_PREDIV(2);
-
-    // (3) Select PREDIV output as PLL input (4 MHz):
-    SET_REG_RCC_CFGR_PLLSRC(REG_RCC_CFGR_PLLSRC_HSE_PREDIV);
+static int loader_fwup(struct Uart* uart);
+static int loader_accept(const uint8_t* code, uint32_t size);
 
-    // (4) Set PLLMUL to 12:
-    // SYSCLK frequency = 48 MHz
-    SET_REG_RCC_CFGR_PLLMUL(12);
+// Outlives main(): guest stack reuses main() stack area, 
+// and clock switch reconfigures UART while guest runs
+__attribute__ ((section (".api")))
+static struct Uart Host_uart = { 0 };
 
-    // (5) Enable PLL:
-    SET_BIT(REG_RCC_CR, REG_RCC_CR_PLLON);
-    while(CHECK_BIT(REG_RCC_CR, REG_RCC_CR_PLLRDY))
-        continue;
+static const struct Loader Loader = { .uart = &Host_uart,
+                                      .buffer = (uint8_t*) USER_START,
+                                      .capacity = USER_MAX_PROG_SIZE,
+                                      .ticks = tick_now,
+                                      .quiet_ticks = LOADER_QUIET_TICKS,
+                                      .fwup = loader_fwup,
+                                      .assets = assets_receive,
+                                      .accept = loader_accept };
 
-    // (6) Configure AHB frequency to 48 MHz:
-    SET_REG_RCC_CFGR_HPRE_NOT_DIV();
+// Laid out when the guest is accepted
+static struct Mem_map Guest_map = { 0 };
+static uint32_t Guest_image_size = 0U;
 
-    // (7) Select PLL as SYSCLK source:
-    SET_REG_RCC_CFGR_SW(REG_RCC_CFGR_SW_PLL);
-
-    while(GET_REG_RCC_CFGR_SWS() != REG_RCC_CFGR_SWS_PLL)
-        continue;
-
-    // (8) Set APB frequency to 48 MHz
-    SET_REG_RCC_CFGR_PPRE(REG_RCC_CFGR_PPRE_NOT_DIV);
-}
-
-//--------------------
-// SysTick configuration
-//--------------------
-
-static void systick_init(uint32_t period_us)
-{
-    uint32_t systick_src_freq = CPU_FREQENCY;
-    bool ref_freq_avail = false;
-
-    if (!SYSTICK_GET_NOREF())
-    {
-        systick_src_freq /= REF_FREQUENCY_DIV;
-        ref_freq_avail = true;
-    }
+//=========================================================
 
-    uint32_t reload_value = 0;
+static void board_gpio_init(void);
 
-    if (!SYSTICK_GET_SKEW())
-    {
-        // TENMS value is exact
-
-        /*
-            NOTE: 
-            The SysTick calibration value is set to 6000, which 
-            gives a reference time base of 1 ms with
-            the SysTick clock set to 6 MHz (max fHCLK/8).
-        */
-
-        uint32_t calib_value  = SYSTICK_GET_SKEW();
-        reload_value = (ref_freq_avail)? calib_value * period_us :
-                                         calib_value * period_us * REF_FREQUENCY_DIV;
-    }
-    else 
-    {
-        // 1 = TENMS value is inexact, or not given
-        reload_value = period_us * (systick_src_freq / 1000000U);
-    }
+static int uart_init(struct Uart* uart);
 
-    // Program the reload value:
-    *SYSTICK_RVR = (reload_value - 1U);
 
-    // // Clear the current value:
-    *SYSTICK_CVR = 0;
+static void run_code(void);
 
-    // // Program the CSR:
+#ifdef TEST_UART
+    
+    static int run_uart_tests(struct Uart* uart);
 
-    if (ref_freq_avail == true)
-        SYSTICK_SET_SRC_REF();
-    else 
-        SYSTICK_SET_SRC_CPU();
+#endif 
 
-    SYSTICK_EXC_ENABLE();
-    SYSTICK_ENABLE();
-}
+//=========================================================
 
 //--------------------
 // GPIO configuration
@@ -178,12 +124,33 @@ static void board_gpio_init(void)
 // SysTick interrupt handler
 //--------------------
 
+// Fires only when some service asked for it (see tick.h)
 void systick_handler(void)
 {
-    static unsigned handler_ticks = 0U;
-    handler_ticks += 1U;
+    unsigned now = tick_handler_enter();
     
-    api_update(handler_ticks);
+    api_update(now);
+    link_update();
+    memstat_update(now);
+
+#ifdef PROBES
+    probe_update(now);
+#endif
+
+    // Log & guest serial share USART1 transmit: whoever asks first 
+    // takes a free channel, so alternate to let both of them through
+    if ((now & 1U) == 0U)
+    {
+        log_flush();
+        serial_flush();
+    }
+    else 
+    {
+        serial_flush();
+        log_flush();
+    }
+
+    tick_handler_leave();
 }
 
 //-----------
@@ -194,7 +161,7 @@ static int uart_init(struct Uart* uart)
 {
     struct Uart_conf uart_conf = { .uartno = 1U,
                                    .baudrate  = UART_BAUDRATE,
-                                   .frequency = CPU_FREQENCY,
+                                   .frequency = clock_get_frequency(),
                                    .tx = {.port = GPIOA, .pin = 9U},
                                    .rx = {.port = GPIOA, .pin = 10U},
                                    .af_tx = GPIO_AF1,
@@ -213,57 +180,38 @@ static int uart_init(struct Uart* uart)
     return 0;
 }
 
-//------------------------------------------
-// Calculate ans check CRC of received code
-//------------------------------------------
+//--------------------------------
+// Host firmware update by loader
+//--------------------------------
 
-static int code_check_crc(uint8_t* code, uint32_t size)
+static int loader_fwup(struct Uart* uart)
 {
-    crc_init(0xFFFFFFFF);
-    (void) code;
-    (void) size;
-
-    uint32_t calc_hash = crc32_calc(code, (size_t) (size - 4));
-    uint32_t recv_hash = *(uint32_t*) (code + size - 4);
-
-    if (calc_hash != recv_hash)
-        return -1;
+    scrn_puts(SCRN_WIDTH / 2 - 40, SCRN_HEIGHT / 2 - 4, "Update... ", 10);
+    scrn_draw();
 
-    return 0;
+    return fwup_receive(uart); // Resets the board on success
 }
 
-//-------------------------------
-// Receive and emplace user code
-//-------------------------------
+//----------------------------------
+// Guest memory map by the loader
+//----------------------------------
 
-static int receive_code(struct Uart* uart)
+static int loader_accept(const uint8_t* code, uint32_t size)
 {
-    int err = uart_recv_buffer(uart, (void*) USER_START, USER_MAX_PROG_SIZE);
-    if (err < 0) return err;
-
-    int32_t res = 0;
+    const struct Memmap_area area = { .start = USER_START,
+                                      .end = USER_STACK,
+                                      .framebuffer = (uint32_t) __framebuf_start,
+                                      .fb_size = (uint32_t) __framebuf_size };
 
-    do 
+    // Bytecode globals follow the image and it has no request, Thumb bss is part of the image
+    if (vm_check(code, USER_MAX_PROG_SIZE) == 0)
     {
-        res = is_recv_complete();
-        if (res < 0) return res;
-
-    } while (res == 0);
-
-    if (res < 4)
-        return -1; // Not enough data - 4 bytes are hash at the end 
-
-    err = code_check_crc((uint8_t*) USER_START, (uint32_t) res);
-    if (err < 0) return err;
-
-    // Send back for debug
-    //-----------------------
-    // err = uart_trns_buffer(uart, (void*)USER_START, res);
-    // if (err < 0) return err;
-    // while (is_trns_complete() == 0)
-    //     continue;
+        Guest_image_size = vm_footprint(code);
+        return memmap_plan(NULL, Guest_image_size, &area, &Guest_map);
+    }
 
-    return 0;
+    Guest_image_size = size;
+    return memmap_plan(memmap_request(code, size), size, &area, &Guest_map);
 }
 
 //---------------------------
@@ -273,7 +221,15 @@ static int receive_code(struct Uart* uart)
 static void __attribute__((noreturn)) run_code(void)
 {
     __asm__ volatile("mov sp, %0"::"r"(USER_STACK));
-    ((umain_t) USER_EXEC_START)(&API_host);
+
+    // Free area is painted from here, below the frames of the guest itself
+    memstat_paint();
+
+    // Bytecode interpreter runs on the guest stack as well
+    if (vm_check((uint8_t*) USER_START, USER_MAX_PROG_SIZE) == 0)
+        vm_run((uint8_t*) USER_START, USER_MAX_PROG_SIZE, &API_host);
+    else
+        ((umain_t) USER_EXEC_START)(&API_host);
     
     while (1)   
         continue;
@@ -285,35 +241,61 @@ static void __attribute__((noreturn)) run_code(void)
 
 int main()
 {
-    board_clocking_init();
+    clock_init();
     board_gpio_init();
-    systick_init(SYSTICK_PERIOD_US);
+    tick_init();
 
     int err = api_init();
     if (err < 0) return err;
 
-    struct Uart uart = {};
-    err = uart_init(&uart);
+    err = uart_init(&Host_uart);
     if (err < 0) return err;
 
+    log_init(&Host_uart);
+
 #ifdef TEST_UART
-    err = run_uart_tests(&uart);
+    err = run_uart_tests(&Host_uart);
     if (err < 0) return err;
 #endif 
 
     SPI_init(BAUD_DIV2);
     scrn_init(0);
 
+#if SCRN_DISPLAYS > 1
+    // Dual-display board: both panels are selected from port B
+    SET_BIT(REG_RCC_AHBENR, REG_RCC_AHBENR_IOPBEN);
+
+    err = scrn_add(0, SCRN_CS_PORT, SCRN0_CS_PIN, 0);
+    if (err < 0) return err;
+
+    err = scrn_add(1, SCRN_CS_PORT, SCRN1_CS_PIN, 0);
+    if (err < 0) return err;
+#endif
+
     scrn_clear(0x00);
     scrn_puts(SCRN_WIDTH / 2 - 40, SCRN_HEIGHT / 2 - 4, "Waiting...", 10);
     scrn_draw();
 
-    err = receive_code(&uart);
+    // Nothing to compute while waiting for the guest
+    clock_set_level(CLOCK_LEVEL_LOW);
+
+    loader_run(&Loader);
+
+    memmap_set(&Guest_map);
+    memstat_init(USER_START, Guest_image_size, Guest_map.stack_limit, USER_STACK, MEMSTAT_REPORT_TICKS);
+
+    clock_set_level(CLOCK_LEVEL_HIGH);
+
+    // Loader is done with receive channel, guest gets it as a stream
+    err = serial_init(&Host_uart);
     if (err < 0) return err;
 
     scrn_puts(SCRN_WIDTH / 2 - 40, SCRN_HEIGHT / 2 - 4, "Running...", 10);
     scrn_draw();
 
+    // Host draws nothing from here on: framebuffer slot may be the guest's now
+    scrn_set_buffers((uint8_t*) Guest_map.framebuffer, (uint8_t*) Guest_map.back_buffer);
+
     run_code();
 }
 
@@ -0,0 +1,105 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+//---------------------------------------------------------
+
+#include "memmap.h"
+
+//=========================================================
+
+#define MEMMAP_REQUEST_OFFS 4U // After the entry branch of user.S
+
+#define MEMMAP_ALIGN(ADDR) (((ADDR) + 7U) & ~7U) // AAPCS stack alignment
+
+//=========================================================
+
+static struct Mem_map Map = { 0 };
+
+//=========================================================
+
+const struct Mem_request* memmap_request(const uint8_t* image, uint32_t size)
+{
+    if (size < MEMMAP_REQUEST_OFFS + sizeof(struct Mem_request))
+        return NULL;
+
+    const struct Mem_request* request = (const struct Mem_request*) (image + MEMMAP_REQUEST_OFFS);
+
+    return (request->magic == MEM_REQUEST_MAGIC)? request : NULL;
+}
+
+//---------------------------------------------------------
+
+int memmap_plan(const struct Mem_request* request, uint32_t image_size,
+                const struct Memmap_area* area, struct Mem_map* map)
+{
+    uint32_t stack_size = MEM_DEFAULT_STACK;
+    uint32_t flags = 0U;
+
+    if (request != NULL)
+    {
+        if (request->stack_size != 0U)
+            stack_size = MEMMAP_ALIGN((uint32_t) request->stack_size);
+
+        flags = request->flags;
+    }
+
+    if (stack_size < MEM_MIN_STACK || (flags & ~(MEM_NO_FRAMEBUFFER | MEM_DOUBLE_BUFFER)) != 0U)
+        return MEMMAP_INV_REQUEST;
+
+    // Back buffer is a copy of the host one
+    if ((flags & MEM_NO_FRAMEBUFFER) != 0U && (flags & MEM_DOUBLE_BUFFER) != 0U)
+        return MEMMAP_INV_REQUEST;
+
+    uint32_t heap = MEMMAP_ALIGN(area->start + image_size);
+    uint32_t heap_end = area->end - stack_size;
+
+    map->stack_limit = heap_end;
+    map->stack_size = stack_size;
+
+    map->back_buffer = 0U;
+
+    if ((flags & MEM_DOUBLE_BUFFER) != 0U)
+    {
+        heap_end -= area->fb_size;
+        map->back_buffer = heap_end;
+    }
+
+    if (heap > heap_end || heap_end > area->end)
+        return MEMMAP_NO_ROOM;
+
+    map->heap = heap;
+    map->heap_size = heap_end - heap;
+
+    if ((flags & MEM_NO_FRAMEBUFFER) != 0U)
+    {
+        map->framebuffer = 0U;
+        map->spare = area->framebuffer;
+        map->spare_size = area->fb_size;
+    }
+    else
+    {
+        map->framebuffer = area->framebuffer;
+        map->spare = 0U;
+        map->spare_size = 0U;
+    }
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+void memmap_set(const struct Mem_map* map)
+{
+    Map = *map;
+}
+
+//---------------------------------------------------------
+
+int memmap_get(struct Mem_map* map)
+{
+    if (map == NULL)
+        return MEMMAP_INV_ARG;
+
+    *map = Map;
+    return 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+#include "common/memmap.h"
+
+//=========================================================
+
+/*
+    Host side of the negotiated guest memory map (see common/memmap.h).
+    Plan is pure arithmetic over guest addresses: the firmware runs it
+    on the uploaded image, the simulator on its own RAM.
+*/
+
+enum Memmap_error
+{
+    MEMMAP_INV_REQUEST = -40, // Stack size or flags out of range
+    MEMMAP_NO_ROOM     = -41, // Image, buffers and stack do not fit
+    MEMMAP_INV_ARG     = -42
+};
+
+struct Memmap_area
+{
+    uint32_t start;       // Guest image is loaded here
+    uint32_t end;         // Stack top
+    uint32_t framebuffer; // Host framebuffer slot
+    uint32_t fb_size;
+};
+
+//=========================================================
+
+// Request at image offset 4, NULL if image has none
+const struct Mem_request* memmap_request(const uint8_t* image, uint32_t size);
+
+// Lay out image of image_size and request (NULL for default) in area
+int memmap_plan(const struct Mem_request* request, uint32_t image_size,
+                const struct Memmap_area* area, struct Mem_map* map);
+
+// Map of the running guest, handed out by memmap_get
+void memmap_set(const struct Mem_map* map);
+
+int memmap_get(struct Mem_map* map);
@@ -0,0 +1,24 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+//=========================================================
+
+/*
+    Block copy, fill and move for Cortex-M0 (memops.S), exported to
+    guests through struct API. They also stand in for memcpy, memset
+    and memmove, so neither host nor guests link libc's byte loops.
+
+    About 0.9 cycles per byte for copies of aligned blocks, 3.3 when
+    source and destination differ in alignment, 0.6 for fill.
+*/
+
+//=========================================================
+
+void* mem_copy(void* dst, const void* src, unsigned size);
+void* mem_fill(void* dst, int value, unsigned size);
+
+// Overlapping blocks, either direction
+void* mem_move(void* dst, const void* src, unsigned size);
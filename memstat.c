@@ -0,0 +1,130 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "log.h"
+#include "tick.h"
+#include "memstat.h"
+
+//=========================================================
+
+struct Memstat
+{
+    uint32_t image_start;
+    uint32_t* image_end;
+    uint32_t* stack_limit;
+    uint32_t* floor;
+
+    uint32_t stack_top;
+
+    unsigned report_ticks;
+    unsigned due; // Tick of the next look at the floor
+
+    volatile bool painted;
+};
+
+static struct Memstat Memstat = { 0 };
+
+//=========================================================
+
+void memstat_init(uint32_t image_start, uint32_t image_size, uint32_t stack_limit,
+                  uint32_t stack_top, unsigned report_ticks)
+{
+    Memstat.image_start = image_start;
+    Memstat.image_end = (uint32_t*) ((image_start + image_size + 3U) & ~3U);
+    Memstat.stack_limit = (uint32_t*) stack_limit;
+    Memstat.stack_top = stack_top;
+    Memstat.report_ticks = report_ticks;
+    Memstat.painted = false;
+}
+
+//---------------------------------------------------------
+
+void memstat_paint(void)
+{
+    uint32_t* sp = NULL;
+    __asm__ volatile("mov %0, sp" : "=r" (sp));
+
+    // Interrupts may push frames below sp meanwhile: that is stack use as well
+    for (uint32_t* word = Memstat.image_end; word < sp; word++)
+        *word = MEMSTAT_PAINT;
+
+    Memstat.floor = sp;
+    Memstat.due = tick_now() + Memstat.report_ticks;
+    Memstat.painted = true;
+
+    tick_request(Memstat.report_ticks);
+
+    LOG("mem: image %u bytes, %u free", (uint32_t) Memstat.image_end - Memstat.image_start,
+                                        (uint32_t) sp - (uint32_t) Memstat.image_end);
+}
+
+//---------------------------------------------------------
+
+// Lowest word stack has reached, floor only moves down
+static uint32_t* memstat_floor(void)
+{
+    uint32_t* word = Memstat.stack_limit;
+
+    while (word < Memstat.floor && *word == MEMSTAT_PAINT)
+        word++;
+
+    return word;
+}
+
+//---------------------------------------------------------
+
+void memstat_update(unsigned now)
+{
+    if (!Memstat.painted)
+        return;
+
+    // SysTick may have come for someone else
+    int ahead = (int) (Memstat.due - now);
+    if (ahead > 0)
+    {
+        tick_request((unsigned) ahead);
+        return;
+    }
+
+    Memstat.due = now + Memstat.report_ticks;
+    tick_request(Memstat.report_ticks);
+
+    uint32_t* floor = memstat_floor();
+    if (floor == Memstat.floor)
+        return;
+
+    Memstat.floor = floor;
+
+    uint32_t stack = Memstat.stack_top - (uint32_t) floor;
+    uint32_t reserved = Memstat.stack_top - (uint32_t) Memstat.stack_limit;
+
+    if (floor == Memstat.stack_limit)
+        LOG("mem: stack reached its limit, %u bytes", reserved);
+    else
+        LOG("mem: stack %u bytes of %u, %u free", stack, reserved,
+                                                  (uint32_t) floor - (uint32_t) Memstat.image_end);
+}
+
+//---------------------------------------------------------
+
+int memstat_usage(struct Mem_usage* usage)
+{
+    if (usage == NULL)
+        return MEMSTAT_INV_ARG;
+
+    if (!Memstat.painted)
+        return MEMSTAT_NOT_PAINTED;
+
+    // Report of its own is left to SysTick
+    uint32_t* floor = memstat_floor();
+
+    usage->image_size     = (uint32_t) Memstat.image_end - Memstat.image_start;
+    usage->stack_max      = Memstat.stack_top - (uint32_t) floor;
+    usage->free_min       = (uint32_t) floor - (uint32_t) Memstat.image_end;
+    usage->stack_reserved = Memstat.stack_top - (uint32_t) Memstat.stack_limit;
+
+    return 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+#include "common/api.h"
+
+//=========================================================
+
+/*
+    Guest memory high-water mark. Before the guest starts, everything
+    between the end of its image and the current stack pointer is
+    painted with MEMSTAT_PAINT. Stack grows down into that area, so the
+    lowest word that no longer holds the paint is the deepest the stack
+    (interrupt frames included) has ever reached:
+
+        USER_START    image end        stack limit      floor           stack top
+            | image ... | heap, buffers ... |  painted, free  | stack ... used |
+
+    Floor is looked up from the stack limit of the memory map upwards,
+    once per report period on SysTick (see tick.h), and logged whenever it moves
+    down. Stack that has gone past the limit shows as the limit itself.
+*/
+
+#define MEMSTAT_PAINT 0xA5C3A5C3U
+
+//=========================================================
+
+enum Memstat_error
+{
+    MEMSTAT_NOT_PAINTED = -1, // Guest has not started yet
+    MEMSTAT_INV_ARG     = -2
+};
+
+//=========================================================
+
+// Guest area layout, stack limit and top come from the memory map
+void memstat_init(uint32_t image_start, uint32_t image_size, uint32_t stack_limit,
+                  uint32_t stack_top, unsigned report_ticks);
+
+// Paint free area below the caller's stack, call on the guest stack
+void memstat_paint(void);
+
+// Log the floor once it moves, called on SysTick with current tick
+void memstat_update(unsigned now);
+
+// Current figures for the guest
+int memstat_usage(struct Mem_usage* usage);
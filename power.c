@@ -0,0 +1,334 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "inc/rcc.h"
+#include "inc/pwr.h"
+#include "inc/rtc.h"
+#include "inc/exti.h"
+#include "inc/gpio.h"
+#include "inc/nvic.h"
+#include "inc/scb.h"
+#include "inc/spi.h"
+#include "inc/arm.h"
+#include "api.h"
+#include "uart.h"
+#include "clock.h"
+#include "serial.h"
+#include "link.h"
+#include "sound.h"
+#include "ring.h"
+#include "power.h"
+#include "log.h"
+#include "tick.h"
+
+//=========================================================
+
+// f_ck_apre = 40 kHz / (1 + 1) = 20 kHz, f_ck_spre = 20 kHz / (19999 + 1) = 1 Hz
+#define RTC_PREDIV_A 1U
+#define RTC_PREDIV_S 19999U
+
+#define RTC_SS_PERIOD  (RTC_PREDIV_S + 1U)
+#define RTC_SS_TICK_US 50U // Sub second counter step
+
+#define FRAME_PERIOD_US 16667U // 60 frames per second
+
+// Buttons are PA0..PA3, EXTI lines are routed to port A by default
+#define BUTTONS_GPIO  GPIOA
+#define BUTTONS_LINES ((1U << BUTTONS_NUM) - 1U)
+
+#define ALARM_LINE (1U << EXTI_LINE_RTC_ALARM)
+#define IDLE_LINES (BUTTONS_LINES | ALARM_LINE)
+
+//---------------------------------------------------------
+
+struct Power_state
+{
+    uint16_t restore_last_us; // Last clock tree restore time after Stop
+    uint16_t restore_max_us;  // Worst one
+
+    bool stop_disabled;       // Restore took longer than a frame
+
+    struct Flags wake_lines; // EXTI lines served by handlers during idle
+};
+
+__attribute__ ((section (".api")))
+static struct Power_state Power = { 0 };
+
+//---------------------------------------------------------
+
+static void power_rtc_init(void);
+static void power_rtc_alarm_set(uint32_t ticks);
+static void power_rtc_alarm_reset(void);
+
+static bool power_stop_allowed(uint32_t timeout_us);
+
+//=========================================================
+
+void power_init(void)
+{
+    power_rtc_init();
+
+    // Button press pulls the line up, alarm is a rising edge as well.
+    // Either edge of a button starts debounce on SysTick, so its
+    // lines stay unmasked: nothing samples them in between
+    *EXTI_RTSR |= IDLE_LINES;
+    *EXTI_FTSR |= BUTTONS_LINES;
+    *EXTI_IMR  |= BUTTONS_LINES;
+
+    NVIC_ENABLE_IRQ(EXTI0_1_IRQ);
+    NVIC_ENABLE_IRQ(EXTI2_3_IRQ);
+    NVIC_ENABLE_IRQ(RTC_IRQ);
+}
+
+//---------------------------------------------------------
+
+static inline uint32_t power_rtc_read_ss(void)
+{
+    // Shadow registers are bypassed: read until two values agree
+    uint32_t ss = 0;
+
+    do
+    {
+        ss = *RTC_SSR;
+
+    } while (ss != *RTC_SSR);
+
+    return ss;
+}
+
+//---------------------------------------------------------
+
+static void power_rtc_init(void)
+{
+    // (1) RTC domain is write protected after reset
+    SET_BIT(REG_RCC_APB1ENR, REG_RCC_APB1ENR_PWREN);
+    SET_BIT(PWR_CR, PWR_CR_DBP);
+
+    // (2) Clock LSI, it keeps running in Stop mode
+    SET_BIT(REG_RCC_CSR, REG_RCC_CSR_LSION);
+    while (CHECK_BIT(REG_RCC_CSR, REG_RCC_CSR_LSIRDY) == 0U)
+        continue;
+
+    // (3) Select LSI as RTC clock, RTC domain survives system reset
+    if (GET_REG_RCC_BDCR_RTCSEL() != REG_RCC_BDCR_RTCSEL_LSI)
+    {
+        SET_BIT(REG_RCC_BDCR, REG_RCC_BDCR_BDRST);
+        CLEAR_BIT(REG_RCC_BDCR, REG_RCC_BDCR_BDRST);
+
+        SET_REG_RCC_BDCR_RTCSEL(REG_RCC_BDCR_RTCSEL_LSI);
+    }
+
+    SET_BIT(REG_RCC_BDCR, REG_RCC_BDCR_RTCEN);
+
+    // (4) Prescalers are programmed in init mode with two separate writes
+    RTC_UNLOCK();
+
+    SET_BIT(RTC_ISR, RTC_ISR_INIT);
+    while (CHECK_BIT(RTC_ISR, RTC_ISR_INITF) == 0U)
+        continue;
+
+    *RTC_PRER = (RTC_PREDIV_S << RTC_PRER_PREDIV_S);
+    *RTC_PRER |= (RTC_PREDIV_A << RTC_PRER_PREDIV_A);
+
+    CLEAR_BIT(RTC_ISR, RTC_ISR_INIT);
+
+    // (5) Shadow registers are not updated in Stop mode
+    SET_BIT(RTC_CR, RTC_CR_BYPSHAD);
+
+    RTC_LOCK();
+}
+
+//---------------------------------------------------------
+
+static void power_rtc_alarm_set(uint32_t ticks)
+{
+    // Sub second counter is down-counting
+    uint32_t target = (power_rtc_read_ss() + RTC_SS_PERIOD - ticks) % RTC_SS_PERIOD;
+
+    RTC_UNLOCK();
+
+    CLEAR_BIT(RTC_CR, RTC_CR_ALRAE);
+    while (CHECK_BIT(RTC_ISR, RTC_ISR_ALRAWF) == 0U)
+        continue;
+
+    // Date, hours, minutes & seconds are don't care, SS[14:0] are compared
+    *RTC_ALRMAR = (1U << RTC_ALRMAR_MSK1) | (1U << RTC_ALRMAR_MSK2)
+                | (1U << RTC_ALRMAR_MSK3) | (1U << RTC_ALRMAR_MSK4);
+
+    *RTC_ALRMASSR = (15U << RTC_ALRMASSR_MASKSS) | (target << RTC_ALRMASSR_SS);
+
+    CLEAR_BIT(RTC_ISR, RTC_ISR_ALRAF);
+    *RTC_CR |= (1U << RTC_CR_ALRAE) | (1U << RTC_CR_ALRAIE);
+
+    RTC_LOCK();
+}
+
+//---------------------------------------------------------
+
+static void power_rtc_alarm_reset(void)
+{
+    RTC_UNLOCK();
+
+    *RTC_CR &= ~((1U << RTC_CR_ALRAE) | (1U << RTC_CR_ALRAIE));
+    CLEAR_BIT(RTC_ISR, RTC_ISR_ALRAF);
+
+    RTC_LOCK();
+}
+
+//---------------------------------------------------------
+
+static bool power_stop_allowed(uint32_t timeout_us)
+{
+    if (Power.stop_disabled == true)
+        return false;
+
+    // USART, DMA & timer clocks are halted in Stop mode
+    if (uart_is_idle() == false || serial_rx_in_use() == true || link_is_active() == true
+     || sound_is_active() == true)
+        return false;
+
+    // Not worth it if restore eats most of the wait
+    return (timeout_us >= 2U * Power.restore_max_us);
+}
+
+//---------------------------------------------------------
+
+int power_idle(unsigned timeout_ms)
+{
+    if (timeout_ms == 0U)
+        return POWER_WAKE_TIMEOUT;
+
+    if (timeout_ms > POWER_MAX_IDLE_MS)
+        timeout_ms = POWER_MAX_IDLE_MS;
+
+    // Frame transfer to display must not be frozen halfway
+    SPI_wait_idle();
+
+    *EXTI_PR = IDLE_LINES;
+    flags_take(&Power.wake_lines, ~0U);
+
+    power_rtc_alarm_set(timeout_ms * (1000U / RTC_SS_TICK_US));
+    *EXTI_IMR |= ALARM_LINE;
+
+    // Press before pending edges were cleared is not seen by the loop
+    if ((GPIO_IDR_READ(BUTTONS_GPIO) & BUTTONS_LINES) != 0U)
+    {
+        *EXTI_IMR &= ~ALARM_LINE;
+        power_rtc_alarm_reset();
+        return POWER_WAKE_INPUT;
+    }
+
+    int wakeup = -1;
+
+    // Pending interrupt still ends WFI with PRIMASK set, handlers run after restore
+    uint32_t primask = irq_save();
+
+    while (wakeup < 0)
+    {
+        bool stop = power_stop_allowed(timeout_ms * 1000U);
+        uint32_t ss_sleep = 0U;
+
+        if (stop == true)
+        {
+            CLEAR_BIT(PWR_CR, PWR_CR_PDDS);
+            SET_BIT(PWR_CR, PWR_CR_LPDS);
+            SET_BIT(PWR_CR, PWR_CR_CWUF);
+
+            SET_BIT(SCB_SCR, SCB_SCR_SLEEPDEEP);
+
+            ss_sleep = power_rtc_read_ss();
+        }
+
+        wfi();
+
+        if (stop == true)
+        {
+            CLEAR_BIT(SCB_SCR, SCB_SCR_SLEEPDEEP);
+
+            // Woken up on HSI, measure how long it takes to get back
+            uint32_t ss_wake = power_rtc_read_ss();
+            clock_resume();
+            uint32_t ss_done = power_rtc_read_ss();
+
+            // SysTick was halted along with the core
+            tick_skip(((ss_sleep + RTC_SS_PERIOD - ss_wake) % RTC_SS_PERIOD) * RTC_SS_TICK_US);
+
+            uint32_t restore_us = ((ss_wake + RTC_SS_PERIOD - ss_done) % RTC_SS_PERIOD) * RTC_SS_TICK_US;
+
+            Power.restore_last_us = (uint16_t) restore_us;
+
+            if (restore_us > Power.restore_max_us)
+            {
+                Power.restore_max_us = (uint16_t) restore_us;
+                LOG("power: new worst clock restore after Stop %u us", restore_us);
+            }
+
+            if (restore_us > FRAME_PERIOD_US)
+                Power.stop_disabled = true;
+        }
+
+        // Handler may have already taken the line when IRQs were open
+        uint32_t pending = *EXTI_PR | flags_peek(&Power.wake_lines);
+
+        // Release edges wake us up as well, only a held button is input
+        if ((pending & BUTTONS_LINES) != 0U && (GPIO_IDR_READ(BUTTONS_GPIO) & BUTTONS_LINES) != 0U)
+            wakeup = POWER_WAKE_INPUT;
+        else if ((pending & ALARM_LINE) != 0U)
+            wakeup = POWER_WAKE_TIMEOUT;
+        else
+        {
+            // Woken up by something else (SysTick, DMA): serve it and go back
+            irq_restore(primask);
+            primask = irq_save();
+        }
+    }
+
+    *EXTI_IMR &= ~ALARM_LINE;
+    power_rtc_alarm_reset();
+
+    irq_restore(primask);
+    return wakeup;
+}
+
+//---------------------------------------------------------
+
+unsigned power_get_restore_us(void)
+{
+    return Power.restore_max_us;
+}
+
+//--------------------
+// Interrupt handlers
+//--------------------
+
+void exti0_1_handler(void)
+{
+    flags_set(&Power.wake_lines, *EXTI_PR & BUTTONS_LINES & 0b0011U);
+    *EXTI_PR = BUTTONS_LINES & 0b0011U;
+
+    tick_request(1U);
+}
+
+//---------------------------------------------------------
+
+void exti2_3_handler(void)
+{
+    flags_set(&Power.wake_lines, *EXTI_PR & BUTTONS_LINES & 0b1100U);
+    *EXTI_PR = BUTTONS_LINES & 0b1100U;
+
+    tick_request(1U);
+}
+
+//---------------------------------------------------------
+
+void rtc_handler(void)
+{
+    // Alarm flag is not write protected
+    CLEAR_BIT(RTC_ISR, RTC_ISR_ALRAF);
+
+    flags_set(&Power.wake_lines, *EXTI_PR & ALARM_LINE);
+    *EXTI_PR = ALARM_LINE;
+}
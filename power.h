@@ -0,0 +1,40 @@
+#pragma once 
+
+//=========================================================
+
+#include <stdint.h>
+
+//=========================================================
+
+/*
+    Idle between frames:
+        - Stop mode: HSE, PLL & all peripheral clocks are halted,
+          wakeup by button press (EXTI 0..3, either edge, release
+          just goes back to sleep) or by RTC alarm A (EXTI 17)
+          clocked from LSI. SysTick halts, sleep time is added to
+          the tick counter from RTC.
+        - Sleep mode: fallback while UART transfer is in flight or sound plays,
+          or when clock tree restore after Stop turned out to be
+          longer than a frame period.
+
+    LSI is 30..50 kHz, so timeouts are accurate to about 25%.
+*/
+
+#define POWER_MAX_IDLE_MS 999U // RTC alarm is set within one second
+
+enum Power_wakeup
+{
+    POWER_WAKE_TIMEOUT = 0,
+    POWER_WAKE_INPUT   = 1
+};
+
+//=========================================================
+
+// Start LSI & RTC, route button lines to EXTI
+void power_init(void);
+
+// Sleep until button press or timeout, returns Power_wakeup
+int power_idle(unsigned timeout_ms);
+
+// Worst clock tree restore time after Stop mode seen so far
+unsigned power_get_restore_us(void);
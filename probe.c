@@ -0,0 +1,124 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "inc/tim.h"
+#include "inc/rcc.h"
+#include "inc/arm.h"
+#include "log.h"
+#include "tick.h"
+#include "probe.h"
+
+//=========================================================
+
+#define PROBE_REPORT_TICKS TICK_FREQ
+
+#define TIM2_MAX_COUNT 0xFFFFFFFFU // TIM2 counter & auto-reload are 32 bits wide
+
+//---------------------------------------------------------
+
+struct Probe_state
+{
+    struct Probe_stats probes[PROBE_IDS];
+
+    unsigned due; // Tick of the next report
+};
+
+// Outlives main(): guest and its handlers are timed as well
+__attribute__ ((section (".api")))
+static struct Probe_state Probe = { 0 };
+
+//=========================================================
+
+void probe_init(void)
+{
+    SET_BIT(REG_RCC_APB1ENR, REG_RCC_APB1ENR_TIM2EN);
+
+    // TIM2 clock is PCLK = HCLK: APB is not divided (see clock.h)
+    REG_WRITE(TIM_PSC(PROBE_TIM), FIELD(TIM_PSC_FIELD, 0U));
+    *TIM_ARR(PROBE_TIM) = TIM2_MAX_COUNT;
+
+    REG_WRITE(TIM_EGR(PROBE_TIM), FIELD_ON(TIM_EGR_UG));
+    SET_BIT(TIM_CR1(PROBE_TIM), TIM_CR1_CEN);
+}
+
+//---------------------------------------------------------
+
+void probe_add(unsigned id, uint32_t cycles)
+{
+    if (id >= PROBE_IDS)
+        return;
+
+    struct Probe_stats* probe = &Probe.probes[id];
+
+    // Region may be timed in thread mode and in a handler at once
+    uint32_t primask = irq_save();
+
+    if (probe->count == 0U || cycles < probe->min)
+        probe->min = cycles;
+
+    if (cycles > probe->max)
+        probe->max = cycles;
+
+    probe->total += cycles;
+    probe->count++;
+
+    irq_restore(primask);
+}
+
+//---------------------------------------------------------
+
+int probe_guest_add(unsigned id, uint32_t cycles)
+{
+    if (id >= PROBE_GUEST_IDS)
+        return PROBE_INV_ARG;
+
+    probe_add(PROBE_GUEST + id, cycles);
+    return 0;
+}
+
+//---------------------------------------------------------
+
+int probe_take(unsigned id, struct Probe_stats* stats)
+{
+    if (id >= PROBE_IDS || stats == NULL)
+        return PROBE_INV_ARG;
+
+    uint32_t primask = irq_save();
+
+    *stats = Probe.probes[id];
+    Probe.probes[id] = (struct Probe_stats) { 0 };
+
+    irq_restore(primask);
+    return 0;
+}
+
+//---------------------------------------------------------
+
+void probe_update(unsigned now)
+{
+    // SysTick may have come for someone else
+    int ahead = (int) (Probe.due - now);
+    if (ahead > 0)
+    {
+        tick_request((unsigned) ahead);
+        return;
+    }
+
+    Probe.due = now + PROBE_REPORT_TICKS;
+    tick_request(PROBE_REPORT_TICKS);
+
+    // Guest probes are the guest's to take: reading them here would race it
+    for (unsigned id = 0U; id < PROBE_HOST_IDS; id++)
+    {
+        struct Probe_stats stats;
+
+        if (probe_take(id, &stats) < 0 || stats.count == 0U)
+            continue;
+
+        LOG("probe %u: %u runs, min %u, max %u cycles", id, stats.count, stats.min, stats.max);
+        LOG("probe %u: %u cycles in total", id, stats.total);
+    }
+}
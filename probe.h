@@ -0,0 +1,61 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+#include "inc/tim.h"
+#include "common/probe.h"
+
+//=========================================================
+
+/*
+    Host side of timing probes (see common/probe.h). A firmware region
+    is timed with
+
+        PROBE_BEGIN(PROBE_SCRN_DRAW);
+        ...
+        PROBE_END(PROBE_SCRN_DRAW);
+
+    in one block. Both compile to nothing unless the firmware is built
+    with `make PROBES=1`; then the table is logged and cleared every
+    second from SysTick. A probe costs a counter read and a call.
+
+    TIM2 halts in Stop mode: idle time is not in the counts.
+*/
+
+#define PROBE_TIM TIM2
+
+//=========================================================
+
+// Start TIM2 free-running at HCLK
+void probe_init(void);
+
+static inline uint32_t probe_now(void)
+{
+    return *TIM_CNT(PROBE_TIM);
+}
+
+// One run of region id, safe from handlers
+void probe_add(unsigned id, uint32_t cycles);
+
+// Copy and clear probe id of the whole table
+int probe_take(unsigned id, struct Probe_stats* stats);
+
+// probe_add for guests, id is below PROBE_GUEST_IDS
+int probe_guest_add(unsigned id, uint32_t cycles);
+
+// Log and clear host probes once a second, called on SysTick with current tick
+void probe_update(unsigned now);
+
+#ifdef PROBES
+
+    #define PROBE_BEGIN(ID) const uint32_t probe_start_##ID = probe_now()
+    #define PROBE_END(ID)   probe_add((ID), probe_now() - probe_start_##ID)
+
+#else
+
+    #define PROBE_BEGIN(ID) (void) 0
+    #define PROBE_END(ID)   (void) 0
+
+#endif
@@ -0,0 +1,170 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "inc/arm.h"
+#include "memops.h"
+#include "ring.h"
+
+//=========================================================
+
+int ring_init(struct Ring* ring, void* buf, unsigned size, unsigned flags)
+{
+    if (ring == NULL || buf == NULL)
+        return RING_INV_PTR;
+
+    if (size < 2U || size > 0x8000U || (size & (size - 1U)) != 0U)
+        return RING_INV_SIZE;
+
+    ring->buf = (uint8_t*) buf;
+    ring->mask = (uint16_t) (size - 1U);
+    ring->flags = (uint16_t) flags;
+
+    ring->head = 0U;
+    ring->tail = 0U;
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+static unsigned ring_put(struct Ring* ring, const uint8_t* src, unsigned len, bool all)
+{
+    uint16_t head = ring->head;
+    unsigned space = ring->mask + 1U - (uint16_t) (head - ring->tail);
+
+    if (len > space)
+    {
+        if (all)
+            return 0U;
+
+        len = space;
+    }
+
+    // At most two pieces: up to the end of buffer and from its start
+    unsigned offs = head & ring->mask;
+    unsigned first = ring->mask + 1U - offs;
+
+    if (first > len)
+        first = len;
+
+    mem_copy(ring->buf + offs, src, first);
+    mem_copy(ring->buf, src + first, len - first);
+
+    head += len;
+
+    // Publish after data is in place
+    dmb();
+    ring->head = head;
+
+    return len;
+}
+
+//---------------------------------------------------------
+
+static unsigned ring_put_locked(struct Ring* ring, const void* src, unsigned len, bool all)
+{
+    if ((ring->flags & RING_SHARED_PRODUCER) == 0U)
+        return ring_put(ring, src, len, all);
+
+    uint32_t primask = irq_save();
+    len = ring_put(ring, src, len, all);
+    irq_restore(primask);
+
+    return len;
+}
+
+//---------------------------------------------------------
+
+unsigned ring_write(struct Ring* ring, const void* src, unsigned len)
+{
+    return ring_put_locked(ring, src, len, false);
+}
+
+//---------------------------------------------------------
+
+bool ring_write_all(struct Ring* ring, const void* src, unsigned len)
+{
+    return ring_put_locked(ring, src, len, true) == len;
+}
+
+//---------------------------------------------------------
+
+unsigned ring_read(struct Ring* ring, void* dst, unsigned max)
+{
+    uint8_t* out = (uint8_t*) dst;
+
+    uint16_t tail = ring->tail;
+    unsigned used = (uint16_t) (ring->head - tail);
+
+    if (max > used)
+        max = used;
+
+    // Head is read before the data it covers
+    dmb();
+
+    unsigned offs = tail & ring->mask;
+    unsigned first = ring->mask + 1U - offs;
+
+    if (first > max)
+        first = max;
+
+    mem_copy(out, ring->buf + offs, first);
+    mem_copy(out + first, ring->buf, max - first);
+
+    tail += max;
+
+    dmb();
+    ring->tail = tail;
+
+    return max;
+}
+
+//---------------------------------------------------------
+
+const void* ring_peek(const struct Ring* ring, unsigned* len)
+{
+    uint16_t tail = ring->tail;
+    unsigned used = (uint16_t) (ring->head - tail);
+    unsigned start = tail & ring->mask;
+
+    unsigned to_end = ring->mask + 1U - start;
+    *len = (used < to_end)? used : to_end;
+
+    dmb();
+    return &ring->buf[start];
+}
+
+//---------------------------------------------------------
+
+void ring_consume(struct Ring* ring, unsigned len)
+{
+    // Bytes are read out (or DMA is done with them) before they are handed back
+    dmb();
+    ring->tail = (uint16_t) (ring->tail + len);
+}
+
+//=========================================================
+
+void flags_set(struct Flags* flags, uint32_t mask)
+{
+    // Handlers of different priority may set bits at once
+    uint32_t primask = irq_save();
+    flags->bits |= mask;
+    irq_restore(primask);
+}
+
+//---------------------------------------------------------
+
+uint32_t flags_take(struct Flags* flags, uint32_t mask)
+{
+    uint32_t primask = irq_save();
+
+    uint32_t taken = flags->bits & mask;
+    flags->bits &= ~mask;
+
+    irq_restore(primask);
+    return taken;
+}
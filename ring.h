@@ -0,0 +1,95 @@
+#pragma once 
+
+//=========================================================
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//=========================================================
+
+/*
+    Single-producer single-consumer byte ring for handing data between
+    handlers, thread mode and DMA on Cortex-M0, which has no exclusive
+    access: producer owns head, consumer owns tail, each side only reads
+    the other's counter. Data is in place before head moves, and read
+    out before tail moves (dmb in between).
+
+    Counters are free-running 16-bit, ring index is counter & mask,
+    so size is a power of two up to 32 KiB.
+
+    RING_SHARED_PRODUCER: writes mask IRQs, so both thread and handler
+    mode may produce. Consumer still has to be a single context.
+*/
+
+enum Ring_flags
+{
+    RING_SHARED_PRODUCER = 1U << 0
+};
+
+enum Ring_error
+{
+    RING_INV_PTR  = -1,
+    RING_INV_SIZE = -2
+};
+
+struct Ring
+{
+    uint8_t* buf;
+    uint16_t mask;
+    uint16_t flags;
+
+    volatile uint16_t head; // Written by producer only
+    volatile uint16_t tail; // Written by consumer only
+};
+
+// Static initializer, same as ring_init without checks
+#define RING_INIT(BUF, SIZE, FLAGS) { .buf = (uint8_t*) (BUF), .mask = (uint16_t) ((SIZE) - 1U), .flags = (FLAGS) }
+
+//---------------------------------------------------------
+
+// Event bits set from handlers and taken in thread mode (or vice versa)
+struct Flags
+{
+    volatile uint32_t bits;
+};
+
+//=========================================================
+
+int ring_init(struct Ring* ring, void* buf, unsigned size, unsigned flags);
+
+// Producer: copy up to len bytes, returns number of bytes queued
+unsigned ring_write(struct Ring* ring, const void* src, unsigned len);
+
+// Producer: queue all len bytes or nothing
+bool ring_write_all(struct Ring* ring, const void* src, unsigned len);
+
+// Consumer: copy up to max bytes out, returns number of bytes taken
+unsigned ring_read(struct Ring* ring, void* dst, unsigned max);
+
+// Consumer: queued bytes contiguous in memory (e.g. for DMA), up to the end of the ring
+const void* ring_peek(const struct Ring* ring, unsigned* len);
+
+// Consumer: release bytes got from ring_peek
+void ring_consume(struct Ring* ring, unsigned len);
+
+static inline unsigned ring_used(const struct Ring* ring)
+{
+    return (uint16_t) (ring->head - ring->tail);
+}
+
+static inline unsigned ring_space(const struct Ring* ring)
+{
+    return ring->mask + 1U - ring_used(ring);
+}
+
+//---------------------------------------------------------
+
+void flags_set(struct Flags* flags, uint32_t mask);
+
+// Clear bits of mask, returns which of them were set
+uint32_t flags_take(struct Flags* flags, uint32_t mask);
+
+static inline uint32_t flags_peek(const struct Flags* flags)
+{
+    return flags->bits;
+}
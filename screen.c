@@ -1,5 +1,8 @@
+#include <stddef.h>
+
 #include "screen.h"
 #include "inc/arm.h"
+#include "probe.h"
 
 #define BIT_SET(REG, BIT)   do (REG) |=  (1U << (BIT)); while(0)
 #define BIT_CLR(REG, BIT)   do (REG) &= ~(1U << (BIT)); while(0)
@@ -51,14 +54,46 @@
 #define OLED_SEGREMAP                       0xA0
 #define OLED_CHARGEPUMP                     0x8D
 
-__attribute__ ((section (".api"))) 
-static uint8_t FrameBuffer[SCRN_SIZ_BYTES] = {0};
+// Slot right below the guest area, guest may take it over (see common/memmap.h)
+__attribute__ ((section (".framebuf"))) 
+static uint8_t HostBuffer[SCRN_SIZ_BYTES];
 
-static struct ScrSettings {
+struct Display {
+    uint8_t* front;     // Drawn into, back is shown meanwhile when double-buffered
+    uint8_t* back;
+    uint8_t* sent;      // Buffer on the bus or waiting for it
+    uint32_t cs_port;   // SCRN_NO_CS: selected all the time
+    unsigned cs_pin  : 4;
     unsigned rotated : 1;
-} Settings = {0};
+    unsigned ready   : 1; // Init sequence is sent
+
+    volatile uint8_t queued; // Flush waits for the bus, cleared from DMA interrupt
+};
+
+static struct Display Displays[SCRN_DISPLAYS] = {
+    { .front = HostBuffer, .cs_port = SCRN_NO_CS, .ready = 1 }
+};
+
+// Target of drawing calls
+static struct Display* Scrn = &Displays[0];
+
+// Display whose frame is on the bus, SCRN_DISPLAYS when idle
+static volatile unsigned On_bus = SCRN_DISPLAYS;
+
+static void scrn_cs(const struct Display* display, int selected) {
+    if (display->cs_port == SCRN_NO_CS) {
+        return;
+    }
 
-static void oled_init() {
+    // Active low
+    if (selected) {
+        BIT_CLR(*GPIO_ODR(display->cs_port), display->cs_pin);
+    } else {
+        BIT_SET(*GPIO_ODR(display->cs_port), display->cs_pin);
+    }
+}
+
+static void oled_init(const struct Display* display) {
     // To initialize OLED, we need to send 25 OLED commands
     // We will store these commands in an array
     // We then write them to the SPI one by one
@@ -77,7 +112,7 @@ static void oled_init() {
         OLED_MEMORYMODE,
         0x00,
         OLED_SEGREMAP | 0x01,
-        Settings.rotated ? OLED_COMSCANINC : OLED_COMSCANDEC,
+        display->rotated ? OLED_COMSCANINC : OLED_COMSCANDEC,
         OLED_SETCOMPINS,
         0x12, // 128x64
         OLED_SETCONTRAST,
@@ -91,13 +126,24 @@ static void oled_init() {
         OLED_DISPLAYON
     };
 
+    SCRN_MODE_SET(MODE_CMD);
+    scrn_cs(display, 1);
+
     for (unsigned i = 0; i < sizeof(oled_initcmds); i++) {
         SPI_send_byte(oled_initcmds[i]);
         wfi();
     }
+
+    // CS may only go up once the last command is out
+    SPI_wait_idle();
+    scrn_cs(display, 0);
+
+    SCRN_MODE_SET(MODE_DATA);
 }
 
 void scrn_init(uint8_t rotated) {
+    scrn_wait();
+
     // We are going to send a command
     SCRN_MODE_SET(MODE_CMD);
 
@@ -117,71 +163,253 @@ void scrn_init(uint8_t rotated) {
         for (int i = 0; i < 1000; i++);
     }
 
-    Settings.rotated = !!rotated;
+    // RES is shared: every panel is back to its power-on state
+    for (unsigned id = 1; id < SCRN_DISPLAYS; id++) {
+        Displays[id].ready = 0;
+    }
 
-    oled_init();
+    Displays[0].rotated = !!rotated;
 
-    // Switch to data transfer mode
-    SCRN_MODE_SET(MODE_DATA);
+    oled_init(&Displays[0]);
+}
+
+int scrn_add(unsigned id, uint32_t cs_port, unsigned cs_pin, uint8_t rotated) {
+    if (id >= SCRN_DISPLAYS || cs_pin > 15) {
+        return -SCRN_E_INVAL;
+    }
+
+    scrn_wait();
+
+    struct Display* display = &Displays[id];
+
+    display->cs_port = cs_port;
+    display->cs_pin  = cs_pin & 15;
+    display->rotated = !!rotated;
+
+    if (cs_port != SCRN_NO_CS) {
+        scrn_cs(display, 0);
+        SET_GPIO_IOMODE(cs_port, cs_pin, GPIO_IOMODE_GEN_PURPOSE_OUTPUT);
+        SET_GPIO_OTYPE(cs_port, cs_pin, GPIO_OTYPE_PUSH_PULL);
+    }
+
+    oled_init(display);
+    display->ready = 1;
+
+    return SCRN_OK;
+}
+
+// Single buffer is drawn into right after return, it must be out by then
+static void scrn_wait_display(const struct Display* display) {
+    while (display->queued || On_bus == (unsigned) (display - Displays))
+        ;
+}
+
+int scrn_select(unsigned id, uint8_t* fb) {
+    if (id >= SCRN_DISPLAYS || Displays[id].ready == 0) {
+        return -SCRN_E_INVAL;
+    }
+
+    Scrn = &Displays[id];
+
+    if (fb != NULL) {
+        scrn_wait_display(Scrn);
+        Scrn->front = fb;
+        Scrn->back  = NULL;
+    }
+
+    return SCRN_OK;
+}
+
+void scrn_set_buffers(uint8_t* front, uint8_t* back) {
+    scrn_wait_display(Scrn);
+
+    Scrn->front = front;
+    Scrn->back  = (front == NULL) ? NULL : back;
 }
 
 // Fills the entire screen with given value
 void scrn_clear(uint8_t value) {
+    if (Scrn->front == NULL) {
+        return;
+    }
+
     SCRN_MODE_SET(MODE_DATA);
     for (unsigned byte = 0; byte < SCRN_SIZ_BYTES; byte++) {
         // SPI_send_byte(value);
-        FrameBuffer[byte] = value;
+        Scrn->front[byte] = value;
+    }
+}
+
+// Sends the first queued frame, runs again from the DMA interrupt once it is out
+static void scrn_next(void) {
+    for (unsigned id = 0; id < SCRN_DISPLAYS; id++) {
+        struct Display* display = &Displays[id];
+
+        if (display->queued == 0) {
+            continue;
+        }
+
+        display->queued = 0;
+        On_bus = id;
+
+        SCRN_MODE_SET(MODE_DATA);
+        scrn_cs(display, 1);
+
+        if (SPI_send_dma(display->sent, SCRN_SIZ_BYTES) == 0) {
+            return;
+        }
+
+        // Channel 3 is held by UART receive (upload): push it by hand
+        for (unsigned byte = 0; byte < SCRN_SIZ_BYTES; byte++) {
+            SPI_send_byte(display->sent[byte]);
+        }
+
+        SPI_wait_idle();
+        scrn_cs(display, 0);
+    }
+
+    On_bus = SCRN_DISPLAYS;
+}
+
+static void scrn_dma_done(void) {
+    if (On_bus < SCRN_DISPLAYS) {
+        scrn_cs(&Displays[On_bus], 0);
+    }
+
+    scrn_next();
+}
+
+static int scrn_can_flush(const struct Display* display) {
+    return display->front != NULL && display->ready;
+}
+
+// Previous frame of the display must be out: it holds the buffer till then
+static void scrn_enqueue(struct Display* display) {
+    display->sent = display->front;
+
+    // Drawing goes on in the other buffer while this one is sent
+    if (display->back != NULL) {
+        display->front = display->back;
+        display->back  = display->sent;
     }
+
+    display->queued = 1;
+}
+
+static void scrn_kick(void) {
+    if (On_bus == SCRN_DISPLAYS) {
+        SPI_dma_on_done(scrn_dma_done);
+        scrn_next();
+    }
+}
+
+void scrn_wait(void) {
+    for (unsigned id = 0; id < SCRN_DISPLAYS; id++) {
+        scrn_wait_display(&Displays[id]);
+    }
+}
+
+uint8_t* scrn_buffer(void) {
+    // Single buffer is the one in flight
+    if (Scrn->back == NULL) {
+        scrn_wait_display(Scrn);
+    }
+
+    return Scrn->front;
+}
+
+void scrn_flush(void) {
+    if (!scrn_can_flush(Scrn)) {
+        return;
+    }
+
+    scrn_wait_display(Scrn);
+
+    uint32_t primask = irq_save();
+    scrn_enqueue(Scrn);
+    scrn_kick();
+    irq_restore(primask);
+}
+
+void scrn_flush_all(void) {
+    scrn_wait();
+
+    // Queued together, so the frames follow each other on the bus
+    uint32_t primask = irq_save();
+
+    for (unsigned id = 0; id < SCRN_DISPLAYS; id++) {
+        if (scrn_can_flush(&Displays[id])) {
+            scrn_enqueue(&Displays[id]);
+        }
+    }
+
+    scrn_kick();
+    irq_restore(primask);
 }
 
 void scrn_draw(void) {
-    SCRN_MODE_SET(MODE_DATA);
-    for (unsigned byte = 0; byte < SCRN_SIZ_BYTES; byte++) {
-        SPI_send_byte(FrameBuffer[byte]);
+    PROBE_BEGIN(PROBE_SCRN_DRAW);
+
+    scrn_flush();
+
+    if (Scrn->back == NULL) {
+        scrn_wait_display(Scrn);
+    }
+
+    PROBE_END(PROBE_SCRN_DRAW);
+}
+
+void scrn_draw_all(void) {
+    scrn_flush_all();
+
+    for (unsigned id = 0; id < SCRN_DISPLAYS; id++) {
+        if (Displays[id].back == NULL) {
+            scrn_wait_display(&Displays[id]);
+        }
     }
 }
 
 int scrn_set_pxiel(unsigned x, unsigned y) {
-    if (x >= SCRN_WIDTH || y >= SCRN_HEIGHT) {
+    if (Scrn->front == NULL || x >= SCRN_WIDTH || y >= SCRN_HEIGHT) {
         return -SCRN_E_INVAL;
     }
 
     unsigned idx_byte = x + ((y >> 3) << 7);
     unsigned idx_bit  = y & MASK_LOWER(3);
 
-    FrameBuffer[idx_byte] |= (1 << idx_bit);
+    Scrn->front[idx_byte] |= (1 << idx_bit);
 
     return SCRN_OK;
 }
 
 int scrn_clr_pxiel(unsigned x, unsigned y) {
-    if (x >= SCRN_WIDTH || y >= SCRN_HEIGHT) {
+    if (Scrn->front == NULL || x >= SCRN_WIDTH || y >= SCRN_HEIGHT) {
         return -SCRN_E_INVAL;
     }
 
     unsigned idx_byte = x + ((y >> 3) << 7);
     unsigned idx_bit  = y & MASK_LOWER(3);
 
-    FrameBuffer[idx_byte] &= ~(1 << idx_bit);
+    Scrn->front[idx_byte] &= ~(1 << idx_bit);
 
     return SCRN_OK;
 }
 
 int scrn_inv_pxiel(unsigned x, unsigned y) {
-    if (x >= SCRN_WIDTH || y >= SCRN_HEIGHT) {
+    if (Scrn->front == NULL || x >= SCRN_WIDTH || y >= SCRN_HEIGHT) {
         return -SCRN_E_INVAL;
     }
 
     unsigned idx_byte = x + ((y >> 3) << 7);
     unsigned idx_bit  = y & MASK_LOWER(3);
 
-    FrameBuffer[idx_byte] &= ~(1 << idx_bit);
+    Scrn->front[idx_byte] ^= (1 << idx_bit);
 
     return SCRN_OK;
 }
 
 int scrn_xline(unsigned x, unsigned y, unsigned len) {
-    if (x + len >= SCRN_WIDTH || y >= SCRN_HEIGHT) {
+    if (Scrn->front == NULL || x + len > SCRN_WIDTH || y >= SCRN_HEIGHT) {
         return -SCRN_E_INVAL;
     }
 
@@ -189,40 +417,42 @@ int scrn_xline(unsigned x, unsigned y, unsigned len) {
     unsigned idx_bit  = y & MASK_LOWER(3);
 
     for (unsigned i = 0; i < len; i++) {
-        FrameBuffer[idx_byte + i] |= (unsigned char)(1 << idx_bit);
+        Scrn->front[idx_byte + i] |= (unsigned char)(1 << idx_bit);
     }
 
     return SCRN_OK;
 }
 
 int scrn_yline(unsigned x, unsigned y, unsigned len) {
-    if (x >= SCRN_WIDTH || y + len >= SCRN_HEIGHT) {
+    if (Scrn->front == NULL || x >= SCRN_WIDTH || y + len > SCRN_HEIGHT) {
         return -SCRN_E_INVAL;
     }
 
     unsigned idx_byte = x + ((y >> 3) << 7);
     unsigned idx_bit  = y & MASK_LOWER(3);
 
-    FrameBuffer[idx_byte] |= (unsigned char)(MASK_LOWER(len) << idx_bit);
+    // Head of the line fills the first byte row from idx_bit downwards
+    unsigned head = (len < 8 - idx_bit) ? len : 8 - idx_bit;
+    Scrn->front[idx_byte] |= (unsigned char)(MASK_LOWER(head) << idx_bit);
     
     if (len > (8 - idx_bit)) {
         len -= (8 - idx_bit);
         idx_byte += SCRN_WIDTH;
 
         while (len > 8) {
-            FrameBuffer[idx_byte] |= (unsigned char)(MASK_LOWER(8));
+            Scrn->front[idx_byte] |= (unsigned char)(MASK_LOWER(8));
             idx_byte += SCRN_WIDTH;
             len -= 8;
         }
 
-        FrameBuffer[idx_byte] |= (unsigned char)(MASK_LOWER(len));
+        Scrn->front[idx_byte] |= (unsigned char)(MASK_LOWER(len));
     }
     
     return SCRN_OK;
 }
 
 int scrn_box(unsigned x, unsigned y, unsigned x_len, unsigned y_len) {
-    if (x + x_len >= SCRN_WIDTH || y + y_len >= SCRN_HEIGHT) {
+    if (x + x_len > SCRN_WIDTH || y + y_len > SCRN_HEIGHT) {
         return -SCRN_E_INVAL;
     }
 
@@ -237,14 +467,14 @@ int scrn_box(unsigned x, unsigned y, unsigned x_len, unsigned y_len) {
 
 #include "inc/ascii.h"
 int scrn_print(unsigned x, unsigned y, int ch) {
-    if (x >= SCRN_WIDTH - 7 || y >= SCRN_HEIGHT - 7) {
+    if (Scrn->front == NULL || x > SCRN_WIDTH - 8 || y > SCRN_HEIGHT - 8) {
         return -SCRN_E_INVAL;
     }
 
-    const uint8_t (*buf)[8] = Settings.rotated ? ASCII_rot : ASCII;
+    const uint8_t (*buf)[8] = Scrn->rotated ? ASCII_rot : ASCII;
 
     for (unsigned idx = 0; idx < 8; idx++) {
-        FrameBuffer[x++ + ((y >> 3) << 7)] = buf[ch][idx];
+        Scrn->front[x++ + ((y >> 3) << 7)] = buf[(uint8_t) ch][idx];
     }
 
     return SCRN_OK;
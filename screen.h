@@ -1,6 +1,8 @@
 #ifndef SCREEEN_H
 #define SCREEEN_H
 
+#include <stdint.h>
+
 #include "inc/spi.h"
 #include "inc/gpio.h"
 
@@ -8,6 +10,20 @@
 #define DC_PIN  6
 #define RES_PIN 7
 
+// SSD1306 panels on SPI1 share SCK, MOSI, DC and RES, each one has its own
+// chip-select. Display 0 may have CS tied low as on the single-display
+// board; with more displays (make DISPLAYS=2) every one needs its CS wired.
+#ifndef SCRN_DISPLAYS
+#define SCRN_DISPLAYS 1
+#endif
+
+// Chip-selects of the dual-display board
+#define SCRN_CS_PORT GPIOB
+#define SCRN0_CS_PIN 0
+#define SCRN1_CS_PIN 1
+
+#define SCRN_NO_CS 0U // cs_port of a display selected all the time
+
 // DC pin values
 #define MODE_DATA 1
 #define MODE_CMD  0
@@ -23,10 +39,38 @@ enum SCRN_ERR {
 #define SCRN_WIDTH  128
 #define SCRN_HEIGHT 64
 
+// Resets every panel (RES is shared) and sets display 0 up again
 void scrn_init(uint8_t rotated);
+
+// Sends init sequence to display id behind chip-select cs_pin of cs_port
+int scrn_add(unsigned id, uint32_t cs_port, unsigned cs_pin, uint8_t rotated);
+
+// Drawing calls, scrn_set_buffers and scrn_flush go to display id from now on,
+// fb replaces its framebuffer unless NULL
+int scrn_select(unsigned id, uint8_t* fb);
+
+// Guest memory map: front NULL for no framebuffer, back non-NULL for double buffering
+void scrn_set_buffers(uint8_t* front, uint8_t* back);
+
 void scrn_clear(uint8_t value);
+
+// Sends the frame and waits for it unless double-buffered
 void scrn_draw(void);
 
+// Starts sending the frame over DMA and returns: single buffer must not be
+// drawn into before scrn_wait(), double buffers are swapped right away.
+// Frames of other displays on the bus go first
+void scrn_flush(void);
+void scrn_wait(void);
+
+// Frames of all displays back to back, one DMA transfer after another
+void scrn_flush_all(void);
+void scrn_draw_all(void);
+
+// Buffer to draw into, NULL if there is none. Waits for the frame
+// in flight when single-buffered
+uint8_t* scrn_buffer(void);
+
 int scrn_set_pxiel(unsigned x, unsigned y);
 int scrn_clr_pxiel(unsigned x, unsigned y);
 int scrn_inv_pxiel(unsigned x, unsigned y);
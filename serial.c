@@ -0,0 +1,136 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "uart.h"
+#include "ring.h"
+#include "tick.h"
+#include "serial.h"
+
+//=========================================================
+
+/*
+    Both rings have one producer & one consumer (see ring.h):
+        RX: USART1 RXNE interrupt writes, guest reads.
+        TX: guest writes, SysTick hands chunks to DMA.
+*/
+
+struct Serial_state
+{
+    uint8_t rx[SERIAL_RX_SIZE];
+    uint8_t tx[SERIAL_TX_SIZE];
+
+    struct Ring rx_ring;
+    unsigned rx_dropped; // Reported by serial_read so far
+    bool rx_used;        // Guest reads, receive must not stop
+
+    struct Ring tx_ring;
+    uint16_t tx_inflight; // Bytes handed to DMA
+
+    struct Uart* uart;
+};
+
+__attribute__ ((section (".api")))
+static struct Serial_state Serial = { .rx_ring = RING_INIT(Serial.rx, SERIAL_RX_SIZE, 0U),
+                                      .tx_ring = RING_INIT(Serial.tx, SERIAL_TX_SIZE, 0U) };
+
+//=========================================================
+
+int serial_init(struct Uart* uart)
+{
+    int err = ring_init(&Serial.rx_ring, Serial.rx, SERIAL_RX_SIZE, 0U);
+    if (err < 0) return err;
+
+    err = uart_recv_stream(uart, &Serial.rx_ring);
+    if (err < 0) return err;
+
+    Serial.rx_dropped = 0U;
+    Serial.uart = uart;
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+int serial_write(const void* buf, unsigned len)
+{
+    if (buf == NULL && len != 0U)
+        return UART_INV_PTR;
+
+    if (Serial.uart == NULL)
+        return UART_TRNS_DIS;
+
+    unsigned written = ring_write(&Serial.tx_ring, buf, len);
+
+    // Drained from SysTick
+    if (written != 0U)
+        tick_request(1U);
+
+    return (int) written;
+}
+
+//---------------------------------------------------------
+
+int serial_read(void* buf, unsigned max)
+{
+    if (buf == NULL && max != 0U)
+        return UART_INV_PTR;
+
+    if (Serial.uart == NULL)
+        return UART_RECV_DIS;
+
+    Serial.rx_used = true;
+
+    // Bytes that came with the ring full were dropped: told once, what is queued stays
+    unsigned dropped = uart_recv_dropped();
+
+    if (dropped != Serial.rx_dropped)
+    {
+        Serial.rx_dropped = dropped;
+        return UART_RECV_ORE;
+    }
+
+    return (int) ring_read(&Serial.rx_ring, buf, max);
+}
+
+//---------------------------------------------------------
+
+void serial_flush(void)
+{
+    if (Serial.uart == NULL)
+        return;
+
+    // Channel is busy: look again on the next tick if there is anything to send
+    if (is_trns_complete() == 0)
+    {
+        if (Serial.tx_inflight != 0U || ring_used(&Serial.tx_ring) != 0U)
+            tick_request(1U);
+
+        return;
+    }
+
+    // Previous chunk is out, its bytes can be reused
+    ring_consume(&Serial.tx_ring, Serial.tx_inflight);
+    Serial.tx_inflight = 0U;
+
+    // DMA needs contiguous memory: send up to the end of the ring first
+    unsigned chunk = 0U;
+    const void* start = ring_peek(&Serial.tx_ring, &chunk);
+
+    if (chunk == 0U)
+        return;
+
+    if (uart_trns_buffer(Serial.uart, start, chunk) == 0)
+        Serial.tx_inflight = (uint16_t) chunk;
+
+    tick_request(1U);
+}
+
+//---------------------------------------------------------
+
+bool serial_rx_in_use(void)
+{
+    return Serial.rx_used;
+}
@@ -0,0 +1,31 @@
+#pragma once 
+
+//=========================================================
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "uart.h"
+
+//=========================================================
+
+#define SERIAL_RX_SIZE 64U // Power of two
+#define SERIAL_TX_SIZE 64U // Power of two
+
+//=========================================================
+
+// Start interrupt-driven receive into the ring, loader must be done with it
+int serial_init(struct Uart* uart);
+
+// Queue up to len bytes for transmit, returns number of bytes accepted
+int serial_write(const void* buf, unsigned len);
+
+// Take up to max received bytes, returns number of bytes copied.
+// UART_RECV_ORE once after bytes were lost to a full ring, next call reads on
+int serial_read(void* buf, unsigned max);
+
+// Start DMA transmit of queued bytes, called on SysTick
+void serial_flush(void);
+
+// Guest has read from serial, incoming bytes would be lost in Stop mode
+bool serial_rx_in_use(void);
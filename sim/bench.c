@@ -0,0 +1,514 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+//---------------------------------------------------------
+
+#include "../inc/rcc.h"
+#include "kernels.h"
+#include "panel.h"
+#include "thumb.h"
+#include "board.h"
+
+//=========================================================
+
+/*
+    Microbenchmarks of screen.c and crc.c: every kernel is run over a
+    sweep of sizes, positions and alignments, natively (ns per call,
+    best of several batches) and, given the Cortex-M0 build of the same
+    kernels (-m, see bench-m0 in Makefile), on the instruction simulator
+    (cycles from entry to return, exact for zero wait state memory).
+
+    Output is CSV, one line per case in fixed order:
+
+        kernel,params,ns_per_op,m0_cycles
+
+    params is "name=value" pairs separated by ';'. With a previous run
+    as baseline (-b) two more columns give the change in percent, and
+    geometric mean of the ratios per kernel goes to stderr.
+*/
+
+#define BENCH_MAX_CASES 256U
+
+#define BENCH_M0_RAM_SIZE  0x00010000U // RAM_SIZE in bench.lds
+#define BENCH_M0_MAX_CYCLES 10000000U
+
+// RCC and CRC registers crc.c writes to
+#define BENCH_WINDOW_BASE REG_RCC
+#define BENCH_WINDOW_SIZE 0x3000U
+
+#define BENCH_DEFAULT_BATCH_MS 2U
+#define BENCH_DEFAULT_REPEATS  5U
+
+struct Case
+{
+    unsigned kernel;
+    uint32_t arg[4];
+
+    double ns;      // NAN without native run
+    int64_t cycles; // -1 without M0 build
+
+    // Baseline, NAN and -1 if the case is not there
+    double base_ns;
+    int64_t base_cycles;
+};
+
+struct Kernel_info
+{
+    const char* name;
+    const char* params[4];
+};
+
+static const struct Kernel_info Kernel_infos[KERNELS_NUM] =
+{
+    [KERNEL_SET_PIXEL] = { "set_pixel", { "x", "y" } },
+    [KERNEL_INV_PIXEL] = { "inv_pixel", { "x", "y" } },
+    [KERNEL_XLINE]     = { "xline",     { "x", "y", "len" } },
+    [KERNEL_YLINE]     = { "yline",     { "x", "y", "len" } },
+    [KERNEL_BOX]       = { "box",       { "x", "y", "x_len", "y_len" } },
+    [KERNEL_PUTS]      = { "puts",      { "x", "y", "len" } },
+    [KERNEL_CLEAR]     = { "clear",     { "value" } },
+    [KERNEL_DRAW]      = { "draw",      { NULL } },
+    [KERNEL_CRC]       = { "crc32",     { "align", "size" } }
+};
+
+static struct Case Cases[BENCH_MAX_CASES];
+static unsigned Cases_num = 0U;
+
+//=========================================================
+
+static void add_case(unsigned kernel, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    if (Cases_num == BENCH_MAX_CASES)
+    {
+        fprintf(stderr, "too many cases, raise BENCH_MAX_CASES\n");
+        exit(EXIT_FAILURE);
+    }
+
+    Cases[Cases_num++] = (struct Case) { .kernel = kernel,
+                                         .arg = { a0, a1, a2, a3 },
+                                         .ns = NAN,
+                                         .cycles = -1,
+                                         .base_ns = NAN,
+                                         .base_cycles = -1 };
+}
+
+//---------------------------------------------------------
+
+// Sweeps: edits here change the case set, keep old ones for baselines
+static void build_cases(void)
+{
+    add_case(KERNEL_SET_PIXEL, 0U, 0U, 0U, 0U);
+    add_case(KERNEL_SET_PIXEL, 127U, 63U, 0U, 0U);
+    add_case(KERNEL_INV_PIXEL, 64U, 37U, 0U, 0U);
+
+    static const uint32_t xlens[] = { 1U, 8U, 32U, 64U, 128U };
+    for (unsigned ind = 0; ind < sizeof(xlens) / sizeof(xlens[0]); ind++)
+    {
+        add_case(KERNEL_XLINE, 0U, 0U, xlens[ind], 0U);
+        add_case(KERNEL_XLINE, 0U, 37U, xlens[ind], 0U);
+    }
+
+    // Start inside a byte row: head, whole rows and tail
+    static const uint32_t ylens[] = { 1U, 3U, 8U, 16U, 32U, 64U };
+    static const uint32_t ys[] = { 0U, 3U, 7U };
+    for (unsigned ind = 0; ind < sizeof(ylens) / sizeof(ylens[0]); ind++)
+    {
+        for (unsigned pos = 0; pos < sizeof(ys) / sizeof(ys[0]); pos++)
+        {
+            if (ys[pos] + ylens[ind] <= PANEL_HEIGHT)
+                add_case(KERNEL_YLINE, 5U, ys[pos], ylens[ind], 0U);
+        }
+    }
+
+    add_case(KERNEL_BOX, 10U, 10U, 8U, 8U);
+    add_case(KERNEL_BOX, 3U, 5U, 40U, 20U);
+    add_case(KERNEL_BOX, 0U, 0U, 128U, 64U);
+
+    static const uint32_t text_lens[] = { 1U, 4U, 16U };
+    for (unsigned ind = 0; ind < sizeof(text_lens) / sizeof(text_lens[0]); ind++)
+    {
+        add_case(KERNEL_PUTS, 0U, 0U, text_lens[ind], 0U);
+        add_case(KERNEL_PUTS, 0U, 35U, text_lens[ind], 0U);
+    }
+
+    add_case(KERNEL_CLEAR, 0x00U, 0U, 0U, 0U);
+    add_case(KERNEL_DRAW, 0U, 0U, 0U, 0U);
+
+    static const uint32_t crc_sizes[] = { 4U, 16U, 64U, 256U, 1024U };
+    for (unsigned ind = 0; ind < sizeof(crc_sizes) / sizeof(crc_sizes[0]); ind++)
+    {
+        for (uint32_t align = 0; align < 4U; align++)
+            add_case(KERNEL_CRC, align, crc_sizes[ind], 0U, 0U);
+    }
+}
+
+//---------------------------------------------------------
+
+static void case_params(const struct Case* item, char* buf, size_t size)
+{
+    const struct Kernel_info* info = &Kernel_infos[item->kernel];
+    size_t pos = 0U;
+
+    buf[0] = '\0';
+
+    for (unsigned ind = 0; ind < 4U && info->params[ind] != NULL && pos < size; ind++)
+    {
+        pos += (size_t) snprintf(buf + pos, size - pos, "%s%s=%u", (ind == 0U)? "" : ";",
+                                 info->params[ind], item->arg[ind]);
+    }
+}
+
+//=========================================================
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+//---------------------------------------------------------
+
+static double batch_ns(Kernel kernel, const uint32_t* arg, unsigned iters)
+{
+    double start = now_ns();
+
+    for (unsigned iter = 0; iter < iters; iter++)
+        kernel(arg[0], arg[1], arg[2], arg[3]);
+
+    return now_ns() - start;
+}
+
+//---------------------------------------------------------
+
+// Best of several batches: noise on the host only ever adds time
+static double native_ns(const struct Case* item, double batch_ms, unsigned repeats)
+{
+    Kernel kernel = Kernels[item->kernel];
+    unsigned iters = 1U;
+
+    while (iters < (1U << 30) && batch_ns(kernel, item->arg, iters) < batch_ms * 1e6)
+        iters *= 2U;
+
+    double best = INFINITY;
+
+    for (unsigned rep = 0; rep < repeats; rep++)
+    {
+        double ns = batch_ns(kernel, item->arg, iters) / iters;
+        if (ns < best)
+            best = ns;
+    }
+
+    return best;
+}
+
+//---------------------------------------------------------
+
+static int native_window(void)
+{
+    void* window = mmap((void*)(uintptr_t) BENCH_WINDOW_BASE, BENCH_WINDOW_SIZE,
+                        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    return (window == (void*)(uintptr_t) BENCH_WINDOW_BASE)? 0 : -1;
+}
+
+//=========================================================
+
+static uint8_t* load_file(const char* path, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    uint8_t* data = calloc(1U, BENCH_M0_RAM_SIZE);
+    if (data != NULL)
+    {
+        *size = fread(data, 1U, BENCH_M0_RAM_SIZE, file);
+
+        if (*size == 0U || !feof(file))
+        {
+            free(data);
+            data = NULL;
+        }
+    }
+
+    fclose(file);
+    return data;
+}
+
+//---------------------------------------------------------
+
+// Cycles of one call from kernel entry until it returns, <0 on fault
+static int64_t m0_cycles(struct Cpu* cpu, const struct Case* item)
+{
+    uint32_t entry = 0U;
+    memcpy(&entry, cpu->ram + 4U * item->kernel, sizeof(entry));
+
+    for (unsigned ind = 0; ind < 4U; ind++)
+        cpu->r[ind] = item->arg[ind];
+
+    cpu->r[CPU_REG_SP] = SIM_RAM_BASE + BENCH_M0_RAM_SIZE;
+    cpu->r[CPU_REG_LR] = SIM_TRAP_BASE | 1U;
+    cpu->r[CPU_REG_PC] = entry & ~1U;
+
+    uint64_t start = cpu->cycles;
+
+    int res = cpu_run(cpu, start + BENCH_M0_MAX_CYCLES);
+    if (res != CPU_TRAP)
+        return res;
+
+    return (int64_t) (cpu->cycles - start);
+}
+
+//---------------------------------------------------------
+
+static int run_m0(const char* path)
+{
+    size_t size = 0U;
+    uint8_t* ram = load_file(path, &size);
+
+    if (ram == NULL || size < 4U * KERNELS_NUM)
+    {
+        fprintf(stderr, "%s: can not load image\n", path);
+        return -1;
+    }
+
+    struct Cpu cpu = { .ram = ram,
+                       .ram_base = SIM_RAM_BASE,
+                       .ram_size = BENCH_M0_RAM_SIZE,
+                       .trap_base = SIM_TRAP_BASE,
+                       .trap_size = 4U };
+
+    for (unsigned ind = 0; ind < Cases_num; ind++)
+    {
+        int64_t cycles = m0_cycles(&cpu, &Cases[ind]);
+
+        if (cycles < 0)
+        {
+            fprintf(stderr, "%s: %s stopped with %d at pc 0x%08x, address 0x%08x\n", path,
+                    Kernel_infos[Cases[ind].kernel].name, (int) cycles, cpu.fault_pc, cpu.fault_addr);
+            free(ram);
+            return -1;
+        }
+
+        Cases[ind].cycles = cycles;
+    }
+
+    free(ram);
+    return 0;
+}
+
+//=========================================================
+
+static void load_baseline(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+    {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    char line[256], params[128];
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        char* field[4] = { line };
+        unsigned num = 1U;
+
+        for (char* ch = line; *ch != '\0' && *ch != '\n' && num < 4U; ch++)
+        {
+            if (*ch == ',')
+            {
+                *ch = '\0';
+                field[num++] = ch + 1;
+            }
+        }
+
+        if (num < 4U)
+            continue;
+
+        for (unsigned ind = 0; ind < Cases_num; ind++)
+        {
+            case_params(&Cases[ind], params, sizeof(params));
+
+            if (strcmp(field[0], Kernel_infos[Cases[ind].kernel].name) != 0 || strcmp(field[1], params) != 0)
+                continue;
+
+            char* end = NULL;
+            Cases[ind].base_ns = strtod(field[2], &end);
+            if (end == field[2])
+                Cases[ind].base_ns = NAN;
+
+            Cases[ind].base_cycles = strtoll(field[3], &end, 10);
+
+            if (end == field[3])
+                Cases[ind].base_cycles = -1;
+        }
+    }
+
+    fclose(file);
+}
+
+//---------------------------------------------------------
+
+static void print_change(double now, double base, bool valid)
+{
+    if (valid && base > 0.0)
+        printf(",%+.1f", (now / base - 1.0) * 100.0);
+    else
+        printf(",");
+}
+
+//---------------------------------------------------------
+
+static void print_results(bool baseline)
+{
+    char params[128];
+
+    printf("kernel,params,ns_per_op,m0_cycles%s\n", baseline? ",ns_change_pct,m0_change_pct" : "");
+
+    for (unsigned ind = 0; ind < Cases_num; ind++)
+    {
+        const struct Case* item = &Cases[ind];
+        case_params(item, params, sizeof(params));
+
+        printf("%s,%s,", Kernel_infos[item->kernel].name, params);
+
+        if (!isnan(item->ns))
+            printf("%.2f", item->ns);
+
+        printf(",");
+
+        if (item->cycles >= 0)
+            printf("%lld", (long long) item->cycles);
+
+        if (baseline)
+        {
+            print_change(item->ns, item->base_ns, !isnan(item->ns) && !isnan(item->base_ns));
+            print_change((double) item->cycles, (double) item->base_cycles,
+                         item->cycles >= 0 && item->base_cycles >= 0);
+        }
+
+        printf("\n");
+    }
+
+    if (!baseline)
+        return;
+
+    // Geometric mean over the cases both runs have
+    for (unsigned kernel = 0; kernel < KERNELS_NUM; kernel++)
+    {
+        double ns_log = 0.0, cycles_log = 0.0;
+        unsigned ns_num = 0U, cycles_num = 0U;
+
+        for (unsigned ind = 0; ind < Cases_num; ind++)
+        {
+            const struct Case* item = &Cases[ind];
+            if (item->kernel != kernel)
+                continue;
+
+            if (!isnan(item->ns) && !isnan(item->base_ns) && item->base_ns > 0.0)
+            {
+                ns_log += log(item->ns / item->base_ns);
+                ns_num++;
+            }
+
+            if (item->cycles > 0 && item->base_cycles > 0)
+            {
+                cycles_log += log((double) item->cycles / (double) item->base_cycles);
+                cycles_num++;
+            }
+        }
+
+        fprintf(stderr, "%-10s", Kernel_infos[kernel].name);
+
+        if (ns_num != 0U)
+            fprintf(stderr, "  native x%.3f", exp(ns_log / ns_num));
+
+        if (cycles_num != 0U)
+            fprintf(stderr, "  m0 x%.3f", exp(cycles_log / cycles_num));
+
+        fprintf(stderr, "\n");
+    }
+}
+
+//=========================================================
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [-m m0_image] [-b baseline.csv] [-t batch_ms] [-r repeats] [-n]\n"
+            "    -m  Cortex-M0 build of the kernels for cycle counts\n"
+            "    -b  earlier output to compare with\n"
+            "    -t  native batch length, default: %u ms\n"
+            "    -r  native batches per case, best one counts, default: %u\n"
+            "    -n  skip native runs\n",
+            name, BENCH_DEFAULT_BATCH_MS, BENCH_DEFAULT_REPEATS);
+}
+
+//---------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    const char* m0_image = NULL;
+    const char* baseline = NULL;
+    double batch_ms = BENCH_DEFAULT_BATCH_MS;
+    unsigned repeats = BENCH_DEFAULT_REPEATS;
+    bool native = true;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "m:b:t:r:nh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm': m0_image = optarg;                              break;
+            case 'b': baseline = optarg;                              break;
+            case 't': batch_ms = strtod(optarg, NULL);                break;
+            case 'r': repeats = (unsigned) strtoul(optarg, NULL, 0);  break;
+            case 'n': native = false;                                 break;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (batch_ms <= 0.0 || repeats == 0U)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    build_cases();
+
+    if (native)
+    {
+        if (panel_init() < 0 || native_window() < 0)
+        {
+            fprintf(stderr, "can not map peripheral windows\n");
+            return EXIT_FAILURE;
+        }
+
+        for (unsigned ind = 0; ind < Cases_num; ind++)
+            Cases[ind].ns = native_ns(&Cases[ind], batch_ms, repeats);
+    }
+
+    if (m0_image != NULL && run_m0(m0_image) < 0)
+        return EXIT_FAILURE;
+
+    if (baseline != NULL)
+        load_baseline(baseline);
+
+    print_results(baseline != NULL);
+
+    return EXIT_SUCCESS;
+}
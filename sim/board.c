@@ -0,0 +1,1025 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------
+
+#include "../common/api.h"
+#include "../screen.h"
+#include "../clock.h"
+#include "../power.h"
+#include "../kvstore.h"
+#include "../link.h"
+#include "../sound.h"
+#include "../common/assets.h"
+#include "../memstat.h"
+#include "../memmap.h"
+
+#include "thumb.h"
+#include "panel.h"
+#include "board.h"
+
+//=========================================================
+
+#define SCRN_BYTES PANEL_BYTES
+
+#define API_ENTRIES     (sizeof(struct API) / sizeof(void (*)(void)))
+#define API_INDEX(NAME) (offsetof(struct API, NAME) / sizeof(void (*)(void)))
+
+// Guest returning from umain without user.S lands here
+#define TRAP_EXIT API_ENTRIES
+// frame_run callbacks return here
+#define TRAP_FRAME (API_ENTRIES + 1U)
+#define TRAP_ENTRIES (TRAP_FRAME + 1U)
+
+//---------------------------------------------------------
+
+static const uint32_t Level_hz[CLOCK_LEVELS_NUM] = { 8000000U, 24000000U, 48000000U };
+
+struct Kv_value
+{
+    bool used;
+    uint8_t size;
+    uint8_t data[KV_MAX_VALUE_SIZE];
+};
+
+// struct Frame_loop as the guest lays it out
+struct Guest_frame_loop
+{
+    uint32_t update;
+    uint32_t render;
+    uint32_t ctx;
+    uint32_t period_ms;
+};
+
+struct Board
+{
+    struct Cpu cpu;
+    uint8_t ram[SIM_RAM_SIZE];
+
+    struct Kv_value kv[KV_MAX_KEYS];
+
+    const struct Trace* trace;
+    unsigned level;
+    int status;
+
+    // Frame accounting
+    uint64_t frame_start;
+    uint64_t level_mark;
+    double frame_ms;
+
+    uint64_t* frame_cycles;
+    struct Board_stats* stats;
+
+    // Guest area painted for stack high-water mark, as memstat.c does
+    uint32_t image_end;
+    struct Mem_map map;
+
+    // Call has sent the guest elsewhere, r0 and pc are not the result
+    bool jumped;
+
+    // Probe table as probe.c keeps it, host regions stay empty
+    struct Probe_stats probes[PROBE_IDS];
+
+    // frame_run in progress: which callback runs, where frame_run returns to
+    struct
+    {
+        bool active;
+        bool rendering;
+        struct Guest_frame_loop loop;
+        uint32_t ret;
+    } frame;
+};
+
+static struct Board Board = { 0 };
+
+//=========================================================
+
+int board_init(void)
+{
+    return (panel_init() < 0)? BOARD_NO_WINDOW : 0;
+}
+
+//=========================================================
+
+static void charge(uint64_t cycles)
+{
+    Board.cpu.cycles += cycles;
+}
+
+//---------------------------------------------------------
+
+// Fold cycles run at current clock level into frame time
+static void account_level(void)
+{
+    uint64_t cycles = Board.cpu.cycles - Board.level_mark;
+
+    Board.frame_ms += (double) cycles * 1e3 / Level_hz[Board.level];
+    Board.level_mark = Board.cpu.cycles;
+}
+
+//---------------------------------------------------------
+
+static void frame_end(void)
+{
+    struct Board_stats* stats = Board.stats;
+
+    account_level();
+
+    uint64_t cycles = Board.cpu.cycles - Board.frame_start;
+
+    if (stats->frames == 0U || cycles < stats->frame_min)
+        stats->frame_min = cycles;
+    if (cycles > stats->frame_max)
+        stats->frame_max = cycles;
+    if (Board.frame_ms > stats->frame_ms_max)
+        stats->frame_ms_max = Board.frame_ms;
+
+    stats->frame_sum += cycles;
+    stats->frame_ms_sum += Board.frame_ms;
+
+    Board.frame_cycles[stats->frames++] = cycles;
+
+    Board.frame_start = Board.cpu.cycles;
+    Board.frame_ms = 0.0;
+
+    if (stats->frames >= Board.trace->frames)
+        Board.status = BOARD_DONE;
+}
+
+//---------------------------------------------------------
+
+static void* guest_ptr(uint32_t addr, unsigned size)
+{
+    uint32_t offs = addr - SIM_RAM_BASE;
+    if (offs > SIM_RAM_SIZE || size > SIM_RAM_SIZE - offs)
+        return NULL;
+
+    return Board.ram + offs;
+}
+
+//=========================================================
+// Host API, arguments are r0..r3 of the guest
+//=========================================================
+
+/*
+    Firmware cost of the calls in cycles, rough numbers for -O0 build
+    at 48 MHz: draw is 1 KiB pushed byte by byte through SPI_send_byte,
+    flash programming takes ~50 us per half-word.
+*/
+enum Hle_costs
+{
+    COST_CALL       = 20,
+    COST_PIXEL      = 40,
+    COST_LINE_STEP  = 10,
+    COST_CHAR       = 120,
+    COST_CLEAR_BYTE = 8,
+    COST_DRAW_BYTE  = 40,
+    COST_KV_BYTE    = 4,
+    COST_FLASH_HW   = 2400,
+    COST_COPY_BYTE  = 1,    // memops.S
+    COST_COPY_SLOW  = 4,    // Source and destination differ in alignment
+    COST_DIV        = 60,   // divops.S, divisor in the reciprocal table
+    COST_FLUSH      = 200,  // DMA channel setup, transfer runs alongside
+    COST_LEVEL      = 2000 // PLL relock
+};
+
+typedef uint32_t (*Hle_call)(const uint32_t* arg);
+
+//---------------------------------------------------------
+
+static uint32_t hle_led(const uint32_t* arg)
+{
+    (void) arg;
+    return 0U;
+}
+
+static uint32_t hle_button(const uint32_t* arg)
+{
+    if (arg[0] >= BUTTONS_NUM)
+        return (uint32_t) -1;
+
+    const struct Trace* trace = Board.trace;
+    unsigned frame = Board.stats->frames;
+
+    if (trace->masks == NULL || frame >= trace->frames)
+        return 0U;
+
+    return (trace->masks[frame] >> arg[0]) & 1U;
+}
+
+//---------------------------------------------------------
+
+static uint32_t hle_scrn_clear(const uint32_t* arg)
+{
+    scrn_clear((uint8_t) arg[0]);
+    charge(COST_CLEAR_BYTE * SCRN_BYTES);
+    return 0U;
+}
+
+static uint32_t hle_scrn_draw(const uint32_t* arg)
+{
+    (void) arg;
+
+    scrn_draw();
+    charge(COST_DRAW_BYTE * SCRN_BYTES);
+
+    frame_end();
+    return 0U;
+}
+
+// Panel model is display 0, others exist on DISPLAYS=2 boards only
+static uint32_t hle_scrn_select(const uint32_t* arg)
+{
+    uint8_t* fb = NULL;
+
+    if (arg[1] != 0U)
+    {
+        fb = guest_ptr(arg[1], SCRN_BYTES);
+        if (fb == NULL)
+            return (uint32_t) -SCRN_E_INVAL;
+    }
+
+    return (uint32_t) scrn_select(arg[0], fb);
+}
+
+static uint32_t hle_scrn_draw_all(const uint32_t* arg)
+{
+    (void) arg;
+
+    scrn_draw_all();
+    charge(COST_DRAW_BYTE * SCRN_BYTES);
+
+    frame_end();
+    return 0U;
+}
+
+//---------------------------------------------------------
+
+// TIM2 counts CPU cycles, so does the simulator
+static uint32_t hle_probe_now(const uint32_t* arg)
+{
+    (void) arg;
+
+    charge(COST_CALL);
+    return (uint32_t) Board.cpu.cycles;
+}
+
+static uint32_t hle_probe_add(const uint32_t* arg)
+{
+    charge(COST_CALL);
+
+    if (arg[0] >= PROBE_GUEST_IDS)
+        return (uint32_t) PROBE_INV_ARG;
+
+    struct Probe_stats* probe = &Board.probes[PROBE_GUEST + arg[0]];
+
+    if (probe->count == 0U || arg[1] < probe->min)
+        probe->min = arg[1];
+
+    if (arg[1] > probe->max)
+        probe->max = arg[1];
+
+    probe->total += arg[1];
+    probe->count++;
+
+    return 0U;
+}
+
+static uint32_t hle_probe_take(const uint32_t* arg)
+{
+    charge(COST_CALL);
+
+    uint8_t* dst = guest_ptr(arg[1], sizeof(struct Probe_stats));
+    if (arg[0] >= PROBE_IDS || dst == NULL)
+        return (uint32_t) PROBE_INV_ARG;
+
+    memcpy(dst, &Board.probes[arg[0]], sizeof(struct Probe_stats));
+    memset(&Board.probes[arg[0]], 0, sizeof(struct Probe_stats));
+
+    return 0U;
+}
+
+static uint32_t hle_scrn_set_pxl(const uint32_t* arg)
+{
+    charge(COST_PIXEL);
+    return (uint32_t) scrn_set_pxiel(arg[0], arg[1]);
+}
+
+static uint32_t hle_scrn_clr_pxl(const uint32_t* arg)
+{
+    charge(COST_PIXEL);
+    return (uint32_t) scrn_clr_pxiel(arg[0], arg[1]);
+}
+
+static uint32_t hle_scrn_inv_pxl(const uint32_t* arg)
+{
+    charge(COST_PIXEL);
+    return (uint32_t) scrn_inv_pxiel(arg[0], arg[1]);
+}
+
+static uint32_t hle_scrn_puts(const uint32_t* arg)
+{
+    char* str = guest_ptr(arg[2], arg[3]);
+    if (str == NULL)
+        return (uint32_t) -SCRN_E_INVAL;
+
+    charge(COST_CHAR * (uint64_t) arg[3]);
+    return (uint32_t) scrn_puts(arg[0], arg[1], str, arg[3]);
+}
+
+static uint32_t hle_scrn_xline(const uint32_t* arg)
+{
+    charge(COST_PIXEL + COST_LINE_STEP * (uint64_t) arg[2]);
+    return (uint32_t) scrn_xline(arg[0], arg[1], arg[2]);
+}
+
+static uint32_t hle_scrn_yline(const uint32_t* arg)
+{
+    charge(COST_PIXEL + COST_LINE_STEP * (uint64_t) arg[2]);
+    return (uint32_t) scrn_yline(arg[0], arg[1], arg[2]);
+}
+
+static uint32_t hle_scrn_box(const uint32_t* arg)
+{
+    charge(COST_PIXEL + 2U * COST_LINE_STEP * ((uint64_t) arg[2] + arg[3]));
+    return (uint32_t) scrn_box(arg[0], arg[1], arg[2], arg[3]);
+}
+
+//---------------------------------------------------------
+
+// Store keeps values in RAM only, every job starts with empty one
+static uint32_t hle_kv_read(const uint32_t* arg)
+{
+    uint8_t* data = guest_ptr(arg[1], arg[2]);
+    if (arg[0] >= KV_MAX_KEYS || (data == NULL && arg[2] != 0U))
+        return (uint32_t) KV_INV_ARG;
+
+    struct Kv_value* value = &Board.kv[arg[0]];
+    if (!value->used)
+        return (uint32_t) KV_NOT_FOUND;
+
+    unsigned size = (arg[2] < value->size)? arg[2] : value->size;
+    memcpy(data, value->data, size);
+
+    charge(COST_CALL + COST_KV_BYTE * size);
+    return value->size;
+}
+
+static uint32_t hle_kv_write(const uint32_t* arg)
+{
+    const uint8_t* data = guest_ptr(arg[1], arg[2]);
+    if (arg[0] >= KV_MAX_KEYS || arg[2] > KV_MAX_VALUE_SIZE || (data == NULL && arg[2] != 0U))
+        return (uint32_t) KV_INV_ARG;
+
+    struct Kv_value* value = &Board.kv[arg[0]];
+    value->used = true;
+    value->size = (uint8_t) arg[2];
+    memcpy(value->data, data, arg[2]);
+
+    // Record header, data and commit half-words
+    charge(COST_FLASH_HW * ((arg[2] + 1U) / 2U + 3U));
+    return 0U;
+}
+
+static uint32_t hle_kv_erase(const uint32_t* arg)
+{
+    if (arg[0] >= KV_MAX_KEYS)
+        return (uint32_t) KV_INV_ARG;
+
+    Board.kv[arg[0]].used = false;
+
+    charge(COST_FLASH_HW * 3U);
+    return 0U;
+}
+
+//---------------------------------------------------------
+
+static uint32_t hle_set_perf_level(const uint32_t* arg)
+{
+    if (arg[0] >= CLOCK_LEVELS_NUM)
+        return (uint32_t) CLOCK_INV_LEVEL;
+
+    if (arg[0] != Board.level)
+    {
+        account_level();
+        Board.level = arg[0];
+        charge(COST_LEVEL);
+    }
+
+    return 0U;
+}
+
+// Sleeping is not a CPU load, time is only reported
+static uint32_t hle_idle(const uint32_t* arg)
+{
+    unsigned timeout = (arg[0] > POWER_MAX_IDLE_MS)? POWER_MAX_IDLE_MS : arg[0];
+
+    Board.stats->idle_ms += timeout;
+    return POWER_WAKE_TIMEOUT;
+}
+
+static uint32_t hle_log_write(const uint32_t* arg)
+{
+    charge(COST_CALL + 10U * (uint64_t) arg[1]);
+
+    Board.stats->log_msgs++;
+    return 0U;
+}
+
+//---------------------------------------------------------
+
+// Nobody on the other end of serial line and link in the farm
+static uint32_t hle_serial_write(const uint32_t* arg)
+{
+    charge(COST_CALL + COST_KV_BYTE * (uint64_t) arg[1]);
+    return arg[1];
+}
+
+static uint32_t hle_serial_read(const uint32_t* arg)
+{
+    (void) arg;
+
+    charge(COST_CALL);
+    return 0U;
+}
+
+static uint32_t hle_link_start(const uint32_t* arg)
+{
+    return (arg[0] > LINK_DELAY_MAX)? (uint32_t) LINK_INV_ARG : 0U;
+}
+
+static uint32_t hle_link_step(const uint32_t* arg)
+{
+    (void) arg;
+
+    charge(COST_CALL);
+    return (uint32_t) LINK_WAIT;
+}
+
+//---------------------------------------------------------
+
+// Board is silent: arguments are checked, mixing in DMA interrupts is not charged
+static uint32_t hle_sound_play(const uint32_t* arg)
+{
+    charge(COST_CALL);
+
+    if (arg[0] >= SOUND_VOICES)
+        return (uint32_t) SOUND_INV_VOICE;
+
+    if (arg[1] == 0U || arg[1] > SOUND_MAX_FREQ || arg[2] > SOUND_MAX_MS || arg[3] > SOUND_MAX_VOLUME)
+        return (uint32_t) SOUND_INV_ARG;
+
+    return 0U;
+}
+
+static uint32_t hle_sound_stop(const uint32_t* arg)
+{
+    charge(COST_CALL);
+    return (arg[0] > SOUND_ALL)? (uint32_t) SOUND_INV_VOICE : 0U;
+}
+
+//---------------------------------------------------------
+
+// Board has no asset pack uploaded
+static uint32_t hle_asset_none(const uint32_t* arg)
+{
+    (void) arg;
+
+    charge(COST_CALL);
+    return (uint32_t) ASSET_NOT_FOUND;
+}
+
+static uint32_t hle_asset_map(const uint32_t* arg)
+{
+    (void) arg;
+
+    charge(COST_CALL);
+    return 0U;
+}
+
+//---------------------------------------------------------
+
+// Lowest offset in RAM the stack has reached
+static uint32_t stack_floor(void)
+{
+    uint32_t offs = Board.map.stack_limit - SIM_RAM_BASE;
+
+    while (offs < SIM_RAM_SIZE)
+    {
+        uint32_t word = 0U;
+        memcpy(&word, Board.ram + offs, 4U);
+
+        if (word != MEMSTAT_PAINT)
+            break;
+
+        offs += 4U;
+    }
+
+    return offs;
+}
+
+static uint32_t hle_mem_usage(const uint32_t* arg)
+{
+    struct Mem_usage usage = { 0 };
+
+    uint8_t* dst = guest_ptr(arg[0], sizeof(usage));
+    if (dst == NULL)
+        return (uint32_t) MEMSTAT_INV_ARG;
+
+    uint32_t floor = stack_floor();
+
+    usage.image_size = Board.image_end - SIM_USER_OFFS;
+    usage.stack_max = SIM_RAM_SIZE - floor;
+    usage.free_min = floor - Board.image_end;
+    usage.stack_reserved = Board.map.stack_size;
+
+    memcpy(dst, &usage, sizeof(usage));
+
+    charge(COST_CALL);
+    return 0U;
+}
+
+static uint32_t hle_mem_map(const uint32_t* arg)
+{
+    uint8_t* dst = guest_ptr(arg[0], sizeof(struct Mem_map));
+    if (dst == NULL)
+        return (uint32_t) MEMMAP_INV_ARG;
+
+    memcpy(dst, &Board.map, sizeof(struct Mem_map));
+
+    charge(COST_CALL);
+    return 0U;
+}
+
+// Firmware does not check the blocks, bad one faults at the first access
+static void hle_mem_fault(uint32_t addr)
+{
+    Board.cpu.fault_pc = Board.cpu.r[CPU_REG_LR] & ~1U;
+    Board.cpu.fault_addr = addr;
+    Board.status = BOARD_FAULT;
+}
+
+static uint32_t hle_mem_move(const uint32_t* arg)
+{
+    uint8_t* dst = guest_ptr(arg[0], arg[2]);
+    const uint8_t* src = guest_ptr(arg[1], arg[2]);
+
+    if (dst == NULL || src == NULL)
+    {
+        hle_mem_fault((dst == NULL)? arg[0] : arg[1]);
+        return arg[0];
+    }
+
+    memmove(dst, src, arg[2]);
+
+    uint32_t cost = ((arg[0] ^ arg[1]) & 3U)? COST_COPY_SLOW : COST_COPY_BYTE;
+    charge(cost * (uint64_t) arg[2]);
+    return arg[0];
+}
+
+static uint32_t hle_mem_fill(const uint32_t* arg)
+{
+    uint8_t* dst = guest_ptr(arg[0], arg[2]);
+
+    if (dst == NULL)
+    {
+        hle_mem_fault(arg[0]);
+        return arg[0];
+    }
+
+    memset(dst, (int) arg[1], arg[2]);
+
+    charge(COST_COPY_BYTE * (uint64_t) arg[2]);
+    return arg[0];
+}
+
+// Remainder goes to r1, as from __aeabi_uidivmod
+static uint32_t hle_div_u32(const uint32_t* arg)
+{
+    uint32_t quot = (arg[1] == 0U)? 0U : arg[0] / arg[1];
+
+    Board.cpu.r[1] = arg[0] - quot * arg[1];
+
+    charge(COST_DIV);
+    return quot;
+}
+
+static uint32_t hle_div_s32(const uint32_t* arg)
+{
+    int32_t num = (int32_t) arg[0], den = (int32_t) arg[1];
+    int32_t quot = 0;
+
+    if (den == -1)
+        quot = (int32_t) (0U - arg[0]);
+    else if (den != 0)
+        quot = num / den;
+
+    Board.cpu.r[1] = arg[0] - (uint32_t) quot * arg[1];
+
+    charge(COST_DIV);
+    return (uint32_t) quot;
+}
+
+//---------------------------------------------------------
+
+// Guest function at addr returns to TRAP_FRAME
+static void guest_call(uint32_t addr, uint32_t arg0, uint32_t arg1, uint32_t arg2)
+{
+    struct Cpu* cpu = &Board.cpu;
+
+    cpu->r[0] = arg0;
+    cpu->r[1] = arg1;
+    cpu->r[2] = arg2;
+    cpu->r[CPU_REG_LR] = (SIM_TRAP_BASE + 4U * TRAP_FRAME) | 1U;
+    cpu->r[CPU_REG_PC] = addr & ~1U;
+
+    Board.jumped = true;
+}
+
+static void frame_update(void)
+{
+    const struct Trace* trace = Board.trace;
+    unsigned frame = Board.stats->frames;
+    unsigned buttons = (trace->masks == NULL || frame >= trace->frames)? 0U : trace->masks[frame];
+
+    Board.frame.rendering = false;
+    guest_call(Board.frame.loop.update, Board.frame.loop.ctx, Board.frame.loop.period_ms, buttons);
+}
+
+static void frame_render(void)
+{
+    uint8_t* fb = scrn_buffer();
+    uint32_t addr = (fb == NULL)? 0U : SIM_RAM_BASE + (uint32_t) (fb - Board.ram);
+
+    Board.frame.rendering = true;
+    guest_call(Board.frame.loop.render, Board.frame.loop.ctx, addr, 0U);
+}
+
+// One update per frame: the trace has one input mask for each,
+// time the board would sleep until the next tick is not modelled
+static uint32_t hle_frame_run(const uint32_t* arg)
+{
+    const void* loop = guest_ptr(arg[0], sizeof(Board.frame.loop));
+
+    if (loop == NULL)
+        return (uint32_t) FRAME_RUN_INV_ARG;
+
+    memcpy(&Board.frame.loop, loop, sizeof(Board.frame.loop));
+
+    const struct Guest_frame_loop* guest = &Board.frame.loop;
+    if (guest->update == 0U || guest->render == 0U ||
+        guest->period_ms == 0U || guest->period_ms > FRAME_MAX_PERIOD_MS)
+        return (uint32_t) FRAME_RUN_INV_ARG;
+
+    Board.frame.active = true;
+    Board.frame.ret = Board.cpu.r[CPU_REG_LR];
+
+    frame_update();
+    return 0U;
+}
+
+// Callback has returned
+static void serve_frame(void)
+{
+    struct Cpu* cpu = &Board.cpu;
+
+    if (Board.frame.active == false)
+    {
+        Board.status = BOARD_FAULT;
+        return;
+    }
+
+    if (Board.frame.rendering == true)
+    {
+        scrn_flush();
+        charge(COST_FLUSH);
+        frame_end();
+
+        frame_update();
+        return;
+    }
+
+    if (cpu->r[0] != 0U)
+    {
+        Board.frame.active = false;
+        cpu->r[CPU_REG_PC] = Board.frame.ret & ~1U;
+        return;
+    }
+
+    frame_render();
+}
+
+//---------------------------------------------------------
+
+// Entries missing here are NULL in API_host as well (see api.c)
+static const Hle_call Hle_calls[API_ENTRIES] =
+{
+    [API_INDEX(blue_led_on)]       = hle_led,
+    [API_INDEX(green_led_on)]      = hle_led,
+    [API_INDEX(blue_led_off)]      = hle_led,
+    [API_INDEX(green_led_off)]     = hle_led,
+    [API_INDEX(is_button_pressed)] = hle_button,
+    [API_INDEX(scrn_clear)]        = hle_scrn_clear,
+    [API_INDEX(scrn_draw)]         = hle_scrn_draw,
+    [API_INDEX(scrn_set_pxl)]      = hle_scrn_set_pxl,
+    [API_INDEX(scrn_clr_pxl)]      = hle_scrn_clr_pxl,
+    [API_INDEX(scrn_inv_pxl)]      = hle_scrn_inv_pxl,
+    [API_INDEX(scrn_puts)]         = hle_scrn_puts,
+    [API_INDEX(scrn_xline)]        = hle_scrn_xline,
+    [API_INDEX(scrn_yline)]        = hle_scrn_yline,
+    [API_INDEX(scrn_box)]          = hle_scrn_box,
+    [API_INDEX(kv_read)]           = hle_kv_read,
+    [API_INDEX(kv_write)]          = hle_kv_write,
+    [API_INDEX(kv_erase)]          = hle_kv_erase,
+    [API_INDEX(set_perf_level)]    = hle_set_perf_level,
+    [API_INDEX(idle)]              = hle_idle,
+    [API_INDEX(log_write)]         = hle_log_write,
+    [API_INDEX(serial_write)]      = hle_serial_write,
+    [API_INDEX(serial_read)]       = hle_serial_read,
+    [API_INDEX(link_start)]        = hle_link_start,
+    [API_INDEX(link_step)]         = hle_link_step,
+    [API_INDEX(sound_play)]        = hle_sound_play,
+    [API_INDEX(sound_stop)]        = hle_sound_stop,
+    [API_INDEX(asset_size)]        = hle_asset_none,
+    [API_INDEX(asset_map)]         = hle_asset_map,
+    [API_INDEX(asset_read)]        = hle_asset_none,
+    [API_INDEX(mem_usage)]         = hle_mem_usage,
+    [API_INDEX(mem_map)]           = hle_mem_map,
+    [API_INDEX(mem_copy)]          = hle_mem_move,
+    [API_INDEX(mem_fill)]          = hle_mem_fill,
+    [API_INDEX(mem_move)]          = hle_mem_move,
+    [API_INDEX(div_u32)]           = hle_div_u32,
+    [API_INDEX(div_s32)]           = hle_div_s32,
+    [API_INDEX(frame_run)]         = hle_frame_run,
+    [API_INDEX(scrn_select)]       = hle_scrn_select,
+    [API_INDEX(scrn_draw_all)]     = hle_scrn_draw_all,
+    [API_INDEX(probe_now)]         = hle_probe_now,
+    [API_INDEX(probe_add)]         = hle_probe_add,
+    [API_INDEX(probe_take)]        = hle_probe_take,
+};
+
+//---------------------------------------------------------
+
+static void serve_trap(void)
+{
+    struct Cpu* cpu = &Board.cpu;
+    uint32_t entry = (cpu->r[CPU_REG_PC] - SIM_TRAP_BASE) / 4U;
+
+    if (entry == TRAP_EXIT)
+    {
+        Board.status = BOARD_HALT;
+        return;
+    }
+
+    if (entry == TRAP_FRAME)
+    {
+        serve_frame();
+        return;
+    }
+
+    if (entry >= API_ENTRIES || Hle_calls[entry] == NULL)
+    {
+        // Real board jumps to NULL and faults
+        cpu->fault_pc = cpu->r[CPU_REG_LR] & ~1U;
+        cpu->fault_addr = cpu->r[CPU_REG_PC];
+        Board.status = BOARD_FAULT;
+        return;
+    }
+
+    Board.stats->api_calls++;
+    charge(COST_CALL);
+
+    Board.jumped = false;
+
+    uint32_t res = Hle_calls[entry](cpu->r);
+    if (Board.jumped == true)
+        return;
+
+    cpu->r[0] = res;
+
+    // Caller-saved registers are clobbered by AAPCS anyway
+    cpu->r[CPU_REG_PC] = cpu->r[CPU_REG_LR] & ~1U;
+}
+
+//=========================================================
+
+static int board_reset(const uint8_t* image, size_t size)
+{
+    memset(&Board, 0, sizeof(Board));
+
+    // Framebuffer slot lies in host SRAM below the guest, as on the board
+    const struct Memmap_area area = { .start = SIM_RAM_BASE + SIM_USER_OFFS,
+                                      .end = SIM_RAM_BASE + SIM_RAM_SIZE,
+                                      .framebuffer = SIM_RAM_BASE + SIM_USER_OFFS - SCRN_BYTES,
+                                      .fb_size = SCRN_BYTES };
+
+    int err = memmap_plan(memmap_request(image, (uint32_t) size), (uint32_t) size, &area, &Board.map);
+    if (err < 0) return BOARD_INV_IMAGE;
+
+    memcpy(Board.ram + SIM_USER_OFFS, image, size);
+
+    // Guest starts with an empty stack: paint all the way to the top
+    Board.image_end = (SIM_USER_OFFS + (uint32_t) size + 3U) & ~3U;
+
+    for (uint32_t offs = Board.image_end; offs < SIM_RAM_SIZE; offs += 4U)
+        memcpy(Board.ram + offs, &(uint32_t) { MEMSTAT_PAINT }, 4U);
+
+    // API table in host SRAM, Thumb bit set as in real function pointers
+    for (unsigned entry = 0; entry < API_ENTRIES; entry++)
+    {
+        uint32_t addr = (SIM_TRAP_BASE + 4U * entry) | 1U;
+        memcpy(Board.ram + (SIM_API_ADDR - SIM_RAM_BASE) + 4U * entry, &addr, 4U);
+    }
+
+    struct Cpu* cpu = &Board.cpu;
+
+    cpu->ram = Board.ram;
+    cpu->ram_base = SIM_RAM_BASE;
+    cpu->ram_size = SIM_RAM_SIZE;
+    cpu->trap_base = SIM_TRAP_BASE;
+    cpu->trap_size = 4U * TRAP_ENTRIES;
+
+    cpu->r[0] = SIM_API_ADDR;
+    cpu->r[CPU_REG_SP] = SIM_RAM_BASE + SIM_RAM_SIZE;
+    cpu->r[CPU_REG_LR] = (SIM_TRAP_BASE + 4U * TRAP_EXIT) | 1U;
+    cpu->r[CPU_REG_PC] = SIM_RAM_BASE + SIM_USER_OFFS;
+
+    // Guest starts right after the loader switched to it
+    Board.level = CLOCK_LEVEL_HIGH;
+
+    scrn_set_buffers(Board.map.framebuffer? Board.ram + (Board.map.framebuffer - SIM_RAM_BASE) : NULL,
+                     Board.map.back_buffer? Board.ram + (Board.map.back_buffer - SIM_RAM_BASE) : NULL);
+
+    scrn_clear(0x00);
+    panel_reset();
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+static int cmp_cycles(const void* lhs, const void* rhs)
+{
+    uint64_t a = *(const uint64_t*) lhs;
+    uint64_t b = *(const uint64_t*) rhs;
+
+    return (a > b) - (a < b);
+}
+
+//---------------------------------------------------------
+
+int board_run(const uint8_t* image, size_t size, const struct Trace* trace,
+              uint64_t cycle_limit, struct Board_stats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    if (size == 0U || size > SIM_RAM_SIZE - SIM_USER_OFFS)
+        return BOARD_INV_IMAGE;
+
+    if (trace->frames == 0U)
+        return BOARD_INV_TRACE;
+
+    uint64_t* frame_cycles = calloc(trace->frames, sizeof(uint64_t));
+    if (frame_cycles == NULL)
+        return BOARD_NO_MEMORY;
+
+    int err = board_reset(image, size);
+    if (err < 0)
+    {
+        free(frame_cycles);
+        return err;
+    }
+
+    Board.trace = trace;
+    Board.stats = stats;
+    Board.frame_cycles = frame_cycles;
+
+    struct Cpu* cpu = &Board.cpu;
+
+    while (Board.status == BOARD_RUNNING)
+    {
+        switch (cpu_run(cpu, cycle_limit))
+        {
+            case CPU_TRAP:  serve_trap();                break;
+            case CPU_HALT:  Board.status = BOARD_HALT;   break;
+            case CPU_LIMIT: Board.status = BOARD_BUDGET; break;
+            case CPU_UNDEF: Board.status = BOARD_UNDEF;  break;
+            case CPU_BKPT:  Board.status = BOARD_BKPT;   break;
+            default:        Board.status = BOARD_FAULT;  break;
+        }
+    }
+
+    stats->cycles = cpu->cycles;
+    stats->insns = cpu->insns;
+    stats->fault_pc = cpu->fault_pc;
+    stats->fault_addr = cpu->fault_addr;
+    stats->stack_max = SIM_RAM_SIZE - stack_floor();
+
+    if (stats->frames != 0U)
+    {
+        qsort(frame_cycles, stats->frames, sizeof(uint64_t), cmp_cycles);
+        stats->frame_p95 = frame_cycles[(stats->frames * 95U) / 100U];
+    }
+
+    free(frame_cycles);
+    return Board.status;
+}
+
+//=========================================================
+
+int trace_load(struct Trace* trace, const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+        return BOARD_INV_TRACE;
+
+    trace->masks = NULL;
+    trace->frames = 0U;
+
+    unsigned capacity = 0U;
+    char line[128];
+    int err = 0;
+
+    while (err == 0 && fgets(line, sizeof(line), file) != NULL)
+    {
+        char* comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+
+        char* end = NULL;
+        unsigned long mask = strtoul(line, &end, 0);
+        if (end == line)
+        {
+            // Blank lines are fine, anything else is not a trace
+            if (strspn(line, " \t\r\n") != strlen(line))
+                err = BOARD_INV_TRACE;
+
+            continue;
+        }
+
+        unsigned long repeat = strtoul(end, NULL, 0);
+        if (repeat == 0U)
+            repeat = 1U;
+
+        if (mask >= (1U << BUTTONS_NUM) || repeat > SIM_TRACE_MAX_FRAMES - trace->frames)
+        {
+            err = BOARD_INV_TRACE;
+            continue;
+        }
+
+        if (trace->frames + repeat > capacity)
+        {
+            capacity = (unsigned) (2U * (trace->frames + repeat));
+
+            uint8_t* masks = realloc(trace->masks, capacity);
+            if (masks == NULL)
+            {
+                err = BOARD_NO_MEMORY;
+                continue;
+            }
+
+            trace->masks = masks;
+        }
+
+        memset(trace->masks + trace->frames, (int) mask, repeat);
+        trace->frames += (unsigned) repeat;
+    }
+
+    fclose(file);
+
+    if (err == 0 && trace->frames == 0U)
+        err = BOARD_INV_TRACE;
+
+    if (err < 0)
+    {
+        free(trace->masks);
+        trace->masks = NULL;
+    }
+
+    return err;
+}
+
+//---------------------------------------------------------
+
+const char* board_status_str(int status)
+{
+    switch (status)
+    {
+        case BOARD_RUNNING:   return "running";
+        case BOARD_DONE:      return "done";
+        case BOARD_HALT:      return "halt";
+        case BOARD_BUDGET:    return "budget";
+        case BOARD_FAULT:     return "FAULT";
+        case BOARD_UNDEF:     return "UNDEF";
+        case BOARD_BKPT:      return "BKPT";
+        case BOARD_INV_IMAGE: return "bad image";
+        case BOARD_INV_TRACE: return "bad trace";
+        case BOARD_NO_MEMORY: return "no memory";
+        case BOARD_NO_WINDOW: return "no window";
+        default:              return "?";
+    }
+}
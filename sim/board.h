@@ -0,0 +1,93 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+#include <stdlib.h>
+
+//=========================================================
+
+/*
+    Simulated board: guest image runs on the instruction simulator,
+    host API calls trap out of it and are served natively. Screen calls
+    run the firmware's own screen.c, the frame leaves it through SPI
+    into the panel model (see panel.h), as on the real display.
+
+    Guest cycles are counted exactly, host calls are charged rough
+    estimates of their firmware cost (see Hle_costs in board.c).
+
+    Frame ends on scrn_draw or render of frame_run, buttons come from an input trace with one
+    mask per frame. One board per process: screen.c keeps its frame
+    buffer in a global.
+*/
+
+#define SIM_RAM_BASE  0x20000000U
+#define SIM_RAM_SIZE  0x00002000U
+#define SIM_USER_OFFS 0x00000A00U // USER_OFFS in main.c
+#define SIM_STACK_RESERVED 0x100U // USER_LOAD_STACK_SIZE (MEM_MIN_STACK) in main.c
+
+// API table lives in host part of SRAM, entries point to trap window
+#define SIM_API_ADDR  SIM_RAM_BASE
+#define SIM_TRAP_BASE 0x1FFF0000U // System memory, never executed by guests
+
+#define SIM_TRACE_MAX_FRAMES 1000000U
+
+enum Board_status
+{
+    BOARD_RUNNING   =  0,
+    BOARD_DONE      =  1, // Input trace is over
+    BOARD_HALT      =  2, // umain returned
+    BOARD_BUDGET    =  3, // Cycle limit reached
+    BOARD_FAULT     = -1, // HardFault on real board
+    BOARD_UNDEF     = -2,
+    BOARD_BKPT      = -3,
+    BOARD_INV_IMAGE = -4,
+    BOARD_INV_TRACE = -5,
+    BOARD_NO_MEMORY = -6,
+    BOARD_NO_WINDOW = -7  // Peripheral window can not be mapped
+};
+
+struct Trace
+{
+    uint8_t* masks; // Buttons of every frame, NULL for no input
+    unsigned frames;
+};
+
+struct Board_stats
+{
+    unsigned frames;
+    uint64_t cycles;
+    uint64_t insns;
+
+    // Cycles per frame
+    uint64_t frame_min;
+    uint64_t frame_max;
+    uint64_t frame_sum;
+    uint64_t frame_p95;
+
+    // Frame time at the clock level guest was running at
+    double frame_ms_sum;
+    double frame_ms_max;
+
+    unsigned api_calls;
+    unsigned idle_ms;
+    unsigned log_msgs;
+
+    uint32_t fault_pc;
+    uint32_t fault_addr;
+
+    uint32_t stack_max; // Deepest guest stack in bytes
+};
+
+//=========================================================
+
+// Map peripheral window used by screen.c, once per process
+int board_init(void);
+
+// Text trace: "<mask> [repeat]" per line, '#' starts comment
+int trace_load(struct Trace* trace, const char* path);
+
+int board_run(const uint8_t* image, size_t size, const struct Trace* trace,
+              uint64_t cycle_limit, struct Board_stats* stats);
+
+const char* board_status_str(int status);
@@ -0,0 +1,504 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+//---------------------------------------------------------
+
+#include "board.h"
+
+//=========================================================
+
+/*
+    Simulator farm: every guest is run against every input trace, each
+    job on a fresh board. Workers are forked processes, one per core,
+    so a guest crashing the simulator takes down only its own job.
+
+    Jobs are dealt round-robin into per-worker deques in shared memory.
+    A worker takes jobs from the bottom of its own deque and, once it is
+    empty, steals from the top of the others' (Chase-Lev): long traces
+    do not leave cores idle at the end of the sweep.
+*/
+
+#define FARM_MAX_FILES 256U
+
+#define FARM_DEFAULT_FRAMES  600U // Input-less trace, 10 s at 60 FPS
+#define FARM_DEFAULT_MCYCLES 2000U
+
+enum Job_state
+{
+    JOB_PENDING = 0,
+    JOB_RUNNING = 1,
+    JOB_FINISHED = 2,
+    JOB_CRASHED = 3
+};
+
+struct Deque
+{
+    int64_t top;
+    int64_t bottom;
+    uint32_t* jobs;
+};
+
+struct Job_result
+{
+    int state;
+    int status;
+    int worker;
+    double wall_s;
+    struct Board_stats stats;
+};
+
+struct Shared
+{
+    uint64_t steals;
+    struct Job_result results[];
+};
+
+struct Guest
+{
+    const char* path;
+    uint8_t* image;
+    size_t size;
+};
+
+struct Input
+{
+    const char* path;
+    struct Trace trace;
+};
+
+struct Farm
+{
+    struct Guest guests[FARM_MAX_FILES];
+    unsigned guests_num;
+
+    struct Input inputs[FARM_MAX_FILES];
+    unsigned inputs_num;
+
+    unsigned jobs_num;
+    unsigned workers_num;
+    uint64_t cycle_limit;
+
+    struct Deque* deques;
+    struct Shared* shared;
+};
+
+static struct Farm Farm = { 0 };
+
+//=========================================================
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+//---------------------------------------------------------
+
+static int image_load(struct Guest* guest)
+{
+    FILE* file = fopen(guest->path, "rb");
+    if (file == NULL)
+        return BOARD_INV_IMAGE;
+
+    guest->image = malloc(SIM_RAM_SIZE);
+    guest->size = (guest->image == NULL)? 0U : fread(guest->image, 1U, SIM_RAM_SIZE, file);
+
+    fclose(file);
+
+    return (guest->size == 0U)? BOARD_INV_IMAGE : 0;
+}
+
+//=========================================================
+
+// Owner end, no pushes after workers start
+static int64_t deque_pop(struct Deque* deque)
+{
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if (top > bottom)
+    {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+
+    int64_t job = deque->jobs[bottom];
+
+    // Last job: race against thieves
+    if (top == bottom)
+    {
+        if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            job = -1;
+
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+
+    return job;
+}
+
+//---------------------------------------------------------
+
+// Thief end, -1 if empty, -2 if lost the race
+static int64_t deque_steal(struct Deque* deque)
+{
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+    if (top >= bottom)
+        return -1;
+
+    int64_t job = deque->jobs[top];
+
+    if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return -2;
+
+    return job;
+}
+
+//---------------------------------------------------------
+
+static int64_t next_job(unsigned worker)
+{
+    int64_t job = deque_pop(&Farm.deques[worker]);
+    if (job >= 0)
+        return job;
+
+    // Sweep victims until all deques are seen empty
+    bool contended = true;
+    while (contended)
+    {
+        contended = false;
+
+        for (unsigned iter = 1; iter < Farm.workers_num; iter++)
+        {
+            job = deque_steal(&Farm.deques[(worker + iter) % Farm.workers_num]);
+            if (job >= 0)
+            {
+                __atomic_fetch_add(&Farm.shared->steals, 1U, __ATOMIC_RELAXED);
+                return job;
+            }
+
+            if (job == -2)
+                contended = true;
+        }
+    }
+
+    return -1;
+}
+
+//---------------------------------------------------------
+
+static void run_job(unsigned job, int worker)
+{
+    struct Job_result* result = &Farm.shared->results[job];
+    const struct Guest* guest = &Farm.guests[job / Farm.inputs_num];
+    const struct Input* input = &Farm.inputs[job % Farm.inputs_num];
+
+    result->worker = worker;
+    __atomic_store_n(&result->state, JOB_RUNNING, __ATOMIC_RELEASE);
+
+    double start = now_s();
+    result->status = board_run(guest->image, guest->size, &input->trace,
+                               Farm.cycle_limit, &result->stats);
+    result->wall_s = now_s() - start;
+
+    __atomic_store_n(&result->state, JOB_FINISHED, __ATOMIC_RELEASE);
+}
+
+//---------------------------------------------------------
+
+static void worker_main(unsigned worker)
+{
+    int64_t job = 0;
+    while ((job = next_job(worker)) >= 0)
+        run_job((unsigned) job, (int) worker);
+
+    exit(EXIT_SUCCESS);
+}
+
+//=========================================================
+
+static int farm_setup(void)
+{
+    Farm.jobs_num = Farm.guests_num * Farm.inputs_num;
+    if (Farm.workers_num > Farm.jobs_num)
+        Farm.workers_num = Farm.jobs_num;
+
+    size_t deques_size = Farm.workers_num * (sizeof(struct Deque) + Farm.jobs_num * sizeof(uint32_t));
+    size_t shared_size = sizeof(struct Shared) + Farm.jobs_num * sizeof(struct Job_result);
+
+    Farm.deques = mmap(NULL, deques_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    Farm.shared = mmap(NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (Farm.deques == MAP_FAILED || Farm.shared == MAP_FAILED)
+        return BOARD_NO_MEMORY;
+
+    uint32_t* slots = (uint32_t*) &Farm.deques[Farm.workers_num];
+
+    for (unsigned worker = 0; worker < Farm.workers_num; worker++)
+        Farm.deques[worker].jobs = slots + worker * Farm.jobs_num;
+
+    for (unsigned job = 0; job < Farm.jobs_num; job++)
+    {
+        struct Deque* deque = &Farm.deques[job % Farm.workers_num];
+        deque->jobs[deque->bottom++] = job;
+    }
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+static void farm_run(void)
+{
+    pid_t* pids = calloc(Farm.workers_num, sizeof(pid_t));
+
+    for (unsigned worker = 0; worker < Farm.workers_num; worker++)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+            worker_main(worker);
+
+        // Failed fork is fine: its deque is drained by thieves
+        pids[worker] = pid;
+    }
+
+    for (unsigned worker = 0; worker < Farm.workers_num; worker++)
+    {
+        int wstatus = 0;
+        if (pids[worker] <= 0 || waitpid(pids[worker], &wstatus, 0) < 0)
+            continue;
+
+        if (WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == EXIT_SUCCESS)
+            continue;
+
+        // Job the worker was on when it died
+        for (unsigned job = 0; job < Farm.jobs_num; job++)
+        {
+            struct Job_result* result = &Farm.shared->results[job];
+            if (result->state == JOB_RUNNING && result->worker == (int) worker)
+                result->state = JOB_CRASHED;
+        }
+    }
+
+    free(pids);
+
+    // Jobs left in deques of dead workers nobody stole in time
+    for (unsigned job = 0; job < Farm.jobs_num; job++)
+    {
+        if (Farm.shared->results[job].state == JOB_PENDING)
+            run_job(job, -1);
+    }
+}
+
+//=========================================================
+
+static void report(FILE* out, double wall_s)
+{
+    const struct Job_result* results = Farm.shared->results;
+
+    fprintf(out, "%-20s %-20s %-9s %7s %9s %9s %9s %9s %8s %8s %6s\n",
+            "guest", "trace", "status", "frames", "Mcycles",
+            "cyc/f min", "mean", "p95", "max", "ms max", "stack");
+
+    uint64_t insns = 0U;
+    unsigned failed = 0U;
+
+    for (unsigned job = 0; job < Farm.jobs_num; job++)
+    {
+        const struct Job_result* result = &results[job];
+        const struct Board_stats* stats = &result->stats;
+
+        const char* status = (result->state == JOB_CRASHED)? "CRASH" : board_status_str(result->status);
+
+        fprintf(out, "%-20.20s %-20.20s %-9s %7u %9.1f %9llu %9llu %9llu %9llu %8.2f %6u",
+                Farm.guests[job / Farm.inputs_num].path,
+                Farm.inputs[job % Farm.inputs_num].path,
+                status, stats->frames, (double) stats->cycles * 1e-6,
+                (unsigned long long) stats->frame_min,
+                (unsigned long long) (stats->frames? stats->frame_sum / stats->frames : 0U),
+                (unsigned long long) stats->frame_p95,
+                (unsigned long long) stats->frame_max,
+                stats->frame_ms_max, stats->stack_max);
+
+        if (result->state == JOB_CRASHED || result->status < 0)
+        {
+            fprintf(out, "  pc 0x%08x addr 0x%08x", stats->fault_pc, stats->fault_addr);
+            failed++;
+        }
+
+        fprintf(out, "\n");
+        insns += stats->insns;
+    }
+
+    fprintf(out, "\n%-20s %7s %9s %9s %8s %8s %6s\n",
+            "guest", "frames", "Mcycles", "cyc/f", "ms mean", "ms max", "failed");
+
+    for (unsigned ind = 0; ind < Farm.guests_num; ind++)
+    {
+        unsigned frames = 0U, guest_failed = 0U;
+        uint64_t cycles = 0U, frame_sum = 0U;
+        double ms_sum = 0.0, ms_max = 0.0;
+
+        for (unsigned job = ind * Farm.inputs_num; job < (ind + 1U) * Farm.inputs_num; job++)
+        {
+            const struct Board_stats* stats = &results[job].stats;
+
+            frames    += stats->frames;
+            cycles    += stats->cycles;
+            frame_sum += stats->frame_sum;
+            ms_sum    += stats->frame_ms_sum;
+
+            if (stats->frame_ms_max > ms_max)
+                ms_max = stats->frame_ms_max;
+
+            if (results[job].state == JOB_CRASHED || results[job].status < 0)
+                guest_failed++;
+        }
+
+        fprintf(out, "%-20.20s %7u %9.1f %9llu %8.2f %8.2f %6u\n",
+                Farm.guests[ind].path, frames, (double) cycles * 1e-6,
+                (unsigned long long) (frames? frame_sum / frames : 0U),
+                frames? ms_sum / frames : 0.0, ms_max, guest_failed);
+    }
+
+    fprintf(out, "\n%u job(s) on %u worker(s) in %.2f s, %llu steal(s), %.0f MIPS, %u failed\n",
+            Farm.jobs_num, Farm.workers_num, wall_s,
+            (unsigned long long) Farm.shared->steals,
+            (double) insns * 1e-6 / wall_s, failed);
+}
+
+//=========================================================
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [-j workers] [-t trace]... [-f frames] [-c Mcycles] [-o report] guest.bin...\n"
+            "    -j  worker processes, default: number of cores\n"
+            "    -t  input trace, \"<mask> [repeat]\" per line; default: no input for -f frames\n"
+            "    -f  frames of the default trace, default: %u\n"
+            "    -c  cycle budget of a job in millions, default: %u\n"
+            "    -o  write report to file instead of stdout\n",
+            name, FARM_DEFAULT_FRAMES, FARM_DEFAULT_MCYCLES);
+}
+
+//---------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    Farm.workers_num = (cores > 0)? (unsigned) cores : 1U;
+    Farm.cycle_limit = FARM_DEFAULT_MCYCLES * 1000000ULL;
+
+    unsigned frames = FARM_DEFAULT_FRAMES;
+    const char* out_path = NULL;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "j:t:f:c:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'j': Farm.workers_num = (unsigned) strtoul(optarg, NULL, 0);          break;
+            case 'f': frames = (unsigned) strtoul(optarg, NULL, 0);                    break;
+            case 'c': Farm.cycle_limit = strtoull(optarg, NULL, 0) * 1000000ULL;       break;
+            case 'o': out_path = optarg;                                               break;
+
+            case 't':
+                if (Farm.inputs_num == FARM_MAX_FILES)
+                {
+                    fprintf(stderr, "too many traces\n");
+                    return EXIT_FAILURE;
+                }
+
+                Farm.inputs[Farm.inputs_num++].path = optarg;
+                break;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (optind == argc || argc - optind > (int) FARM_MAX_FILES ||
+        Farm.workers_num == 0U || frames == 0U || frames > SIM_TRACE_MAX_FRAMES)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (int arg = optind; arg < argc; arg++)
+    {
+        struct Guest* guest = &Farm.guests[Farm.guests_num++];
+        guest->path = argv[arg];
+
+        if (image_load(guest) < 0)
+        {
+            fprintf(stderr, "%s: can not load guest image\n", guest->path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (unsigned ind = 0; ind < Farm.inputs_num; ind++)
+    {
+        int err = trace_load(&Farm.inputs[ind].trace, Farm.inputs[ind].path);
+        if (err < 0)
+        {
+            fprintf(stderr, "%s: %s\n", Farm.inputs[ind].path, board_status_str(err));
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (Farm.inputs_num == 0U)
+    {
+        Farm.inputs[0].path = "-";
+        Farm.inputs[0].trace.frames = frames;
+        Farm.inputs_num = 1U;
+    }
+
+    if (board_init() < 0 || farm_setup() < 0)
+    {
+        fprintf(stderr, "can not set up boards\n");
+        return EXIT_FAILURE;
+    }
+
+    double start = now_s();
+    farm_run();
+    double wall_s = now_s() - start;
+
+    FILE* out = stdout;
+    if (out_path != NULL && (out = fopen(out_path, "w")) == NULL)
+    {
+        perror(out_path);
+        return EXIT_FAILURE;
+    }
+
+    report(out, wall_s);
+
+    if (out != stdout)
+        fclose(out);
+
+    for (unsigned job = 0; job < Farm.jobs_num; job++)
+    {
+        const struct Job_result* result = &Farm.shared->results[job];
+        if (result->state == JOB_CRASHED || result->status < 0)
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
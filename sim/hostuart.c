@@ -0,0 +1,291 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+
+//---------------------------------------------------------
+
+#include "../uart.h"
+#include "hostuart.h"
+
+//=========================================================
+
+#define HOST_UART_POLL_MS 1
+
+struct Host_uart
+{
+    int fd;
+    double byte_time;
+    double bit_error_rate;
+    double start;
+
+    // Line: next byte can not finish before line_free
+    double line_free;
+    double last_rx;
+    bool rto_armed;
+
+    uint8_t pending[256];
+    size_t pending_num;
+    size_t pending_pos;
+
+    // Receive "DMA"
+    uint8_t* recv_buf;
+    size_t recv_size;
+    size_t recv_pos;
+    bool recv_complete;
+    int recv_err;
+
+    // Transmit "DMA": bytes reach the other end once they are out on the wire
+    uint8_t trns_buf[256];
+    size_t trns_num;
+    double trns_done;
+
+    struct Host_uart_stats stats;
+};
+
+static struct Host_uart Host = { .fd = -1, .recv_complete = true };
+
+volatile unsigned Host_ticks = 0U;
+
+//=========================================================
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+//---------------------------------------------------------
+
+void host_uart_init(int fd, unsigned baudrate, double bit_error_rate, unsigned seed)
+{
+    memset(&Host, 0, sizeof(Host));
+
+    Host.fd = fd;
+    Host.byte_time = (double) HOST_UART_BITS_PER_BYTE / baudrate;
+    Host.bit_error_rate = bit_error_rate;
+    Host.start = now_s();
+    Host.recv_complete = true;
+    Host.stats.first_rx = -1.0;
+
+    srand(seed);
+}
+
+//---------------------------------------------------------
+
+double host_uart_time(void)
+{
+    return now_s() - Host.start;
+}
+
+//---------------------------------------------------------
+
+void host_uart_stats(struct Host_uart_stats* stats, int reset)
+{
+    *stats = Host.stats;
+
+    if (reset)
+    {
+        memset(&Host.stats, 0, sizeof(Host.stats));
+        Host.stats.first_rx = -1.0;
+    }
+}
+
+//=========================================================
+
+static void recv_complete_routine(int err)
+{
+    Host.recv_complete = true;
+    Host.recv_err = err;
+}
+
+//---------------------------------------------------------
+
+// Flipped bits out of 8 data bits and parity
+static uint8_t line_noise(uint8_t* byte)
+{
+    unsigned flips = 0U;
+
+    for (unsigned bit = 0; bit < 9U; bit++)
+    {
+        if ((double) rand() / RAND_MAX >= Host.bit_error_rate)
+            continue;
+
+        if (bit < 8U)
+            *byte ^= (uint8_t) (1U << bit);
+
+        flips++;
+    }
+
+    return (uint8_t) flips;
+}
+
+//---------------------------------------------------------
+
+static void line_receive(uint8_t byte, double at)
+{
+    Host.stats.rx_bytes++;
+
+    if (Host.stats.first_rx < 0.0)
+        Host.stats.first_rx = at - Host.start;
+
+    Host.last_rx = at;
+    Host.rto_armed = true;
+
+    unsigned flips = (Host.bit_error_rate > 0.0)? line_noise(&byte) : 0U;
+
+    // DMA has moved the byte by the time error interrupt comes
+    Host.recv_buf[Host.recv_pos++] = byte;
+
+    if (flips & 1U)
+    {
+        Host.stats.parity_errs++;
+        recv_complete_routine(UART_RECV_PE);
+        return;
+    }
+
+    if (flips != 0U)
+        Host.stats.silent_errs++;
+
+    if (Host.recv_pos == Host.recv_size)
+        recv_complete_routine(0);
+}
+
+//---------------------------------------------------------
+
+static void line_poll(bool wait)
+{
+    double now = now_s();
+
+    // Nothing was on the line meanwhile: it can not catch up afterwards
+    if (Host.pending_pos == Host.pending_num && Host.line_free < now - Host.byte_time)
+        Host.line_free = now - Host.byte_time;
+
+    // Bytes due after the receive completed wait for the next one: firmware
+    // rearms within microseconds on the board, one poll here spans a millisecond
+    while (!Host.recv_complete && Host.line_free + Host.byte_time <= now)
+    {
+        if (Host.pending_pos == Host.pending_num)
+        {
+            ssize_t res = read(Host.fd, Host.pending, sizeof(Host.pending));
+            if (res <= 0)
+                break;
+
+            Host.pending_num = (size_t) res;
+            Host.pending_pos = 0U;
+        }
+
+        Host.line_free += Host.byte_time;
+        line_receive(Host.pending[Host.pending_pos++], Host.line_free);
+    }
+
+    if (!Host.recv_complete && Host.rto_armed && now - Host.last_rx >= HOST_UART_RTO_SEC)
+        recv_complete_routine(0);
+
+    if (now - Host.last_rx >= HOST_UART_RTO_SEC)
+        Host.rto_armed = false;
+
+    if (Host.trns_num != 0U && now >= Host.trns_done)
+    {
+        ssize_t res = write(Host.fd, Host.trns_buf, Host.trns_num);
+        (void) res;
+
+        Host.trns_num = 0U;
+    }
+
+    // Firmware spins on these calls, do not burn the core
+    if (wait)
+    {
+        struct pollfd pfd = { .fd = Host.fd, .events = POLLIN };
+        poll(&pfd, 1, HOST_UART_POLL_MS);
+    }
+
+    Host_ticks = (unsigned) ((now_s() - Host.start) * HOST_SYSTICK_FREQ);
+}
+
+//=========================================================
+// uart.h
+//=========================================================
+
+int uart_trns_buffer(struct Uart* uart, const void* buffer, size_t size)
+{
+    (void) uart;
+
+    if (!is_trns_complete())
+        return UART_TRNS_NOT_COMPL;
+
+    if (size > sizeof(Host.trns_buf))
+        return UART_INV_ARG;
+
+    memcpy(Host.trns_buf, buffer, size);
+    Host.trns_num = size;
+    Host.trns_done = now_s() + Host.byte_time * (double) size;
+
+    Host.stats.tx_bytes += size;
+    Host.stats.last_tx = Host.trns_done - Host.start;
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+int uart_recv_buffer(struct Uart* uart, void* buffer, size_t size)
+{
+    (void) uart;
+
+    if (!Host.recv_complete)
+        return UART_TRNS_NOT_COMPL;
+
+    Host.recv_buf = buffer;
+    Host.recv_size = size;
+    Host.recv_pos = 0U;
+    Host.recv_err = 0;
+    Host.recv_complete = false;
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+int is_trns_complete(void)
+{
+    line_poll(false);
+
+    if (Host.trns_num != 0U)
+        line_poll(true);
+
+    return (int) (Host.trns_num == 0U);
+}
+
+//---------------------------------------------------------
+
+int is_recv_complete(void)
+{
+    line_poll(true);
+
+    if (!Host.recv_complete)
+        return 0;
+
+    return (Host.recv_err == 0)? (int) Host.recv_pos : Host.recv_err;
+}
+
+//---------------------------------------------------------
+
+size_t uart_recv_pos(void)
+{
+    line_poll(false);
+    return Host.recv_pos;
+}
+
+//---------------------------------------------------------
+
+void uart_recv_abort(void)
+{
+    if (!Host.recv_complete)
+        recv_complete_routine(0);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+//=========================================================
+
+/*
+    Host implementation of the uart.h receive/transmit calls over a
+    file descriptor (pty master), for firmware modules built for host.
+
+    Line model: 8 data bits + odd parity, one start & stop bit, bytes
+    arrive no faster than baud rate allows. Each of the 9 bits on the
+    wire flips with given probability: odd number of flips is seen as
+    parity error, even one passes parity and corrupts data silently.
+
+    SysTick counter is emulated from monotonic clock and advanced by
+    every call, as polling loops in firmware only watch it.
+*/
+
+#define HOST_UART_BITS_PER_BYTE 11U
+#define HOST_UART_RTO_SEC       1.5 // RECV_TIMEOUT_SEC in uart.c
+#define HOST_SYSTICK_FREQ       10000U
+
+struct Host_uart_stats
+{
+    uint64_t rx_bytes;  // Bytes on the line
+    uint64_t tx_bytes;
+
+    unsigned parity_errs;
+    unsigned silent_errs;
+
+    double first_rx; // Time of first byte since reset
+    double last_tx;  // Time last transmit completes
+};
+
+extern volatile unsigned Host_ticks;
+
+//=========================================================
+
+void host_uart_init(int fd, unsigned baudrate, double bit_error_rate, unsigned seed);
+
+void host_uart_stats(struct Host_uart_stats* stats, int reset);
+
+// Seconds since host_uart_init
+double host_uart_time(void);
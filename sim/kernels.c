@@ -0,0 +1,87 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+//---------------------------------------------------------
+
+#include "../screen.h"
+#include "../crc.h"
+#include "kernels.h"
+
+//=========================================================
+
+static char Text[KERNEL_TEXT_MAX] = "0123456789ABCDEF";
+
+static uint8_t Data[KERNEL_DATA_SIZE];
+
+//=========================================================
+
+static uint32_t kernel_set_pixel(uint32_t x, uint32_t y, uint32_t a2, uint32_t a3)
+{
+    (void) a2; (void) a3;
+    return (uint32_t) scrn_set_pxiel(x, y);
+}
+
+static uint32_t kernel_inv_pixel(uint32_t x, uint32_t y, uint32_t a2, uint32_t a3)
+{
+    (void) a2; (void) a3;
+    return (uint32_t) scrn_inv_pxiel(x, y);
+}
+
+static uint32_t kernel_xline(uint32_t x, uint32_t y, uint32_t len, uint32_t a3)
+{
+    (void) a3;
+    return (uint32_t) scrn_xline(x, y, len);
+}
+
+static uint32_t kernel_yline(uint32_t x, uint32_t y, uint32_t len, uint32_t a3)
+{
+    (void) a3;
+    return (uint32_t) scrn_yline(x, y, len);
+}
+
+static uint32_t kernel_box(uint32_t x, uint32_t y, uint32_t x_len, uint32_t y_len)
+{
+    return (uint32_t) scrn_box(x, y, x_len, y_len);
+}
+
+static uint32_t kernel_puts(uint32_t x, uint32_t y, uint32_t len, uint32_t a3)
+{
+    (void) a3;
+    return (uint32_t) scrn_puts(x, y, Text, len);
+}
+
+static uint32_t kernel_clear(uint32_t value, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    (void) a1; (void) a2; (void) a3;
+    scrn_clear((uint8_t) value);
+    return 0U;
+}
+
+static uint32_t kernel_draw(uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    (void) a0; (void) a1; (void) a2; (void) a3;
+    scrn_draw();
+    return 0U;
+}
+
+static uint32_t kernel_crc(uint32_t offset, uint32_t size, uint32_t a2, uint32_t a3)
+{
+    (void) a2; (void) a3;
+    return crc32_calc(Data + offset, size);
+}
+
+//=========================================================
+
+__attribute__((section(".kernels"), used))
+const Kernel Kernels[KERNELS_NUM] =
+{
+    [KERNEL_SET_PIXEL] = kernel_set_pixel,
+    [KERNEL_INV_PIXEL] = kernel_inv_pixel,
+    [KERNEL_XLINE]     = kernel_xline,
+    [KERNEL_YLINE]     = kernel_yline,
+    [KERNEL_BOX]       = kernel_box,
+    [KERNEL_PUTS]      = kernel_puts,
+    [KERNEL_CLEAR]     = kernel_clear,
+    [KERNEL_DRAW]      = kernel_draw,
+    [KERNEL_CRC]       = kernel_crc
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+//=========================================================
+
+/*
+    Firmware routines under benchmark behind one signature: arguments
+    come in r0..r3 on Cortex-M0, so the same table is called natively
+    and on the instruction simulator (see bench.c).
+
+    Built for M0 the table is the first thing in the image (bench.lds).
+*/
+
+enum Kernel_id
+{
+    KERNEL_SET_PIXEL = 0,
+    KERNEL_INV_PIXEL = 1,
+    KERNEL_XLINE     = 2,
+    KERNEL_YLINE     = 3,
+    KERNEL_BOX       = 4,
+    KERNEL_PUTS      = 5,
+    KERNEL_CLEAR     = 6,
+    KERNEL_DRAW      = 7,
+    KERNEL_CRC       = 8,
+
+    KERNELS_NUM
+};
+
+#define KERNEL_TEXT_MAX 16U
+
+// CRC input: up to 1 KiB at any alignment
+#define KERNEL_DATA_SIZE (1024U + 4U)
+
+typedef uint32_t (*Kernel)(uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+extern const Kernel Kernels[KERNELS_NUM];
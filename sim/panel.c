@@ -0,0 +1,103 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+//---------------------------------------------------------
+
+#include "../screen.h"
+#include "panel.h"
+
+//=========================================================
+
+// GPIOA..GPIOF registers
+#define PANEL_WINDOW_BASE GPIOA
+#define PANEL_WINDOW_SIZE 0x2000U
+
+struct Panel
+{
+    uint8_t gddram[PANEL_BYTES];
+    unsigned pos;
+};
+
+static struct Panel Panel = { 0 };
+
+//=========================================================
+
+int panel_init(void)
+{
+    void* window = mmap((void*)(uintptr_t) PANEL_WINDOW_BASE, PANEL_WINDOW_SIZE,
+                        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (window != (void*)(uintptr_t) PANEL_WINDOW_BASE)
+        return PANEL_NO_WINDOW;
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+void panel_reset(void)
+{
+    memset(&Panel, 0, sizeof(Panel));
+}
+
+//---------------------------------------------------------
+
+const uint8_t* panel_frame(void)
+{
+    return Panel.gddram;
+}
+
+//---------------------------------------------------------
+
+// Replaces spi.c: the byte lands in display RAM at once
+int SPI_send_byte(uint8_t value)
+{
+    if (*GPIO_ODR(GPIOC) & (1U << DC_PIN))
+    {
+        Panel.gddram[Panel.pos] = value;
+        Panel.pos = (Panel.pos + 1U) % PANEL_BYTES;
+    }
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+static void (*Panel_dma_done)(void) = NULL;
+
+// Whole frame is in display RAM before the call returns, nothing is in flight
+int SPI_send_dma(const void* buf, unsigned size)
+{
+    const uint8_t* bytes = buf;
+
+    for (unsigned i = 0U; i < size; i++)
+        SPI_send_byte(bytes[i]);
+
+    // Transfer complete interrupt comes at once
+    if (Panel_dma_done != NULL)
+        Panel_dma_done();
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+int SPI_dma_busy(void)
+{
+    return 0;
+}
+
+//---------------------------------------------------------
+
+void SPI_dma_on_done(void (*done)(void))
+{
+    Panel_dma_done = done;
+}
+
+//---------------------------------------------------------
+
+void SPI_wait_idle(void)
+{
+}
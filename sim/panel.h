@@ -0,0 +1,39 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+//=========================================================
+
+/*
+    SSD1306 seen through SPI for host builds of screen.c: data bytes
+    (DC pin high) fill display RAM in horizontal addressing mode, as
+    set up by scrn_init. screen.c drives DC & RES through GPIOC, so
+    GPIO registers are backed by memory mapped at their real address.
+*/
+
+#define PANEL_WIDTH  128U
+#define PANEL_HEIGHT 64U
+#define PANEL_BYTES  (PANEL_WIDTH * PANEL_HEIGHT / 8U)
+
+enum Panel_error
+{
+    PANEL_NO_WINDOW = -1 // GPIO window can not be mapped
+};
+
+//=========================================================
+
+// Once per process, before any screen.c call
+int panel_init(void);
+
+// Next data byte goes to top left corner
+void panel_reset(void);
+
+// Display RAM: byte per 8 vertical pixels, LSB on top
+const uint8_t* panel_frame(void);
+
+static inline int panel_pixel(const uint8_t* frame, unsigned x, unsigned y)
+{
+    return (frame[x + (y / 8U) * PANEL_WIDTH] >> (y % 8U)) & 1U;
+}
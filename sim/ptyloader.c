@@ -0,0 +1,245 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+//---------------------------------------------------------
+
+#include "../uart.h"
+#include "../crc.h"
+#include "../fwup.h"
+#include "../loader.h"
+#include "board.h"
+#include "hostuart.h"
+
+//=========================================================
+
+/*
+    Device side of the upload protocol on a pseudo-terminal: loader.c
+    of the firmware runs unchanged on top of hostuart.c. Point usart.py
+    or upload.py at the printed pty (or the -l symlink) to measure
+    upload latency and retransmissions at a given baud rate and bit
+    error rate. Every upload ends with a line of statistics.
+
+    Firmware update packets are drained and rejected.
+*/
+
+#define PTY_CAPACITY (SIM_RAM_SIZE - SIM_USER_OFFS - SIM_STACK_RESERVED) // USER_MAX_PROG_SIZE in main.c
+
+#define PTY_QUIET_TICKS (HOST_SYSTICK_FREQ / 2U) // LOADER_QUIET_TICKS in main.c
+
+#define PTY_DRAIN_SEC 5.0 // REPLY_TIMEOUT in upload.py
+
+//=========================================================
+// Firmware services loader.c links against
+//=========================================================
+
+static uint32_t Crc_init = 0xFFFFFFFFU;
+
+void crc_init(uint32_t init)
+{
+    Crc_init = init;
+}
+
+// CRC unit as set up in crc.c: reflected CRC-32, same as zlib.crc32 in usart.py
+uint32_t crc32_calc(uint8_t* data, size_t size)
+{
+    uint32_t crc = Crc_init;
+
+    for (size_t ind = 0; ind < size; ind++)
+    {
+        crc ^= data[ind];
+
+        for (unsigned bit = 0; bit < 8U; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+    }
+
+    return crc ^ 0xFFFFFFFFU;
+}
+
+//---------------------------------------------------------
+
+// Built with -no-pie: message ID is the address of the format string
+void log_write(uint32_t id, unsigned argc, const uint32_t* args)
+{
+    uint32_t word[4] = { 0U };
+    memcpy(word, args, (argc < 4U? argc : 4U) * sizeof(uint32_t));
+
+    printf("%8.3f  ", host_uart_time());
+    printf((const char*)(uintptr_t) id, word[0], word[1], word[2], word[3]);
+    printf("\n");
+    fflush(stdout);
+}
+
+//---------------------------------------------------------
+
+// Kept current by hostuart.c on every UART poll
+static unsigned pty_ticks(void)
+{
+    return Host_ticks;
+}
+
+//---------------------------------------------------------
+
+static int pty_fwup(struct Uart* uart)
+{
+    (void) uart;
+    return FWUP_RECV_ERR;
+}
+
+//=========================================================
+
+static int pty_open(const char* link, int* slave_fd)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0)
+        return -1;
+
+    const char* name = ptsname(master);
+
+    // Keep slave open: master reads EIO between uploader runs otherwise,
+    // raw mode stops echo of replies back into the loader
+    int slave = open(name, O_RDWR | O_NOCTTY);
+    if (slave < 0)
+        return -1;
+
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    *slave_fd = slave;
+
+    if (link != NULL)
+    {
+        unlink(link);
+        if (symlink(name, link) < 0)
+        {
+            perror(link);
+            return -1;
+        }
+    }
+
+    printf("pty: %s%s%s\n", name, link? " -> " : "", link? link : "");
+    fflush(stdout);
+
+    return master;
+}
+
+//---------------------------------------------------------
+
+// Closing master hangs the slave up and flushes a reply not read yet
+static void pty_drain(int slave)
+{
+    double until = host_uart_time() + PTY_DRAIN_SEC;
+    int unread = 0;
+
+    do
+    {
+        usleep(1000);
+
+    } while (ioctl(slave, FIONREAD, &unread) == 0 && unread > 0 && host_uart_time() < until);
+}
+
+//---------------------------------------------------------
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [-b baudrate] [-e bit_error_rate] [-s seed] [-n uploads] [-l link]\n"
+            "    -b  line speed, default: 9600\n"
+            "    -e  probability of each bit on the wire to flip, default: 0\n"
+            "    -n  exit after this many accepted uploads, default: run forever\n"
+            "    -l  symlink to the pty, e.g. /tmp/ttySTM32\n",
+            name);
+}
+
+//---------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    unsigned baudrate = 9600U;
+    double ber = 0.0;
+    unsigned seed = 1U;
+    unsigned uploads = 0U;
+    const char* link = NULL;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "b:e:s:n:l:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b': baudrate = (unsigned) strtoul(optarg, NULL, 0); break;
+            case 'e': ber = strtod(optarg, NULL);                     break;
+            case 's': seed = (unsigned) strtoul(optarg, NULL, 0);     break;
+            case 'n': uploads = (unsigned) strtoul(optarg, NULL, 0);  break;
+            case 'l': link = optarg;                                  break;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (baudrate == 0U || ber < 0.0 || ber > 1.0)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int slave = -1;
+    int fd = pty_open(link, &slave);
+    if (fd < 0)
+    {
+        perror("pty");
+        return EXIT_FAILURE;
+    }
+
+    host_uart_init(fd, baudrate, ber, seed);
+
+    static uint8_t code[PTY_CAPACITY];
+    struct Uart uart = { .uartno = 1U, .recv_enabled = true, .trns_enabled = true, .baudrate = baudrate };
+
+    const struct Loader loader = { .uart = &uart,
+                                   .buffer = code,
+                                   .capacity = sizeof(code),
+                                   .ticks = pty_ticks,
+                                   .quiet_ticks = PTY_QUIET_TICKS,
+                                   .fwup = pty_fwup };
+
+    for (unsigned upload = 1U; uploads == 0U || upload <= uploads; upload++)
+    {
+        int size = loader_run(&loader);
+
+        // Wait for ACK to leave the wire
+        while (is_trns_complete() == 0)
+            continue;
+
+        struct Host_uart_stats stats;
+        host_uart_stats(&stats, true);
+
+        // Every reply is a word: all but the last are NAKs
+        unsigned attempts = (unsigned) (stats.tx_bytes / sizeof(uint32_t));
+
+        printf("%8.3f  upload %u: %d bytes, %u attempt(s), %.3f s first byte to ACK, "
+               "%llu bytes on line, %u parity / %u silent error(s)\n",
+               host_uart_time(), upload, size, attempts, stats.last_tx - stats.first_rx,
+               (unsigned long long) stats.rx_bytes, stats.parity_errs, stats.silent_errs);
+        fflush(stdout);
+    }
+
+    // Uploader reads the last ACK from the slave after we are done with it
+    pty_drain(slave);
+
+    if (link != NULL)
+        unlink(link);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,370 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+//---------------------------------------------------------
+
+#include "../screen.h"
+#include "panel.h"
+
+//=========================================================
+
+/*
+    Golden image check of screen.c: each script is a draw sequence,
+    one call per line, the frame it leaves on the panel is compared
+    pixel by pixel with <script>.pbm next to it.
+
+        clear <byte>
+        set | clr | inv <x> <y>
+        xline | yline <x> <y> <len>
+        box <x> <y> <x_len> <y_len>
+        puts <x> <y> <text to the end of line>
+
+    Calls must return SCRN_OK, "= <value>" at the end of the line
+    expects another value. '#' starts a comment. Frame starts black.
+*/
+
+#define RENDER_LINE_MAX   256U
+#define RENDER_DIFFS_SHOWN 8U
+
+#define RENDER_DEFAULT_OUT "build/frames"
+
+enum Render_error
+{
+    RENDER_NO_FILE  = -1,
+    RENDER_SYNTAX   = -2,
+    RENDER_RET      = -3, // Call returned unexpected value
+    RENDER_MISMATCH = -4
+};
+
+//=========================================================
+
+static int read_args(const char* str, long* args, unsigned num, const char** rest)
+{
+    for (unsigned ind = 0; ind < num; ind++)
+    {
+        char* end = NULL;
+        args[ind] = strtol(str, &end, 0);
+        if (end == str)
+            return RENDER_SYNTAX;
+
+        str = end;
+    }
+
+    *rest = str;
+    return 0;
+}
+
+//---------------------------------------------------------
+
+static int run_line(char* line, const char* name, unsigned num)
+{
+    char* comment = strchr(line, '#');
+    if (comment != NULL)
+        *comment = '\0';
+
+    char cmd[16] = "";
+    int used = 0;
+    if (sscanf(line, " %15s%n", cmd, &used) != 1)
+        return 0;
+
+    const char* rest = line + used;
+    long arg[4] = { 0 };
+    long ret = 0;
+
+    if (strcmp(cmd, "puts") == 0)
+    {
+        if (read_args(rest, arg, 2U, &rest) < 0)
+            goto syntax;
+
+        // Text is the rest of the line, "= value" is not looked for
+        while (*rest == ' ' || *rest == '\t')
+            rest++;
+
+        char text[RENDER_LINE_MAX];
+        size_t len = strcspn(rest, "\r\n");
+        memcpy(text, rest, len);
+
+        ret = scrn_puts((unsigned) arg[0], (unsigned) arg[1], text, (unsigned) len);
+        rest = "";
+    }
+    else if (strcmp(cmd, "clear") == 0)
+    {
+        if (read_args(rest, arg, 1U, &rest) < 0)
+            goto syntax;
+
+        scrn_clear((uint8_t) arg[0]);
+    }
+    else if (strcmp(cmd, "set") == 0 || strcmp(cmd, "clr") == 0 || strcmp(cmd, "inv") == 0)
+    {
+        if (read_args(rest, arg, 2U, &rest) < 0)
+            goto syntax;
+
+        unsigned x = (unsigned) arg[0], y = (unsigned) arg[1];
+
+        ret = (cmd[0] == 's')? scrn_set_pxiel(x, y) :
+              (cmd[0] == 'c')? scrn_clr_pxiel(x, y) : scrn_inv_pxiel(x, y);
+    }
+    else if (strcmp(cmd, "xline") == 0 || strcmp(cmd, "yline") == 0)
+    {
+        if (read_args(rest, arg, 3U, &rest) < 0)
+            goto syntax;
+
+        ret = (cmd[0] == 'x')? scrn_xline((unsigned) arg[0], (unsigned) arg[1], (unsigned) arg[2]) :
+                               scrn_yline((unsigned) arg[0], (unsigned) arg[1], (unsigned) arg[2]);
+    }
+    else if (strcmp(cmd, "box") == 0)
+    {
+        if (read_args(rest, arg, 4U, &rest) < 0)
+            goto syntax;
+
+        ret = scrn_box((unsigned) arg[0], (unsigned) arg[1], (unsigned) arg[2], (unsigned) arg[3]);
+    }
+    else
+        goto syntax;
+
+    long expected = SCRN_OK;
+    while (isspace((unsigned char) *rest))
+        rest++;
+
+    if (*rest == '=')
+    {
+        char* end = NULL;
+        expected = strtol(rest + 1, &end, 0);
+        if (end == rest + 1)
+            goto syntax;
+    }
+    else if (*rest != '\0')
+        goto syntax;
+
+    if (ret != expected)
+    {
+        printf("%s:%u: %s returned %ld, expected %ld\n", name, num, cmd, ret, expected);
+        return RENDER_RET;
+    }
+
+    return 0;
+
+syntax:
+    printf("%s:%u: can not parse \"%s\"\n", name, num, cmd);
+    return RENDER_SYNTAX;
+}
+
+//=========================================================
+
+static int pbm_write(const char* path, const uint8_t* frame)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL)
+        return RENDER_NO_FILE;
+
+    // Plain PBM, rows split in halves to keep lines under 70 characters
+    fprintf(file, "P1\n%u %u\n", PANEL_WIDTH, PANEL_HEIGHT);
+
+    for (unsigned y = 0; y < PANEL_HEIGHT; y++)
+    {
+        for (unsigned x = 0; x < PANEL_WIDTH; x++)
+        {
+            fputc('0' + panel_pixel(frame, x, y), file);
+
+            if (x == PANEL_WIDTH / 2U - 1U || x == PANEL_WIDTH - 1U)
+                fputc('\n', file);
+        }
+    }
+
+    fclose(file);
+    return 0;
+}
+
+//---------------------------------------------------------
+
+// Plain PBM of panel size into display RAM layout
+static int pbm_read(const char* path, uint8_t* frame)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+        return RENDER_NO_FILE;
+
+    unsigned width = 0U, height = 0U;
+    int err = 0;
+
+    if (fscanf(file, "P1 %u %u", &width, &height) != 2 || width != PANEL_WIDTH || height != PANEL_HEIGHT)
+        err = RENDER_SYNTAX;
+
+    memset(frame, 0, PANEL_BYTES);
+
+    for (unsigned pxl = 0; err == 0 && pxl < PANEL_WIDTH * PANEL_HEIGHT; )
+    {
+        int ch = fgetc(file);
+
+        if (ch == '#')
+        {
+            while (ch != '\n' && ch != EOF)
+                ch = fgetc(file);
+        }
+
+        if (ch == EOF || (ch != '0' && ch != '1' && !isspace(ch) && ch != '\n'))
+            err = RENDER_SYNTAX;
+
+        if (ch != '0' && ch != '1')
+            continue;
+
+        unsigned x = pxl % PANEL_WIDTH, y = pxl / PANEL_WIDTH;
+        frame[x + (y / 8U) * PANEL_WIDTH] |= (uint8_t) ((ch - '0') << (y % 8U));
+        pxl++;
+    }
+
+    fclose(file);
+    return err;
+}
+
+//---------------------------------------------------------
+
+// Number of differing pixels, diff gets them set
+static unsigned frame_diff(const uint8_t* actual, const uint8_t* golden, uint8_t* diff)
+{
+    unsigned count = 0U;
+
+    for (unsigned ind = 0; ind < PANEL_BYTES; ind++)
+    {
+        diff[ind] = actual[ind] ^ golden[ind];
+        count += (unsigned) __builtin_popcount(diff[ind]);
+    }
+
+    return count;
+}
+
+//=========================================================
+
+static int run_script(const char* path, const char* out_dir, bool update)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+    {
+        printf("%s: can not open\n", path);
+        return RENDER_NO_FILE;
+    }
+
+    // Name without directory and extension
+    const char* base = strrchr(path, '/');
+    base = (base != NULL)? base + 1 : path;
+
+    char name[128];
+    snprintf(name, sizeof(name), "%.*s", (int) strcspn(base, "."), base);
+
+    scrn_clear(0x00);
+    panel_reset();
+
+    char line[RENDER_LINE_MAX];
+    unsigned num = 0U;
+    int err = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        int res = run_line(line, path, ++num);
+        if (res < 0 && err == 0)
+            err = res;
+    }
+
+    fclose(file);
+
+    scrn_draw();
+    const uint8_t* actual = panel_frame();
+
+    char golden_path[512], out_path[512];
+    snprintf(golden_path, sizeof(golden_path), "%.*s%s.pbm", (int) (base - path), path, name);
+    snprintf(out_path, sizeof(out_path), "%s/%s.pbm", out_dir, name);
+
+    pbm_write(out_path, actual);
+
+    if (update)
+    {
+        pbm_write(golden_path, actual);
+        printf("%-16s updated\n", name);
+        return err;
+    }
+
+    uint8_t golden[PANEL_BYTES], diff[PANEL_BYTES];
+
+    if (pbm_read(golden_path, golden) < 0)
+    {
+        printf("%-16s FAIL  no golden %s\n", name, golden_path);
+        return RENDER_NO_FILE;
+    }
+
+    unsigned count = frame_diff(actual, golden, diff);
+    if (count == 0U)
+    {
+        printf("%-16s %s\n", name, (err == 0)? "ok" : "FAIL  calls");
+        return err;
+    }
+
+    printf("%-16s FAIL  %u pixel(s) differ:", name, count);
+
+    unsigned shown = 0U;
+    for (unsigned y = 0; y < PANEL_HEIGHT && shown < RENDER_DIFFS_SHOWN; y++)
+    {
+        for (unsigned x = 0; x < PANEL_WIDTH && shown < RENDER_DIFFS_SHOWN; x++)
+        {
+            if (!panel_pixel(diff, x, y))
+                continue;
+
+            printf(" (%u,%u) %d->%d", x, y, panel_pixel(golden, x, y), panel_pixel(actual, x, y));
+            shown++;
+        }
+    }
+
+    snprintf(out_path, sizeof(out_path), "%s/%s.diff.pbm", out_dir, name);
+    pbm_write(out_path, diff);
+
+    printf("%s\n", (count > shown)? " ..." : "");
+
+    return RENDER_MISMATCH;
+}
+
+//---------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    const char* out_dir = RENDER_DEFAULT_OUT;
+    bool update = false;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "o:uh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'o': out_dir = optarg; break;
+            case 'u': update = true;    break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-u] [-o out_dir] script...\n"
+                                "    -u  overwrite goldens with current output\n"
+                                "    -o  actual and diff images, default: %s\n",
+                        argv[0], RENDER_DEFAULT_OUT);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (panel_init() < 0)
+    {
+        fprintf(stderr, "can not map GPIO window\n");
+        return EXIT_FAILURE;
+    }
+
+    unsigned failed = 0U;
+
+    for (int arg = optind; arg < argc; arg++)
+    {
+        if (run_script(argv[arg], out_dir, update) < 0)
+            failed++;
+    }
+
+    printf("%d script(s), %u failed\n", argc - optind, failed);
+
+    return (failed == 0U)? EXIT_SUCCESS : EXIT_FAILURE;
+}
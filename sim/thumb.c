@@ -0,0 +1,730 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+//---------------------------------------------------------
+
+#include "thumb.h"
+
+//=========================================================
+
+// Peripheral and system regions: reads as zero, writes are ignored
+#define DEVICE_BASE 0x40000000U
+#define DEVICE_END  0x60000000U
+#define SYSTEM_BASE 0xE0000000U
+
+#define BIT(VAL, NUM)         (((VAL) >> (NUM)) & 1U)
+#define FIELD(VAL, POS, SIZE) (((VAL) >> (POS)) & ((1U << (SIZE)) - 1U))
+
+//---------------------------------------------------------
+
+// Set once instruction failed, checked after every instruction
+static int Status = CPU_OK;
+
+//=========================================================
+
+static uint8_t* ram_ptr(struct Cpu* cpu, uint32_t addr, unsigned size)
+{
+    uint32_t offs = addr - cpu->ram_base;
+    if (offs <= cpu->ram_size - size)
+        return cpu->ram + offs;
+
+    return NULL;
+}
+
+//---------------------------------------------------------
+
+static bool device_addr(uint32_t addr)
+{
+    return (addr >= DEVICE_BASE && addr < DEVICE_END) || addr >= SYSTEM_BASE;
+}
+
+//---------------------------------------------------------
+
+static uint32_t load(struct Cpu* cpu, uint32_t addr, unsigned size)
+{
+    // No unaligned accesses on ARMv6-M
+    if (addr & (size - 1U))
+    {
+        cpu->fault_addr = addr;
+        Status = CPU_FAULT;
+        return 0U;
+    }
+
+    uint8_t* ptr = ram_ptr(cpu, addr, size);
+    if (ptr == NULL)
+    {
+        if (!device_addr(addr))
+        {
+            cpu->fault_addr = addr;
+            Status = CPU_FAULT;
+        }
+
+        return 0U;
+    }
+
+    uint32_t val = 0U;
+    memcpy(&val, ptr, size); // Host is little-endian as well
+
+    return val;
+}
+
+//---------------------------------------------------------
+
+static void store(struct Cpu* cpu, uint32_t addr, unsigned size, uint32_t val)
+{
+    if (addr & (size - 1U))
+    {
+        cpu->fault_addr = addr;
+        Status = CPU_FAULT;
+        return;
+    }
+
+    uint8_t* ptr = ram_ptr(cpu, addr, size);
+    if (ptr == NULL)
+    {
+        if (!device_addr(addr))
+        {
+            cpu->fault_addr = addr;
+            Status = CPU_FAULT;
+        }
+
+        return;
+    }
+
+    memcpy(ptr, &val, size);
+}
+
+//---------------------------------------------------------
+
+static void set_nz(struct Cpu* cpu, uint32_t res)
+{
+    cpu->n = BIT(res, 31);
+    cpu->z = (res == 0U);
+}
+
+//---------------------------------------------------------
+
+static uint32_t add_with_carry(struct Cpu* cpu, uint32_t a, uint32_t b, unsigned carry, bool flags)
+{
+    uint64_t sum = (uint64_t) a + b + carry;
+    uint32_t res = (uint32_t) sum;
+
+    if (flags)
+    {
+        set_nz(cpu, res);
+        cpu->c = (sum >> 32) & 1U;
+        cpu->v = BIT(~(a ^ b) & (a ^ res), 31);
+    }
+
+    return res;
+}
+
+//---------------------------------------------------------
+
+static bool cond_passed(struct Cpu* cpu, unsigned cond)
+{
+    bool res = false;
+
+    switch (cond >> 1)
+    {
+        case 0: res = cpu->z;                           break; // EQ
+        case 1: res = cpu->c;                           break; // CS
+        case 2: res = cpu->n;                           break; // MI
+        case 3: res = cpu->v;                           break; // VS
+        case 4: res = cpu->c && !cpu->z;                break; // HI
+        case 5: res = (cpu->n == cpu->v);               break; // GE
+        case 6: res = (cpu->n == cpu->v) && !cpu->z;    break; // GT
+        default: return true;                                  // AL
+    }
+
+    return (cond & 1U)? !res : res;
+}
+
+//---------------------------------------------------------
+
+// Shift by register for data processing group, shift type as in DP opcode
+static uint32_t shift_reg(struct Cpu* cpu, unsigned op, uint32_t val, uint32_t amount)
+{
+    amount &= 0xFFU;
+    if (amount == 0U)
+        return val;
+
+    switch (op)
+    {
+        case 0x2: // LSL
+            cpu->c = (amount <= 32U)? BIT(val, 32U - amount) : 0U;
+            return (amount < 32U)? val << amount : 0U;
+
+        case 0x3: // LSR
+            cpu->c = (amount <= 32U)? BIT(val, amount - 1U) : 0U;
+            return (amount < 32U)? val >> amount : 0U;
+
+        case 0x4: // ASR
+            if (amount >= 32U)
+            {
+                cpu->c = BIT(val, 31);
+                return cpu->c? 0xFFFFFFFFU : 0U;
+            }
+
+            cpu->c = BIT(val, amount - 1U);
+            return (uint32_t) ((int32_t) val >> amount);
+
+        default: // ROR
+            amount &= 31U;
+            if (amount != 0U)
+                val = (val >> amount) | (val << (32U - amount));
+
+            cpu->c = BIT(val, 31);
+            return val;
+    }
+}
+
+//---------------------------------------------------------
+
+static void branch(struct Cpu* cpu, uint32_t target)
+{
+    cpu->r[CPU_REG_PC] = target & ~1U;
+}
+
+//=========================================================
+
+static unsigned exec_data_proc(struct Cpu* cpu, uint16_t op)
+{
+    unsigned rd = op & 7U;
+    uint32_t rm = cpu->r[FIELD(op, 3, 3)];
+    uint32_t rn = cpu->r[rd];
+    uint32_t res = 0U;
+
+    switch (FIELD(op, 6, 4))
+    {
+        case 0x0: res = rn & rm;                                    break; // AND
+        case 0x1: res = rn ^ rm;                                    break; // EOR
+        case 0x2:                                                          // LSL
+        case 0x3:                                                          // LSR
+        case 0x4:                                                          // ASR
+        case 0x7: res = shift_reg(cpu, FIELD(op, 6, 4), rn, rm);   break; // ROR
+        case 0x5: res = add_with_carry(cpu, rn,  rm, cpu->c, true); break; // ADC
+        case 0x6: res = add_with_carry(cpu, rn, ~rm, cpu->c, true); break; // SBC
+        case 0x8: set_nz(cpu, rn & rm);                  return 1U;        // TST
+        case 0x9: res = add_with_carry(cpu, ~rm, 0U, 1U, true);    break; // RSB #0
+        case 0xA: add_with_carry(cpu, rn, ~rm, 1U, true); return 1U;        // CMP
+        case 0xB: add_with_carry(cpu, rn,  rm, 0U, true); return 1U;        // CMN
+        case 0xC: res = rn | rm;                                    break; // ORR
+        case 0xD: res = rn * rm;                                    break; // MUL
+        case 0xE: res = rn & ~rm;                                   break; // BIC
+        default:  res = ~rm;                                        break; // MVN
+    }
+
+    set_nz(cpu, res);
+    cpu->r[rd] = res;
+
+    return 1U;
+}
+
+//---------------------------------------------------------
+
+static unsigned exec_special(struct Cpu* cpu, uint16_t op, uint32_t pc)
+{
+    unsigned rd = (op & 7U) | (BIT(op, 7) << 3);
+    unsigned rm = FIELD(op, 3, 4);
+
+    uint32_t val = (rm == CPU_REG_PC)? pc + 4U : cpu->r[rm];
+
+    switch (FIELD(op, 8, 2))
+    {
+        case 0: // ADD, no flags
+        {
+            uint32_t base = (rd == CPU_REG_PC)? pc + 4U : cpu->r[rd];
+            if (rd == CPU_REG_PC)
+            {
+                branch(cpu, base + val);
+                return 3U;
+            }
+
+            cpu->r[rd] = base + val;
+            return 1U;
+        }
+
+        case 1: // CMP high registers
+        {
+            uint32_t base = (rd == CPU_REG_PC)? pc + 4U : cpu->r[rd];
+            add_with_carry(cpu, base, ~val, 1U, true);
+            return 1U;
+        }
+
+        case 2: // MOV
+            if (rd == CPU_REG_PC)
+            {
+                branch(cpu, val);
+                return 3U;
+            }
+
+            cpu->r[rd] = val;
+            return 1U;
+
+        default: // BX, BLX
+            if (BIT(op, 7))
+                cpu->r[CPU_REG_LR] = (pc + 2U) | 1U;
+
+            if ((val & 1U) == 0U)
+            {
+                // Switch to ARM state: INVSTATE UsageFault -> HardFault
+                cpu->fault_addr = val;
+                Status = CPU_FAULT;
+                return 3U;
+            }
+
+            branch(cpu, val);
+            return 3U;
+    }
+}
+
+//---------------------------------------------------------
+
+static unsigned exec_load_store_reg(struct Cpu* cpu, uint16_t op)
+{
+    unsigned rt = op & 7U;
+    uint32_t addr = cpu->r[FIELD(op, 3, 3)] + cpu->r[FIELD(op, 6, 3)];
+
+    switch (FIELD(op, 9, 3))
+    {
+        case 0: store(cpu, addr, 4U, cpu->r[rt]);                           break; // STR
+        case 1: store(cpu, addr, 2U, cpu->r[rt]);                           break; // STRH
+        case 2: store(cpu, addr, 1U, cpu->r[rt]);                           break; // STRB
+        case 3: cpu->r[rt] = (uint32_t) (int8_t) load(cpu, addr, 1U);        break; // LDRSB
+        case 4: cpu->r[rt] = load(cpu, addr, 4U);                           break; // LDR
+        case 5: cpu->r[rt] = load(cpu, addr, 2U);                           break; // LDRH
+        case 6: cpu->r[rt] = load(cpu, addr, 1U);                           break; // LDRB
+        default: cpu->r[rt] = (uint32_t) (int16_t) load(cpu, addr, 2U);      break; // LDRSH
+    }
+
+    return 2U;
+}
+
+//---------------------------------------------------------
+
+static unsigned exec_misc(struct Cpu* cpu, uint16_t op, uint32_t pc)
+{
+    uint32_t* sp = &cpu->r[CPU_REG_SP];
+
+    if ((op & 0xFF00U) == 0xB000U) // ADD/SUB SP, #imm7
+    {
+        uint32_t imm = (op & 0x7FU) << 2;
+        *sp = BIT(op, 7)? *sp - imm : *sp + imm;
+        return 1U;
+    }
+
+    if ((op & 0xFF00U) == 0xB200U) // SXTH, SXTB, UXTH, UXTB
+    {
+        uint32_t rm = cpu->r[FIELD(op, 3, 3)];
+        uint32_t res = 0U;
+
+        switch (FIELD(op, 6, 2))
+        {
+            case 0:  res = (uint32_t) (int16_t) rm; break;
+            case 1:  res = (uint32_t) (int8_t)  rm; break;
+            case 2:  res = rm & 0xFFFFU;            break;
+            default: res = rm & 0xFFU;              break;
+        }
+
+        cpu->r[op & 7U] = res;
+        return 1U;
+    }
+
+    if ((op & 0xFE00U) == 0xB400U) // PUSH
+    {
+        unsigned list = (op & 0xFFU) | (BIT(op, 8) << CPU_REG_LR);
+        unsigned count = (unsigned) __builtin_popcount(list);
+
+        uint32_t addr = *sp - 4U * count;
+        *sp = addr;
+
+        for (unsigned reg = 0; reg < 16U; reg++)
+        {
+            if (BIT(list, reg))
+            {
+                store(cpu, addr, 4U, cpu->r[reg]);
+                addr += 4U;
+            }
+        }
+
+        return 1U + count;
+    }
+
+    if ((op & 0xFFEFU) == 0xB662U) // CPSIE i, CPSID i: interrupts are not simulated
+        return 1U;
+
+    if ((op & 0xFF00U) == 0xBA00U && FIELD(op, 6, 2) != 2U) // REV, REV16, REVSH
+    {
+        uint32_t rm = cpu->r[FIELD(op, 3, 3)];
+        uint32_t res = 0U;
+
+        switch (FIELD(op, 6, 2))
+        {
+            case 0:
+                res = __builtin_bswap32(rm);
+                break;
+
+            case 1:
+                res = ((rm & 0x00FF00FFU) << 8) | ((rm >> 8) & 0x00FF00FFU);
+                break;
+
+            default:
+                res = (uint32_t) (int16_t) __builtin_bswap16((uint16_t) rm);
+                break;
+        }
+
+        cpu->r[op & 7U] = res;
+        return 1U;
+    }
+
+    if ((op & 0xFE00U) == 0xBC00U) // POP
+    {
+        unsigned list = (op & 0xFFU) | (BIT(op, 8) << CPU_REG_PC);
+        unsigned count = (unsigned) __builtin_popcount(list);
+
+        uint32_t addr = *sp;
+        *sp = addr + 4U * count;
+
+        for (unsigned reg = 0; reg < 16U; reg++)
+        {
+            if (BIT(list, reg))
+            {
+                cpu->r[reg] = load(cpu, addr, 4U);
+                addr += 4U;
+            }
+        }
+
+        if (BIT(op, 8))
+        {
+            branch(cpu, cpu->r[CPU_REG_PC]);
+            return 3U + count; // 1 + N, pipeline refill
+        }
+
+        return 1U + count;
+    }
+
+    if ((op & 0xFF00U) == 0xBE00U) // BKPT
+    {
+        cpu->fault_addr = pc;
+        Status = CPU_BKPT;
+        return 1U;
+    }
+
+    if ((op & 0xFF0FU) == 0xBF00U && FIELD(op, 4, 4) <= 4U) // NOP, YIELD, WFE, WFI, SEV
+        return (FIELD(op, 4, 4) == 3U)? 2U : 1U;
+
+    Status = CPU_UNDEF;
+    return 1U;
+}
+
+//---------------------------------------------------------
+
+static unsigned exec_multiple(struct Cpu* cpu, uint16_t op)
+{
+    unsigned rn = FIELD(op, 8, 3);
+    unsigned list = op & 0xFFU;
+    unsigned count = (unsigned) __builtin_popcount(list);
+
+    if (count == 0U)
+    {
+        Status = CPU_UNDEF;
+        return 1U;
+    }
+
+    uint32_t addr = cpu->r[rn];
+    bool is_load = BIT(op, 11);
+
+    // LDM writes back unless base is in the list, STM always does
+    bool wback = !is_load || !BIT(list, rn);
+
+    for (unsigned reg = 0; reg < 8U; reg++)
+    {
+        if (!BIT(list, reg))
+            continue;
+
+        if (is_load)
+            cpu->r[reg] = load(cpu, addr, 4U);
+        else
+            store(cpu, addr, 4U, cpu->r[reg]);
+
+        addr += 4U;
+    }
+
+    if (wback)
+        cpu->r[rn] = addr;
+
+    return 1U + count;
+}
+
+//---------------------------------------------------------
+
+static unsigned exec_32bit(struct Cpu* cpu, uint16_t hw1, uint32_t pc)
+{
+    uint16_t hw2 = (uint16_t) load(cpu, pc + 2U, 2U);
+    if (Status != CPU_OK)
+        return 1U;
+
+    cpu->r[CPU_REG_PC] = pc + 4U;
+
+    if ((hw1 & 0xF800U) == 0xF000U && (hw2 & 0xD000U) == 0xD000U) // BL
+    {
+        uint32_t s  = BIT(hw1, 10);
+        uint32_t i1 = !(BIT(hw2, 13) ^ s);
+        uint32_t i2 = !(BIT(hw2, 11) ^ s);
+
+        uint32_t imm = (s << 24) | (i1 << 23) | (i2 << 22) |
+                       ((hw1 & 0x3FFU) << 12) | ((hw2 & 0x7FFU) << 1);
+
+        // Sign extend 25 bit offset
+        int32_t offs = (int32_t) (imm << 7) >> 7;
+
+        cpu->r[CPU_REG_LR] = (pc + 4U) | 1U;
+        branch(cpu, pc + 4U + (uint32_t) offs);
+
+        return 4U;
+    }
+
+    if ((hw1 & 0xFFF0U) == 0xF380U && (hw2 & 0xFF00U) == 0x8800U) // MSR: PRIMASK, CONTROL
+        return 4U;
+
+    if (hw1 == 0xF3EFU && (hw2 & 0xF000U) == 0x8000U) // MRS
+    {
+        unsigned rd = FIELD(hw2, 8, 4);
+        unsigned sysm = hw2 & 0xFFU;
+
+        uint32_t val = 0U;
+        if (sysm <= 3U)
+            val = ((uint32_t) cpu->n << 31) | ((uint32_t) cpu->z << 30) |
+                  ((uint32_t) cpu->c << 29) | ((uint32_t) cpu->v << 28);
+        else if (sysm == 8U)
+            val = cpu->r[CPU_REG_SP];
+
+        cpu->r[rd] = val;
+        return 4U;
+    }
+
+    if (hw1 == 0xF3BFU && (hw2 & 0xFF00U) == 0x8F00U) // DSB, DMB, ISB
+        return 4U;
+
+    Status = CPU_UNDEF;
+    return 1U;
+}
+
+//---------------------------------------------------------
+
+static unsigned exec(struct Cpu* cpu, uint16_t op, uint32_t pc)
+{
+    uint32_t* r = cpu->r;
+    unsigned rd = op & 7U;
+    unsigned rn = FIELD(op, 3, 3);
+
+    // PC as operand reads two instructions ahead
+    r[CPU_REG_PC] = pc + 2U;
+
+    switch (op >> 11)
+    {
+        case 0x00: // LSL #imm
+        {
+            unsigned imm = FIELD(op, 6, 5);
+            uint32_t val = r[rn];
+
+            if (imm != 0U)
+            {
+                cpu->c = BIT(val, 32U - imm);
+                val <<= imm;
+            }
+
+            set_nz(cpu, val);
+            r[rd] = val;
+            return 1U;
+        }
+
+        case 0x01: // LSR #imm
+        {
+            unsigned imm = FIELD(op, 6, 5);
+            uint32_t val = r[rn];
+
+            if (imm == 0U) // LSR #32
+            {
+                cpu->c = BIT(val, 31);
+                val = 0U;
+            }
+            else
+            {
+                cpu->c = BIT(val, imm - 1U);
+                val >>= imm;
+            }
+
+            set_nz(cpu, val);
+            r[rd] = val;
+            return 1U;
+        }
+
+        case 0x02: // ASR #imm
+        {
+            unsigned imm = FIELD(op, 6, 5);
+            uint32_t val = r[rn];
+
+            if (imm == 0U) // ASR #32
+            {
+                cpu->c = BIT(val, 31);
+                val = cpu->c? 0xFFFFFFFFU : 0U;
+            }
+            else
+            {
+                cpu->c = BIT(val, imm - 1U);
+                val = (uint32_t) ((int32_t) val >> imm);
+            }
+
+            set_nz(cpu, val);
+            r[rd] = val;
+            return 1U;
+        }
+
+        case 0x03: // ADD, SUB: register or #imm3
+        {
+            uint32_t arg = BIT(op, 10)? FIELD(op, 6, 3) : r[FIELD(op, 6, 3)];
+
+            if (BIT(op, 9))
+                r[rd] = add_with_carry(cpu, r[rn], ~arg, 1U, true);
+            else
+                r[rd] = add_with_carry(cpu, r[rn], arg, 0U, true);
+
+            return 1U;
+        }
+
+        case 0x04: // MOV #imm8
+            r[FIELD(op, 8, 3)] = op & 0xFFU;
+            set_nz(cpu, op & 0xFFU);
+            return 1U;
+
+        case 0x05: // CMP #imm8
+            add_with_carry(cpu, r[FIELD(op, 8, 3)], ~(uint32_t) (op & 0xFFU), 1U, true);
+            return 1U;
+
+        case 0x06: // ADD #imm8
+            r[FIELD(op, 8, 3)] = add_with_carry(cpu, r[FIELD(op, 8, 3)], op & 0xFFU, 0U, true);
+            return 1U;
+
+        case 0x07: // SUB #imm8
+            r[FIELD(op, 8, 3)] = add_with_carry(cpu, r[FIELD(op, 8, 3)], ~(uint32_t) (op & 0xFFU), 1U, true);
+            return 1U;
+
+        case 0x08:
+            return BIT(op, 10)? exec_special(cpu, op, pc) : exec_data_proc(cpu, op);
+
+        case 0x09: // LDR literal
+            r[FIELD(op, 8, 3)] = load(cpu, ((pc + 4U) & ~3U) + ((op & 0xFFU) << 2), 4U);
+            return 2U;
+
+        case 0x0A:
+        case 0x0B:
+            return exec_load_store_reg(cpu, op);
+
+        case 0x0C: store(cpu, r[rn] + (FIELD(op, 6, 5) << 2), 4U, r[rd]);   return 2U; // STR
+        case 0x0D: r[rd] = load(cpu, r[rn] + (FIELD(op, 6, 5) << 2), 4U);   return 2U; // LDR
+        case 0x0E: store(cpu, r[rn] + FIELD(op, 6, 5), 1U, r[rd]);          return 2U; // STRB
+        case 0x0F: r[rd] = load(cpu, r[rn] + FIELD(op, 6, 5), 1U);          return 2U; // LDRB
+        case 0x10: store(cpu, r[rn] + (FIELD(op, 6, 5) << 1), 2U, r[rd]);   return 2U; // STRH
+        case 0x11: r[rd] = load(cpu, r[rn] + (FIELD(op, 6, 5) << 1), 2U);   return 2U; // LDRH
+
+        case 0x12: // STR SP-relative
+            store(cpu, r[CPU_REG_SP] + ((op & 0xFFU) << 2), 4U, r[FIELD(op, 8, 3)]);
+            return 2U;
+
+        case 0x13: // LDR SP-relative
+            r[FIELD(op, 8, 3)] = load(cpu, r[CPU_REG_SP] + ((op & 0xFFU) << 2), 4U);
+            return 2U;
+
+        case 0x14: // ADR
+            r[FIELD(op, 8, 3)] = ((pc + 4U) & ~3U) + ((op & 0xFFU) << 2);
+            return 1U;
+
+        case 0x15: // ADD Rd, SP, #imm8
+            r[FIELD(op, 8, 3)] = r[CPU_REG_SP] + ((op & 0xFFU) << 2);
+            return 1U;
+
+        case 0x16:
+        case 0x17:
+            return exec_misc(cpu, op, pc);
+
+        case 0x18:
+        case 0x19:
+            return exec_multiple(cpu, op);
+
+        case 0x1A:
+        case 0x1B: // B<cond>, UDF, SVC
+        {
+            unsigned cond = FIELD(op, 8, 4);
+            if (cond >= 0xEU)
+            {
+                // No SVC handler in guest environment
+                Status = CPU_UNDEF;
+                return 1U;
+            }
+
+            if (!cond_passed(cpu, cond))
+                return 1U;
+
+            branch(cpu, pc + 4U + (uint32_t) ((int32_t) (int8_t) (op & 0xFFU) << 1));
+            return 3U;
+        }
+
+        case 0x1C: // B
+        {
+            int32_t offs = (int32_t) ((uint32_t) (op & 0x7FFU) << 21) >> 20;
+            if (offs == -4)
+                Status = CPU_HALT;
+
+            branch(cpu, pc + 4U + (uint32_t) offs);
+            return 3U;
+        }
+
+        case 0x1E:
+        case 0x1F:
+            return exec_32bit(cpu, op, pc);
+
+        default:
+            Status = CPU_UNDEF;
+            return 1U;
+    }
+}
+
+//=========================================================
+
+int cpu_run(struct Cpu* cpu, uint64_t cycle_limit)
+{
+    Status = CPU_OK;
+
+    while (cpu->cycles < cycle_limit)
+    {
+        uint32_t pc = cpu->r[CPU_REG_PC];
+
+        if (pc - cpu->trap_base < cpu->trap_size)
+            return CPU_TRAP;
+
+        uint8_t* ptr = ram_ptr(cpu, pc, 2U);
+        if (ptr == NULL || (pc & 1U))
+        {
+            cpu->fault_addr = pc;
+            cpu->fault_pc = pc;
+            return CPU_FAULT;
+        }
+
+        uint16_t op = (uint16_t) (ptr[0] | (ptr[1] << 8));
+
+        cpu->cycles += exec(cpu, op, pc);
+        cpu->insns++;
+
+        if (Status != CPU_OK)
+        {
+            cpu->fault_pc = pc;
+            cpu->r[CPU_REG_PC] = pc;
+            return Status;
+        }
+    }
+
+    return CPU_LIMIT;
+}
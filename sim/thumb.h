@@ -0,0 +1,59 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//=========================================================
+
+/*
+    ARMv6-M (Cortex-M0) Thumb instruction set simulator.
+
+    Only the guest runs here: code and data live in the SRAM window,
+    peripheral and system regions read as zero and ignore writes.
+    Jumping into the trap window stops the simulation, so the caller
+    can serve the call natively and return to the guest (see board.c).
+
+    Cycle counts follow Cortex-M0 TRM with zero wait state SRAM and
+    single-cycle multiplier, as on STM32F051.
+*/
+
+#define CPU_REG_SP 13U
+#define CPU_REG_LR 14U
+#define CPU_REG_PC 15U
+
+enum Cpu_status
+{
+    CPU_OK     =  0,
+    CPU_TRAP   =  1, // PC is in trap window
+    CPU_LIMIT  =  2, // Cycle limit reached
+    CPU_HALT   =  3, // Branch to itself, as __halt in user.S
+    CPU_FAULT  = -1, // Bad memory access, HardFault on real core
+    CPU_UNDEF  = -2, // Undefined instruction
+    CPU_BKPT   = -3  // BKPT without debugger, HardFault as well
+};
+
+struct Cpu
+{
+    uint32_t r[16];
+    bool n, z, c, v;
+
+    uint64_t cycles;
+    uint64_t insns;
+
+    uint8_t* ram;
+    uint32_t ram_base;
+    uint32_t ram_size;
+
+    uint32_t trap_base;
+    uint32_t trap_size;
+
+    uint32_t fault_addr; // Data address of CPU_FAULT, PC for fetch faults
+    uint32_t fault_pc;
+};
+
+//=========================================================
+
+// Run until trap, fault or cycles reach limit
+int cpu_run(struct Cpu* cpu, uint64_t cycle_limit);
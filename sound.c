@@ -0,0 +1,286 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "inc/tim.h"
+#include "inc/gpio.h"
+#include "inc/rcc.h"
+#include "inc/nvic.h"
+#include "inc/dma.h"
+#include "inc/arm.h"
+#include "clock.h"
+#include "sound.h"
+
+//=========================================================
+
+#define SOUND_TIM     TIM17
+#define SOUND_GPIO    GPIOB
+#define SOUND_PIN     9U
+#define SOUND_AF      GPIO_AF2
+
+#define DMA_CH1_IRQ 9U
+
+#define SOUND_PERIOD 256U // Timer clocks per PWM period, sample is the duty
+#define SOUND_MIDDLE 128U
+
+#define SOUND_AMP_SHIFT 1U // Volume 15 swings +-30, four voices stay in 8..248
+
+#define NOISE_TAPS 0xB400U // 16-bit Galois LFSR, maximal length
+
+//---------------------------------------------------------
+
+struct Sound_voice
+{
+    uint32_t phase;
+    uint32_t step;  // Phase increment per sample, 2^32 is one period
+    uint32_t left;  // Samples to play
+    uint16_t freq;
+    uint8_t amp;
+};
+
+struct Sound_state
+{
+    struct Sound_voice voices[SOUND_VOICES];
+
+    uint16_t rate;
+    uint16_t lfsr;
+
+    uint8_t silent_blocks;
+    volatile bool active;
+
+    uint8_t buf[2U * SOUND_BLOCK];
+};
+
+static struct Sound_state Sound = { .lfsr = 1U };
+
+//=========================================================
+
+static uint32_t sound_step(unsigned freq)
+{
+    // 16.16 split keeps the division 32-bit: 0.12 Hz resolution at 8 kHz
+    return ((freq << 16) / Sound.rate) << 16;
+}
+
+//---------------------------------------------------------
+
+void sound_set_frequency(uint32_t frequency)
+{
+    uint32_t updates = frequency / SOUND_PERIOD;
+    uint32_t repeat = (updates + SOUND_RATE / 2U) / SOUND_RATE;
+
+    Sound.rate = (uint16_t) (updates / repeat);
+
+    REG_UPDATE(TIM_RCR(SOUND_TIM), FIELD_VAR(TIM_RCR_FIELD, repeat - 1U));
+
+    for (unsigned voice = 0; voice < SOUND_VOICES; voice++)
+        Sound.voices[voice].step = sound_step(Sound.voices[voice].freq);
+}
+
+//---------------------------------------------------------
+
+void sound_init(void)
+{
+    SET_BIT(REG_RCC_AHBENR, REG_RCC_AHBENR_IOPBEN);
+    SET_BIT(REG_RCC_AHBENR, REG_RCC_AHBENR_DMAEN);
+    SET_BIT(REG_RCC_APB2ENR, REG_RCC_APB2ENR_TIM17EN);
+
+    SET_GPIO_IOMODE(SOUND_GPIO, SOUND_PIN, GPIO_IOMODE_ALT_FUNC);
+    SET_GPIO_OTYPE(SOUND_GPIO, SOUND_PIN, GPIO_OTYPE_PUSH_PULL);
+    SET_GPIO_AF_HIGH(SOUND_GPIO, SOUND_PIN - 8U, SOUND_AF); // Pins 8..15
+
+    // PWM mode 1 with preloaded compare, DMA request on update
+    REG_WRITE(TIM_PSC(SOUND_TIM), FIELD(TIM_PSC_FIELD, 0U));
+    REG_WRITE(TIM_ARR(SOUND_TIM), FIELD(TIM_ARR_FIELD, SOUND_PERIOD - 1U));
+    *TIM_CCR1(SOUND_TIM) = SOUND_MIDDLE;
+
+    REG_UPDATE(TIM_CCMR1(SOUND_TIM), FIELD(TIM_CCMR1_CC1S_FIELD, 0b00U)
+                                   | FIELD(TIM_CCMR1_OC1M_FIELD, TIM_OCM_PWM1)
+                                   | FIELD_ON(TIM_CCMR1_OC1PE));
+
+    REG_UPDATE(TIM_CR1(SOUND_TIM), FIELD_ON(TIM_CR1_ARPE));
+    REG_UPDATE(TIM_DIER(SOUND_TIM), FIELD_ON(TIM_DIER_UDE));
+    SET_BIT(TIM_BDTR(SOUND_TIM), TIM_BDTR_MOE);
+
+    // TIM17_UP is on DMA channel 1 unless remapped in SYSCFG
+    SET_DMA_CPAR(DMA_CPAR1, (uint32_t) TIM_CCR1(SOUND_TIM));
+    SET_DMA_CMAR(DMA_CMAR1, (uint32_t) Sound.buf);
+
+    REG_UPDATE(DMA_CCR1, FIELD(DMA_CCR_PL_FIELD, DMA_CCR_PL_LOW)
+                       | FIELD_ON(DMA_CCR_DIR)                            // Direction - from memory to peripheral
+                       | FIELD_ON(DMA_CCR_MINC)
+                       | FIELD_ON(DMA_CCR_CIRC)
+                       | FIELD(DMA_CCR_MSIZE_FIELD, DMA_CCR_MSIZE_8)      // Zero-extended to CCR1
+                       | FIELD(DMA_CCR_PSIZE_FIELD, DMA_CCR_PSIZE_16)
+                       | FIELD_ON(DMA_CCR_HTIE)
+                       | FIELD_ON(DMA_CCR_TCIE));
+
+    NVIC_ENABLE_IRQ(DMA_CH1_IRQ);
+
+    sound_set_frequency(clock_get_frequency());
+}
+
+//=========================================================
+
+static void sound_mix(uint8_t* out)
+{
+    for (unsigned ind = 0; ind < SOUND_BLOCK; ind++)
+        out[ind] = SOUND_MIDDLE;
+
+    bool silent = true;
+
+    for (unsigned num = 0; num < SOUND_VOICES; num++)
+    {
+        struct Sound_voice* voice = &Sound.voices[num];
+        if (voice->left == 0U)
+            continue;
+
+        silent = false;
+
+        uint32_t phase = voice->phase;
+        uint32_t step = voice->step;
+        uint8_t high = voice->amp;
+        uint8_t low = (uint8_t) -voice->amp;
+
+        if (num != SOUND_NOISE)
+        {
+            for (unsigned ind = 0; ind < SOUND_BLOCK; ind++)
+            {
+                phase += step;
+                out[ind] += ((int32_t) phase < 0)? high : low;
+            }
+        }
+        else
+        {
+            uint32_t lfsr = Sound.lfsr;
+
+            for (unsigned ind = 0; ind < SOUND_BLOCK; ind++)
+            {
+                phase += step;
+                if (phase < step)
+                    lfsr = (lfsr >> 1) ^ (-(lfsr & 1U) & NOISE_TAPS);
+
+                out[ind] += (lfsr & 1U)? high : low;
+            }
+
+            Sound.lfsr = (uint16_t) lfsr;
+        }
+
+        voice->phase = phase;
+        voice->left = (voice->left > SOUND_BLOCK)? voice->left - SOUND_BLOCK : 0U;
+    }
+
+    Sound.silent_blocks = silent? Sound.silent_blocks + 1U : 0U;
+}
+
+//---------------------------------------------------------
+
+static void sound_halt(void)
+{
+    CLEAR_BIT(TIM_CR1(SOUND_TIM), TIM_CR1_CEN);
+    CLEAR_BIT(DMA_CCR1, DMA_CCR_EN);
+    CLEAR_BIT(TIM_CCER(SOUND_TIM), TIM_CCER_CC1E);
+
+    Sound.active = false;
+}
+
+//---------------------------------------------------------
+
+// Called with IRQs masked
+static void sound_start(void)
+{
+    Sound.silent_blocks = 0U;
+
+    sound_mix(&Sound.buf[0]);
+    sound_mix(&Sound.buf[SOUND_BLOCK]);
+
+    *(DMA_IFCR) = (1 << DMA_ISR_CGIF1);
+    SET_DMA_CNDTR_NDT(DMA_CNDTR1, 2U * SOUND_BLOCK);
+    SET_BIT(DMA_CCR1, DMA_CCR_EN);
+
+    // Load preloaded registers before the first period
+    REG_WRITE(TIM_EGR(SOUND_TIM), FIELD_ON(TIM_EGR_UG));
+    SET_BIT(TIM_CCER(SOUND_TIM), TIM_CCER_CC1E);
+    SET_BIT(TIM_CR1(SOUND_TIM), TIM_CR1_CEN);
+
+    Sound.active = true;
+}
+
+//---------------------------------------------------------
+
+int sound_play(unsigned voice, unsigned freq_hz, unsigned duration_ms, unsigned volume)
+{
+    if (voice >= SOUND_VOICES)
+        return SOUND_INV_VOICE;
+
+    if (freq_hz == 0U || freq_hz > SOUND_MAX_FREQ || duration_ms > SOUND_MAX_MS || volume > SOUND_MAX_VOLUME)
+        return SOUND_INV_ARG;
+
+    struct Sound_voice* target = &Sound.voices[voice];
+
+    uint32_t primask = irq_save();
+
+    target->freq = (uint16_t) freq_hz;
+    target->step = sound_step(freq_hz);
+    target->amp = (uint8_t) (volume << SOUND_AMP_SHIFT);
+    target->left = (volume == 0U)? 0U : duration_ms * Sound.rate / 1000U;
+
+    if (target->left != 0U && !Sound.active)
+        sound_start();
+
+    irq_restore(primask);
+    return 0;
+}
+
+//---------------------------------------------------------
+
+int sound_stop(unsigned voice)
+{
+    if (voice > SOUND_ALL)
+        return SOUND_INV_VOICE;
+
+    unsigned first = (voice == SOUND_ALL)? 0U : voice;
+    unsigned last = (voice == SOUND_ALL)? SOUND_VOICES : voice + 1U;
+
+    // Buffer plays out, then the mixer halts on silence
+    uint32_t primask = irq_save();
+
+    for (unsigned num = first; num < last; num++)
+        Sound.voices[num].left = 0U;
+
+    irq_restore(primask);
+    return 0;
+}
+
+//---------------------------------------------------------
+
+bool sound_is_active(void)
+{
+    return Sound.active;
+}
+
+//--------------------
+// Interrupt handlers
+//--------------------
+
+void dma_ch1_handler(void)
+{
+    uint32_t isr = *(DMA_ISR);
+
+    if ((isr & (1U << DMA_ISR_HTIF1)) != 0U)
+    {
+        *(DMA_IFCR) = (1 << DMA_ISR_CHTIF1);
+        sound_mix(&Sound.buf[0]);
+    }
+
+    if ((isr & (1U << DMA_ISR_TCIF1)) != 0U)
+    {
+        *(DMA_IFCR) = (1 << DMA_ISR_CTCIF1);
+        sound_mix(&Sound.buf[SOUND_BLOCK]);
+    }
+
+    // Both halves hold silence by now
+    if (Sound.silent_blocks >= 2U)
+        sound_halt();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "common/api.h"
+
+//=========================================================
+
+/*
+    Sound through TIM17 CH1 PWM on PB9 (AF2), speaker or RC filter
+    to an amplifier. PWM period is 256 timer clocks and its duty is
+    the 8-bit sample; repetition counter spaces update events to
+    about SOUND_RATE and DMA channel 1 moves one sample per update
+    into CCR1 (preloaded, so it changes on period boundary).
+
+    Sample buffer is two blocks in circular mode: half-transfer and
+    transfer-complete interrupts mix the block DMA has just played
+    while it plays the other one. Voices 0..2 are square waves,
+    voice SOUND_NOISE is an LFSR clocked at the given frequency.
+    Whole buffer of silence stops timer and DMA, so Stop mode is
+    allowed again between frames.
+
+    Sample rate follows the clock level (8152 / 7812 Hz), tones are
+    retuned on the switch, lengths are kept in samples.
+*/
+
+#define SOUND_RATE  8000U
+#define SOUND_BLOCK 32U   // Samples mixed per interrupt, 4 ms
+
+#define SOUND_MAX_FREQ 4000U  // Hz, below half of sample rate
+#define SOUND_MAX_MS   10000U
+
+enum Sound_error
+{
+    SOUND_INV_VOICE = -1,
+    SOUND_INV_ARG   = -2
+};
+
+//=========================================================
+
+// PB9, TIM17 & DMA channel 1, timer is left stopped
+void sound_init(void);
+
+// Recompute sample rate on clock level switch
+void sound_set_frequency(uint32_t frequency);
+
+// Start a tone on voice (restarts it if already playing), volume 0 stops it
+int sound_play(unsigned voice, unsigned freq_hz, unsigned duration_ms, unsigned volume);
+
+// Voice or SOUND_ALL
+int sound_stop(unsigned voice);
+
+// Timer and DMA are running, clocks must stay on
+bool sound_is_active(void);
@@ -4,7 +4,10 @@
 #include "inc/gpio.h"
 #include "inc/rcc.h"
 #include "inc/spi.h"
+#include "inc/dma.h"
+#include "inc/nvic.h"
 #include "screen.h"
+#include "clock.h"
 
 /* Configures:
  *      - PA5 as SPI1_SCK
@@ -52,6 +55,14 @@ static void spi_gpio_init(void) {
 #define FIELD_WRITE(REG, VALUE, SHIFT) ((REG) |= ((VALUE) << (SHIFT)))
 #define FIELD_READ(REG, MASK)          ((REG) & (MASK))
 
+// SCK frequency requested in SPI_init, kept on clock switch
+static uint32_t Spi_sck_freq = 0;
+
+#define DMA_CH2_3_IRQ 10U // Handler is in uart.c
+
+// Called once a DMA transfer is out (screen.c chains frames)
+static void (*Spi_dma_done)(void) = NULL;
+
 void SPI_init(unsigned divisor) {
     spi_gpio_init();
 
@@ -85,6 +96,41 @@ void SPI_init(unsigned divisor) {
     *SPI1_CR2 = spi_cr2;
 
     BIT_SET(*SPI1_CR1, SPI_SPE);
+
+    // Channel 3 carries frames out (SPI_send_dma)
+    SET_BIT(REG_RCC_AHBENR, REG_RCC_AHBENR_DMAEN);
+    NVIC_ENABLE_IRQ(DMA_CH2_3_IRQ);
+
+    Spi_sck_freq = clock_get_frequency() >> ((divisor & 7) + 1);
+}
+
+void SPI_wait_idle(void) {
+    if (BIT_READ(*SPI1_CR1, SPI_SPE) == 0)
+        return;
+
+    while (SPI_dma_busy())
+        ;
+
+    while (BIT_READ(*SPI1_SR, SPI_TXE) == 0)
+        ;
+
+    while (BIT_READ(*SPI1_SR, SPI_BSY) != 0)
+        ;
+}
+
+void SPI_set_frequency(uint32_t pclk) {
+    if (Spi_sck_freq == 0)
+        return;
+
+    // Fastest SCK that does not exceed the requested one
+    unsigned divisor = BAUD_DIV2;
+    while (divisor < BAUD_DIV256 && (pclk >> (divisor + 1)) > Spi_sck_freq)
+        divisor++;
+
+    // BR can be changed only while SPI is disabled
+    BIT_CLR(*SPI1_CR1, SPI_SPE);
+    *SPI1_CR1 = (uint16_t)((*SPI1_CR1 & ~(MASK_LOWER(3) << SPI_BR)) | (divisor << SPI_BR));
+    BIT_SET(*SPI1_CR1, SPI_SPE);
 }
 
 int SPI_send_byte(uint8_t value) {
@@ -105,3 +151,57 @@ uint16_t SPI_read(void) {
 
     return *(uint8_t *)SPI1_DR;
 }
+
+int SPI_send_dma(const void* buf, unsigned size) {
+    if (BIT_READ(*SPI1_CR1, SPI_SPE) == 0 || size == 0)
+        return -E_NO_SND;
+
+    // Shared with USART1 RX: never taken from a running receive
+    if (CHECK_BIT(DMA_CCR3, DMA_CCR_EN) != 0U)
+        return -E_DMA_BUSY;
+
+    SET_DMA_CPAR(DMA_CPAR3, (uint32_t) SPI1_DR);
+
+    // DIR tells the shared interrupt handler this transfer from a receive
+    REG_UPDATE(DMA_CCR3, FIELD(DMA_CCR_PL_FIELD, DMA_CCR_PL_LOW)
+                       | FIELD(DMA_CCR_MSIZE_FIELD, DMA_CCR_MSIZE_8)
+                       | FIELD(DMA_CCR_PSIZE_FIELD, DMA_CCR_PSIZE_8)
+                       | FIELD_ON(DMA_CCR_MINC)
+                       | FIELD_ON(DMA_CCR_DIR)       // Memory to peripheral
+                       | FIELD_OFF(DMA_CCR_CIRC)
+                       | FIELD_ON(DMA_CCR_TCIE));
+
+    *(DMA_IFCR) = (1 << DMA_ISR_CGIF3);
+
+    SET_DMA_CMAR(DMA_CMAR3, (uint32_t) buf);
+    SET_DMA_CNDTR_NDT(DMA_CNDTR3, size);
+
+    SET_BIT(DMA_CCR3, DMA_CCR_EN);
+    BIT_SET(*SPI1_CR2, SPI_TXDMAEN);
+
+    return 0;
+}
+
+int SPI_dma_busy(void) {
+    return BIT_READ(*SPI1_CR2, SPI_TXDMAEN) != 0;
+}
+
+void SPI_dma_on_done(void (*done)(void)) {
+    Spi_dma_done = done;
+}
+
+void SPI_dma_handler(void) {
+    *(DMA_IFCR) = (1 << DMA_ISR_CGIF3);
+
+    // Last bytes are still in FIFO and shift register: a few SCK periods
+    while (BIT_READ(*SPI1_SR, SPI_FTLVL) != 0 || BIT_READ(*SPI1_SR, SPI_FTLVL + 1) != 0 ||
+           BIT_READ(*SPI1_SR, SPI_BSY) != 0)
+        ;
+
+    // Channel goes back to UART receive
+    BIT_CLR(*SPI1_CR2, SPI_TXDMAEN);
+    CLEAR_BIT(DMA_CCR3, DMA_CCR_EN);
+
+    if (Spi_dma_done != NULL)
+        Spi_dma_done();
+}
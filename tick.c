@@ -0,0 +1,253 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "inc/systick.h"
+#include "inc/scb.h"
+#include "inc/arm.h"
+#include "clock.h"
+#include "tick.h"
+
+//=========================================================
+
+#define REF_FREQUENCY_DIV 8U // SysTick reference clock is HCLK / 8
+
+#define SYSTICK_MAX_CYCLES 0x1000000U // 24-bit reload value plus one
+
+//---------------------------------------------------------
+
+struct Tick_state
+{
+    unsigned base;            // Ticks before the running period
+    uint32_t rest;            // Cycles past base before the running period, below a tick
+    uint32_t period;          // Cycles of the running period, reload value plus one
+
+    uint32_t cycles_per_tick;
+    unsigned max_delay;       // Longest period in ticks
+
+    unsigned wake;            // Tick of the nearest request
+    bool wake_set;
+    bool in_handler;
+};
+
+// Outlives main(): guest runs on the same counter
+__attribute__ ((section (".api")))
+static struct Tick_state Tick = { 0 };
+
+//=========================================================
+
+// Cycles of the running period counted so far, IRQs are masked
+static uint32_t tick_counted(void)
+{
+    // Counter reads 0 right after restart and once more as the period runs out
+    uint32_t current = *SYSTICK_CVR;
+    uint32_t counted = (current == 0U)? 0U : Tick.period - current;
+
+    // Period ran out and handler has not run yet: counter is on the next one
+    if (CHECK_BIT(SCB_ICSR, SCB_ICSR_PENDSTSET) != 0U)
+    {
+        current = *SYSTICK_CVR;
+        counted = Tick.period + ((current == 0U)? 0U : Tick.period - current);
+    }
+
+    return counted;
+}
+
+//---------------------------------------------------------
+
+static void tick_fold(uint32_t cycles)
+{
+    cycles += Tick.rest;
+
+    Tick.base += cycles / Tick.cycles_per_tick;
+    Tick.rest  = cycles % Tick.cycles_per_tick;
+}
+
+//---------------------------------------------------------
+
+// Restart counter to run out delay ticks past base, cycles counted must be folded
+static void tick_reload(unsigned delay)
+{
+    uint32_t cycles = delay * Tick.cycles_per_tick - Tick.rest;
+
+    *SYSTICK_RVR = cycles - 1U;
+    *SYSTICK_CVR = 0U;
+
+    // Period that ran out meanwhile is folded already
+    *SCB_ICSR = (1U << SCB_ICSR_PENDSTCLR);
+
+    Tick.period = cycles;
+}
+
+//---------------------------------------------------------
+
+// Ticks from now to the nearest request, longest period if there is none
+static unsigned tick_delay(unsigned now)
+{
+    if (Tick.wake_set == false)
+        return Tick.max_delay;
+
+    int ahead = (int) (Tick.wake - now);
+
+    if (ahead < 1)
+        return 1U;
+
+    return ((unsigned) ahead < Tick.max_delay)? (unsigned) ahead : Tick.max_delay;
+}
+
+//=========================================================
+
+void tick_init(void)
+{
+    /*
+        NOTE:
+        TENMS calibration value (6000) is given for HCLK / 8 = 6 MHz
+        only, so reload value is computed from current HCLK instead.
+    */
+
+    SYSTICK_DISABLE();
+
+    Tick.base = 0U;
+    Tick.rest = 0U;
+    Tick.cycles_per_tick = 0U;
+    Tick.wake_set = false;
+    Tick.in_handler = false;
+
+    tick_set_frequency(clock_get_frequency());
+
+    if (!SYSTICK_GET_NOREF())
+        SYSTICK_SET_SRC_REF();
+    else
+        SYSTICK_SET_SRC_CPU();
+
+    SYSTICK_EXC_ENABLE();
+    SYSTICK_ENABLE();
+}
+
+//---------------------------------------------------------
+
+void tick_set_frequency(uint32_t frequency)
+{
+    uint32_t src_frequency = frequency;
+
+    if (!SYSTICK_GET_NOREF())
+        src_frequency /= REF_FREQUENCY_DIV;
+
+    uint32_t cycles_per_tick = src_frequency / TICK_FREQ;
+
+    uint32_t primask = irq_save();
+
+    // Cycles so far were counted at the old rate
+    if (Tick.cycles_per_tick != 0U)
+    {
+        tick_fold(tick_counted());
+        Tick.rest = Tick.rest * cycles_per_tick / Tick.cycles_per_tick;
+    }
+
+    Tick.cycles_per_tick = cycles_per_tick;
+    Tick.max_delay = SYSTICK_MAX_CYCLES / cycles_per_tick - 1U;
+
+    tick_reload(tick_delay(Tick.base));
+
+    irq_restore(primask);
+}
+
+//---------------------------------------------------------
+
+unsigned tick_now(void)
+{
+    uint32_t primask = irq_save();
+
+    unsigned now = Tick.base + (Tick.rest + tick_counted()) / Tick.cycles_per_tick;
+
+    irq_restore(primask);
+    return now;
+}
+
+//---------------------------------------------------------
+
+void tick_request(unsigned delay)
+{
+    if (delay == 0U)
+        delay = 1U;
+
+    uint32_t primask = irq_save();
+
+    if (delay > Tick.max_delay)
+        delay = Tick.max_delay;
+
+    uint32_t counted = tick_counted();
+    unsigned wake = Tick.base + (Tick.rest + counted) / Tick.cycles_per_tick + delay;
+
+    if (Tick.wake_set == false || (int) (wake - Tick.wake) < 0)
+    {
+        Tick.wake = wake;
+        Tick.wake_set = true;
+
+        // Handler reloads on its way out, a pending one runs right after us.
+        // Otherwise the running period is cut short if it ends too late
+        bool pending = (CHECK_BIT(SCB_ICSR, SCB_ICSR_PENDSTSET) != 0U);
+        uint32_t end = Tick.rest + Tick.period;
+
+        if (Tick.in_handler == false && pending == false
+         && (wake - Tick.base) * Tick.cycles_per_tick < end)
+        {
+            tick_fold(counted);
+            tick_reload(wake - Tick.base);
+        }
+    }
+
+    irq_restore(primask);
+}
+
+//---------------------------------------------------------
+
+void tick_skip(uint32_t us)
+{
+    uint32_t primask = irq_save();
+
+    Tick.base += us / TICK_US;
+
+    irq_restore(primask);
+}
+
+//---------------------------------------------------------
+
+unsigned tick_handler_enter(void)
+{
+    uint32_t primask = irq_save();
+
+    // Counter went on with the same reload: next period is running already
+    tick_fold(Tick.period);
+    Tick.in_handler = true;
+
+    if (Tick.wake_set == true && (int) (Tick.wake - Tick.base) <= 0)
+        Tick.wake_set = false;
+
+    unsigned now = Tick.base;
+
+    irq_restore(primask);
+    return now;
+}
+
+//---------------------------------------------------------
+
+void tick_handler_leave(void)
+{
+    uint32_t primask = irq_save();
+
+    Tick.in_handler = false;
+
+    // Same period again (a run of 1-tick requests): counter is left alone
+    unsigned delay = tick_delay(Tick.base);
+
+    if (delay * Tick.cycles_per_tick - Tick.rest != Tick.period)
+    {
+        tick_fold(tick_counted());
+        tick_reload(tick_delay(Tick.base));
+    }
+
+    irq_restore(primask);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+
+//=========================================================
+
+/*
+    Tickless SysTick. Time is counted in ticks of TICK_US, but SysTick
+    only fires when something is due: services ask for their next call
+    with tick_request(), and the handler reloads the counter with the
+    nearest request. With nothing asked for, reload is the longest the
+    24-bit counter allows (2.8 s on reference clock at 48 MHz).
+
+    Elapsed time is the sum of the reloads that ran out plus the part
+    of the running one already counted, so tick_now() is exact to a
+    SysTick clock. Expiries land on tick boundaries: a run of 1-tick
+    requests (debounce, link, log drain) reuses the running reload and
+    never touches the counter, nothing is lost between interrupts.
+
+    SysTick is halted in Stop mode, sleep time measured by RTC is
+    added with tick_skip().
+*/
+
+#define TICK_US   100U
+#define TICK_FREQ (1000000U / TICK_US)
+
+//=========================================================
+
+// Start SysTick at current HCLK, tick counter starts from 0
+void tick_init(void);
+
+// Call on clock level switch with IRQs masked, before the tree is changed
+void tick_set_frequency(uint32_t frequency);
+
+// Ticks since tick_init(), interrupt may not have run for most of them
+unsigned tick_now(void);
+
+// Serve SysTick no later than delay ticks from now (0 is taken as 1).
+// Only the nearest request is kept: callers ask again on every call or wakeup
+void tick_request(unsigned delay);
+
+// Time SysTick spent halted, rounded down to ticks
+void tick_skip(uint32_t us);
+
+// Account the period that ran out, returns current tick; first call of systick_handler
+unsigned tick_handler_enter(void);
+
+// Reload counter with the nearest request; last call of systick_handler
+void tick_handler_leave(void);
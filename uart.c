@@ -8,6 +8,10 @@
 #include "inc/rcc.h"
 #include "inc/nvic.h"
 #include "inc/dma.h"
+#include "inc/arm.h"
+#include "inc/spi.h"
+#include "probe.h"
+#include "ring.h"
 #include "uart.h"
 
 //=========================================================
@@ -31,13 +35,22 @@ static void uart_handler(unsigned uartno);
 
 #define RECV_TIMEOUT_SEC 1.5f
 
-static bool Trns_complete = true;
-static bool Recv_complete = true;
+// Set in handlers, polled in thread mode
+static volatile bool Trns_complete = true;
+static volatile bool Recv_complete = true;
 
-static int Recv_err = 0;
+static volatile int Recv_err = 0;
 
-static uint32_t Recv_cndt   = 0; // Holds last loaded CNDTR value 
-static uint32_t Recv_number = 0; // Actual number of received data after Recv_complete -> true
+static uint32_t Recv_cndt            = 0; // Holds last loaded CNDTR value 
+static volatile uint32_t Recv_number = 0; // Actual number of received data after Recv_complete -> true
+
+static bool Recv_stream = false; // Circular receive, never completes
+
+// Stream is taken byte by byte on RXNE: DMA channel 3 is left to SPI1 (see spi.c)
+static struct Ring* Stream_ring = NULL;
+static volatile unsigned Stream_dropped = 0U;
+
+static struct Uart* Uarts[2] = { NULL, NULL }; // Set up instances, reconfigured on clock switch
 
 //=========================================================
 
@@ -68,6 +81,8 @@ int uart_setup(struct Uart* uart, const struct Uart_conf* uart_conf)
     uart_gpio_setup(uart, uart_conf);
     uart_usart_setup(uart, uart_conf);
 
+    Uarts[uart->uartno - 1] = uart;
+
     NVIC_ENABLE_IRQ(uart->irq_no);
     NVIC_ENABLE_IRQ(DMA_CH2_3_IRQ);
 
@@ -122,19 +137,17 @@ static void uart_usart_setup(struct Uart* uart, const struct Uart_conf* uart_con
         default: break;
     }
 
-    SET_BIT(USART_CR1(uart->UARTx), USART_CR1_M0);    // SB | 8-bit data | PB | STB
-    CLEAR_BIT(USART_CR1(uart->UARTx), USART_CR1_M1);    
-
-    SET_BIT(USART_CR1(uart->UARTx), USART_CR1_PCE);   // Parity control enabled           
-    SET_BIT(USART_CR1(uart->UARTx), USART_CR1_PS);    // Odd parity
-    SET_BIT(USART_CR1(uart->UARTx), USART_CR1_PEIE);  // Parity Error Interrupt Enabled
+    REG_UPDATE(USART_CR1(uart->UARTx), FIELD_ON(USART_CR1_M0)       // SB | 8-bit data | PB | STB
+                                     | FIELD_OFF(USART_CR1_M1)
+                                     | FIELD_ON(USART_CR1_PCE)      // Parity control enabled
+                                     | FIELD_ON(USART_CR1_PS)       // Odd parity
+                                     | FIELD_ON(USART_CR1_PEIE)     // Parity Error Interrupt Enabled
+                                     | FIELD_OFF(USART_CR1_OVER8)); // Oversampling by 16
 
     SET_BIT(USART_CR3(uart->UARTx), USART_CR3_EIE); // Interrupt on Framing, Overrun & Noise errors
 
-    CLEAR_BIT(USART_CR1(uart->UARTx), USART_CR1_OVER8); // Oversampling by 16
-
-    CLEAR_BIT(USART_CR2(uart->UARTx), USART_CR2_MSBFIRST); // Endianness: LSB first
-    SET_USART_CR2_STOP(uart->UARTx, USART_CR2_STOP_1);     // Number of stop bits: 2 stop bit
+    REG_UPDATE(USART_CR2(uart->UARTx), FIELD_OFF(USART_CR2_MSBFIRST)                         // Endianness: LSB first
+                                     | FIELD(USART_CR2_STOP_FIELD, USART_CR2_STOP_1)); // Number of stop bits: 1 stop bit
 
     SET_USART_BRR(uart->UARTx, (uart_conf->frequency) / (uart_conf->baudrate));
 
@@ -143,6 +156,55 @@ static void uart_usart_setup(struct Uart* uart, const struct Uart_conf* uart_con
 
 //---------------------------------------------------------
 
+void uart_wait_idle(void)
+{
+    while (is_trns_complete() == 0)
+        continue;
+
+    for (unsigned iter = 0; iter < sizeof(Uarts) / sizeof(Uarts[0]); iter++)
+    {
+        if (Uarts[iter] != NULL && Uarts[iter]->trns_enabled == true)
+            uart_wait_for_tc(Uarts[iter]);
+    }
+}
+
+//---------------------------------------------------------
+
+bool uart_is_idle(void)
+{
+    // Stream receive waits for data indefinitely, it is not counted
+    if (Trns_complete == false || (Recv_complete == false && Recv_stream == false))
+        return false;
+
+    for (unsigned iter = 0; iter < sizeof(Uarts) / sizeof(Uarts[0]); iter++)
+    {
+        if (Uarts[iter] != NULL && Uarts[iter]->trns_enabled == true
+         && CHECK_BIT(USART_ISR(Uarts[iter]->UARTx), USART_ISR_TC) == 0U)
+            return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------
+
+void uart_set_frequency(size_t frequency)
+{
+    for (unsigned iter = 0; iter < sizeof(Uarts) / sizeof(Uarts[0]); iter++)
+    {
+        struct Uart* uart = Uarts[iter];
+        if (uart == NULL)
+            continue;
+
+        // BRR can be written only while USART is disabled
+        CLEAR_BIT(USART_CR1(uart->UARTx), USART_CR1_UE);
+        *USART_BRR(uart->UARTx) = frequency / uart->baudrate;
+        SET_BIT(USART_CR1(uart->UARTx), USART_CR1_UE);
+    }
+}
+
+//---------------------------------------------------------
+
 int uart_transmit_enable(struct Uart* uart) // TODO checksum 
 {
     if (uart == NULL)
@@ -154,14 +216,13 @@ int uart_transmit_enable(struct Uart* uart) // TODO checksum
     SET_BIT(USART_CR3(uart->UARTx), USART_CR3_DMAT); // use DMA
 
     SET_DMA_CPAR(DMA_CPAR2, (uint32_t) USART_TDR(uart->UARTx)); // Peripheral
-    SET_DMA_CCR_PL(DMA_CCR2, DMA_CCR_PL_MED); // Medium priority
-    SET_BIT(DMA_CCR2, DMA_CCR_DIR); // Direction - from memory to peripheral
-    SET_BIT(DMA_CCR2, DMA_CCR_MINC);  // Memory increment
 
-    SET_DMA_CCR_MSIZE(DMA_CCR2, DMA_CCR_MSIZE_8);  // Memory size = 8 bits
-    SET_DMA_CCR_PSIZE(DMA_CCR2, DMA_CCR_PSIZE_32); // Peripheral size = 32 bits
-
-    SET_BIT(DMA_CCR2, DMA_CCR_TCIE); // Transfer complete interrupt enable
+    REG_UPDATE(DMA_CCR2, FIELD(DMA_CCR_PL_FIELD, DMA_CCR_PL_MED)          // Medium priority
+                       | FIELD_ON(DMA_CCR_DIR)                            // Direction - from memory to peripheral
+                       | FIELD_ON(DMA_CCR_MINC)                           // Memory increment
+                       | FIELD(DMA_CCR_MSIZE_FIELD, DMA_CCR_MSIZE_8)      // Memory size = 8 bits
+                       | FIELD(DMA_CCR_PSIZE_FIELD, DMA_CCR_PSIZE_32)     // Peripheral size = 32 bits
+                       | FIELD_ON(DMA_CCR_TCIE));                         // Transfer complete interrupt enable
 
     SET_BIT(USART_CR1(uart->UARTx), USART_CR1_TE);
     while (CHECK_BIT(USART_ISR(uart->UARTx), USART_ISR_TEACK) == 0U)
@@ -183,22 +244,10 @@ int uart_receive_enable(struct Uart* uart)
 
     SET_BIT(USART_CR3(uart->UARTx), USART_CR3_DMAR);
 
-    SET_DMA_CPAR(DMA_CPAR3, (uint32_t) USART_RDR(uart->UARTx)); // Peripheral
-    SET_DMA_CCR_PL(DMA_CCR3, DMA_CCR_PL_MED); // Medium priority
-
-    SET_DMA_CCR_MSIZE(DMA_CCR3, DMA_CCR_MSIZE_8);  // Memory size = 8 bits
-    SET_DMA_CCR_PSIZE(DMA_CCR3, DMA_CCR_PSIZE_32); // Peripheral size = 32 bits
-
-    SET_BIT(DMA_CCR3, DMA_CCR_MINC);  // Memory increment
-    CLEAR_BIT(DMA_CCR3, DMA_CCR_DIR); // Direction - from peripheral to memory
-
-    SET_BIT(DMA_CCR3, DMA_CCR_TCIE); // Transfer complete interrupt enable
-
     SET_USART_RTOR_RTO(uart->UARTx, (uint32_t) (uart->baudrate * RECV_TIMEOUT_SEC));
-    SET_BIT(USART_CR2(uart->UARTx), USART_CR2_RTOEN);
-    SET_BIT(USART_CR1(uart->UARTx), USART_CR1_RTOIE); // Configure RTO
+    SET_BIT(USART_CR2(uart->UARTx), USART_CR2_RTOEN); // Configure RTO
 
-    SET_BIT(USART_CR1(uart->UARTx), USART_CR1_RE);
+    REG_UPDATE(USART_CR1(uart->UARTx), FIELD_ON(USART_CR1_RTOIE) | FIELD_ON(USART_CR1_RE));
     while (CHECK_BIT(USART_ISR(uart->UARTx), USART_ISR_REACK) == 0U)
         continue;
 
@@ -234,7 +283,7 @@ int uart_receive_disable(struct Uart* uart)
         return 0;
 
     CLEAR_BIT(USART_CR3(uart->UARTx), USART_CR3_DMAR);
-    CLEAR_BIT(USART_CR1(uart->UARTx), USART_CR1_RE);
+    REG_UPDATE(USART_CR1(uart->UARTx), FIELD_OFF(USART_CR1_RXNEIE) | FIELD_OFF(USART_CR1_RE));
 
     uart->recv_enabled = false;
     return 0;
@@ -244,6 +293,8 @@ int uart_receive_disable(struct Uart* uart)
 
 void dma_ch2_3_handler(void)
 {
+    PROBE_BEGIN(PROBE_UART_DMA_IRQ);
+
     if (CHECK_BIT(DMA_ISR, DMA_ISR_TCIF2) != 0)
     {
         Trns_complete = true;
@@ -252,7 +303,10 @@ void dma_ch2_3_handler(void)
         CLEAR_BIT(DMA_CCR2, DMA_CCR_EN);
     }
 
-    if (CHECK_BIT(DMA_ISR, DMA_ISR_TCIF3) != 0)
+    // Channel 3 carries display frames between receives (see spi.c)
+    if (CHECK_BIT(DMA_ISR, DMA_ISR_TCIF3) != 0 && CHECK_BIT(DMA_CCR3, DMA_CCR_DIR) != 0)
+        SPI_dma_handler();
+    else if (CHECK_BIT(DMA_ISR, DMA_ISR_TCIF3) != 0)
     {
         Recv_complete = true;
         Recv_number = Recv_cndt;
@@ -262,13 +316,19 @@ void dma_ch2_3_handler(void)
     }
 
     NVIC_CLEAR_PEND_IRQ(DMA_CH2_3_IRQ);
+
+    PROBE_END(PROBE_UART_DMA_IRQ);
 }
 
 //---------------------------------------------------------
 
 void uart1_handler(void)
 {
+    PROBE_BEGIN(PROBE_UART_IRQ);
+
     uart_handler(1);
+
+    PROBE_END(PROBE_UART_IRQ);
 }
 
 //---------------------------------------------------------
@@ -282,6 +342,10 @@ void uart2_handler(void)
 
 static void recv_complete_routine(void)
 {
+    // Stream keeps running through errors & line idle
+    if (Recv_stream == true)
+        return;
+
     Recv_complete = true;
     uint32_t cur_cndt = GET_DMA_CNDTR_NDT(DMA_CNDTR3);
     Recv_number = Recv_cndt - cur_cndt;
@@ -295,9 +359,22 @@ static void uart_handler(unsigned uartno)
 {
     uint32_t uart = UARTx[uartno - 1];
 
+    // Receive state is owned by UART receiving via DMA channel 3,
+    // flags of others (e.g. link on USART2) are only cleared
+    bool dma_recv = (Uarts[uartno - 1] != NULL && Uarts[uartno - 1]->recv_enabled == true);
+
+    if (dma_recv == true && Recv_stream == true && CHECK_BIT(USART_ISR(uart), USART_ISR_RXNE) != 0U)
+    {
+        uint8_t byte = (uint8_t) *USART_RDR(uart);
+
+        // Unread bytes are kept, the new one is lost
+        if (ring_write(Stream_ring, &byte, 1U) == 0U)
+            Stream_dropped++;
+    }
+
     if (CHECK_BIT(USART_ISR(uart), USART_ISR_RTOF) != 0U)
     {
-        if (Recv_complete == false)
+        if (dma_recv == true && Recv_complete == false)
             recv_complete_routine();
 
         *USART_ICR(uart) = (1 << USART_ICR_RTOCF);
@@ -305,7 +382,7 @@ static void uart_handler(unsigned uartno)
 
     if (CHECK_BIT(USART_ISR(uart), USART_ISR_PE) != 0U)
     {
-        if (Recv_complete == false)
+        if (dma_recv == true && Recv_complete == false)
         {
             recv_complete_routine();
             Recv_err = UART_RECV_PE;
@@ -316,7 +393,7 @@ static void uart_handler(unsigned uartno)
 
     if (CHECK_BIT(USART_ISR(uart), USART_ISR_FE) != 0U)
     {
-        if (Recv_complete == false)
+        if (dma_recv == true && Recv_complete == false)
         {
             recv_complete_routine();
             Recv_err = UART_RECV_FE;
@@ -327,7 +404,7 @@ static void uart_handler(unsigned uartno)
 
     if (CHECK_BIT(USART_ISR(uart), USART_ISR_ORE) != 0U)
     {
-        if (Recv_complete == false)
+        if (dma_recv == true && Recv_complete == false)
         {
             recv_complete_routine();
             Recv_err = UART_RECV_ORE;
@@ -338,7 +415,7 @@ static void uart_handler(unsigned uartno)
 
     if (CHECK_BIT(USART_ISR(uart), USART_ISR_NF) != 0U)
     {
-        if (Recv_complete == false)
+        if (dma_recv == true && Recv_complete == false)
         {
             recv_complete_routine();
             Recv_err = UART_RECV_NF;
@@ -359,13 +436,21 @@ int uart_trns_buffer(struct Uart* uart, const void* buffer, size_t size)
     if (uart->trns_enabled == false)
         return UART_TRNS_DIS;
 
+    // Log drain on SysTick competes for the channel
+    uint32_t primask = irq_save();
+
     if (Trns_complete != true)
+    {
+        irq_restore(primask);
         return UART_TRNS_NOT_COMPL;
+    }
+
+    Trns_complete = false;
+    irq_restore(primask);
 
     SET_DMA_CMAR(DMA_CMAR2, (uint32_t) buffer); // memory address
     SET_DMA_CNDTR_NDT(DMA_CNDTR2, size); // byte count
 
-    Trns_complete = false;
     *USART_ICR(uart->UARTx) = (1 << USART_ICR_TCCF);
     SET_BIT(DMA_CCR2, DMA_CCR_EN); // enable channel
 
@@ -385,11 +470,28 @@ int uart_recv_buffer(struct Uart* uart, void* buffer, size_t size)
     if (Recv_complete != true)
         return UART_TRNS_NOT_COMPL;
 
+    // Channel 3 may have carried a display frame since the last receive
+    if (CHECK_BIT(DMA_CCR3, DMA_CCR_EN) != 0U)
+        return UART_RECV_NOT_COMPL;
+
+    SET_DMA_CPAR(DMA_CPAR3, (uint32_t) USART_RDR(uart->UARTx)); // Peripheral
+
+    REG_UPDATE(DMA_CCR3, FIELD(DMA_CCR_PL_FIELD, DMA_CCR_PL_MED)          // Medium priority
+                       | FIELD(DMA_CCR_MSIZE_FIELD, DMA_CCR_MSIZE_8)      // Memory size = 8 bits
+                       | FIELD(DMA_CCR_PSIZE_FIELD, DMA_CCR_PSIZE_32)     // Peripheral size = 32 bits
+                       | FIELD_ON(DMA_CCR_MINC)                           // Memory increment
+                       | FIELD_OFF(DMA_CCR_DIR)                           // Direction - from peripheral to memory
+                       | FIELD_OFF(DMA_CCR_CIRC)
+                       | FIELD_ON(DMA_CCR_TCIE));                         // Transfer complete interrupt enable
+
+    *(DMA_IFCR) = (1 << DMA_ISR_CGIF3);
+
     SET_DMA_CMAR(DMA_CMAR3, (uint32_t) buffer); // memory address
     SET_DMA_CNDTR_NDT(DMA_CNDTR3, size); // byte count
 
     Recv_complete = false;
     Recv_cndt = size;
+    Recv_err = 0; // Error of previous receive is already reported
 
     SET_BIT(DMA_CCR3, DMA_CCR_EN); // enable channel
 
@@ -528,4 +630,57 @@ int uart_recv_string_n(struct Uart* uart, uint8_t* data, unsigned n)
 
     data[ct] = '\0';
     return 0;
-}
\ No newline at end of file
+}
+
+//---------------------------------------------------------
+
+int uart_recv_stream(struct Uart* uart, struct Ring* ring)
+{
+    if (uart == NULL || ring == NULL)
+        return UART_INV_PTR;
+
+    if (uart->recv_enabled == false)
+        return UART_RECV_DIS;
+
+    if (Recv_complete != true)
+        return UART_RECV_NOT_COMPL;
+
+    Stream_ring = ring;
+    Stream_dropped = 0U;
+
+    Recv_complete = false;
+    Recv_stream = true;
+
+    // Few bytes a millisecond at most: an interrupt per byte costs less than
+    // keeping DMA channel 3, which SPI1 transmit has no other choice of
+    CLEAR_BIT(USART_CR3(uart->UARTx), USART_CR3_DMAR);
+    SET_BIT(USART_CR1(uart->UARTx), USART_CR1_RXNEIE);
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+void uart_recv_abort(void)
+{
+    uint32_t primask = irq_save();
+
+    if (Recv_complete == false)
+        recv_complete_routine();
+
+    irq_restore(primask);
+}
+
+//---------------------------------------------------------
+
+size_t uart_recv_pos(void)
+{
+    return Recv_cndt - GET_DMA_CNDTR_NDT(DMA_CNDTR3);
+}
+
+//---------------------------------------------------------
+
+unsigned uart_recv_dropped(void)
+{
+    return Stream_dropped;
+}
@@ -6,6 +6,8 @@
 
 //=========================================================
 
+struct Ring;
+
 struct Port_n_pin
 {
     uint32_t port;
@@ -77,7 +79,29 @@ int uart_recv_string_n(struct Uart* uart, uint8_t* data, unsigned n);
 int uart_trns_buffer(struct Uart* uart, const void* buffer, size_t size);
 int uart_recv_buffer(struct Uart* uart, void* buffer, size_t size);
 
+// Receive into ring (see ring.h) on RXNE interrupt until reset,
+// receive is never complete meanwhile
+int uart_recv_stream(struct Uart* uart, struct Ring* ring);
+
+// Offset in buffer next received byte goes to, DMA receive only
+size_t uart_recv_pos(void);
+
+// Stream bytes lost to a full ring since uart_recv_stream()
+unsigned uart_recv_dropped(void);
+
+// Complete ongoing receive with what is received so far
+void uart_recv_abort(void);
+
 int is_trns_complete(void);
 int is_recv_complete(void);
 
 void uart_wait_for_tc(struct Uart* uart);
+
+// Wait for transmission to complete on all set up UARTs
+void uart_wait_idle(void);
+
+// No DMA transfer in flight and all transmitters drained
+bool uart_is_idle(void);
+
+// Recompute baud rate of all set up UARTs for new PCLK frequency
+void uart_set_frequency(size_t frequency);
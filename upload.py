@@ -0,0 +1,109 @@
+#!/usr/bin/python3
+
+#=========================================================
+
+import argparse
+import glob
+import sys
+import threading
+import time
+
+import usart
+
+#=========================================================
+
+REPLY_TIMEOUT = 5  # Board replies 1.5 s after the last byte
+RETRY_PAUSE   = 1  # Board drains a failed upload until the line is quiet for 0.5 s
+
+#=========================================================
+
+class Board:
+    def __init__(self, port):
+        self.port = port
+        self.attempts = 0
+        self.ok = False
+        self.error = None
+        self.rate = 0.0
+        self.elapsed = 0.0
+
+#---------------------------------------------------------
+
+def upload(board, image, retries):
+    start = time.monotonic()
+
+    try:
+        dev = usart.serial_init(usart.BAUDRATE, board.port)
+    except Exception as exc:
+        board.error = str(exc)
+        return
+
+    with dev:
+        while board.attempts < retries and not board.ok:
+            board.attempts += 1
+
+            dev.reset_input_buffer()
+
+            sent = time.monotonic()
+            usart.serial_send(dev, image)
+            dev.flush()
+            board.rate = len(image) / max(time.monotonic() - sent, 1e-6)
+
+            reply = usart.wait_reply(dev, REPLY_TIMEOUT)
+
+            # Firmware update is answered once staging copy verifies, before reset
+            if reply:
+                board.ok = True
+                board.error = None
+            else:
+                board.error = "rejected" if reply is False else "no reply"
+                time.sleep(RETRY_PAUSE)
+
+    board.elapsed = time.monotonic() - start
+
+#---------------------------------------------------------
+
+def main():
+    parser = argparse.ArgumentParser(description="Upload guest code, asset pack or firmware to many boards at once")
+    parser.add_argument('binary')
+    parser.add_argument('ports', nargs='*', help="serial ports, default: /dev/ttyUSB*")
+    parser.add_argument('--firmware', action='store_true', help="host firmware update")
+    parser.add_argument('--assets', action='store_true', help="asset pack, see assets.py")
+    parser.add_argument('--retries', type=int, default=3)
+    args = parser.parse_args()
+
+    ports = args.ports or sorted(glob.glob('/dev/ttyUSB*'))
+    if not ports:
+        print("No serial ports found")
+        sys.exit(1)
+
+    # Image is prepared once and shared by all workers
+    magic = usart.FWUP_MAGIC if args.firmware else usart.ASSETS_MAGIC if args.assets else None
+    image = usart.prepare_image(args.binary, magic)
+    boards = [Board(port) for port in ports]
+
+    start = time.monotonic()
+
+    workers = [threading.Thread(target=upload, args=(board, image, args.retries))
+               for board in boards]
+
+    for worker in workers:
+        worker.start()
+    for worker in workers:
+        worker.join()
+
+    total = time.monotonic() - start
+
+    for board in boards:
+        status = "ok" if board.ok else "FAILED (" + str(board.error) + ")"
+        print("%-16s %-24s attempts %d, %6.0f B/s, %5.1f s" %
+              (board.port, status, board.attempts, board.rate, board.elapsed))
+
+    failed = sum(1 for board in boards if not board.ok)
+    print("%d bytes to %d board(s) in %.1f s, %d failed" % (len(image), len(boards), total, failed))
+
+    sys.exit(1 if failed else 0)
+
+#---------------------------------------------------------
+
+if __name__ == '__main__':
+    main()
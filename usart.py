@@ -8,14 +8,14 @@ import zlib
 
 #=========================================================
 
-def serial_init(speed):
+def serial_init(speed, port='/dev/ttyUSB0', timeout=3):
     dev = serial.Serial(
-        port     = '/dev/ttyUSB0', 
+        port     = port,
         baudrate = speed,
         parity   = serial.PARITY_ODD,
         stopbits = serial.STOPBITS_ONE,
         bytesize = serial.EIGHTBITS,
-        timeout  = 3
+        timeout  = timeout
     )
     return dev
 
@@ -30,7 +30,7 @@ def serial_recv_str(dev):
 #---------------------------------------------------------
 
 def serial_send_str(dev, string):
-    # encode конвертирует строку в кодировке utf-8 в набор байтов 
+    # encode конвертирует строку в кодировке utf-8 в набор байтов
     dev.write(string.encode('utf-8'))
 
 #---------------------------------------------------------
@@ -45,25 +45,79 @@ def serial_send(dev, data):
 
 #=========================================================
 
-if len(sys.argv) != 2:
-    print("Usage: sudo ./usart.py /path/to/binary")
+BAUDRATE = 9600
 
-binary_data = [] 
+FWUP_MAGIC   = b'FWUP' # host firmware update, see fwup.h
+ASSETS_MAGIC = b'ASET' # asset pack, see assets.h
 
-with open(sys.argv[1], mode='rb') as binary:
-    
-    binary_data = binary.read() # read binary file to send
-    # print(binary_data)
+# Loader reply after upload, see main.c
+LOADER_ACK = b'ACK!'
+LOADER_NAK = b'NAK!'
+
+#=========================================================
+
+# magic: None for guest code, FWUP_MAGIC or ASSETS_MAGIC
+def prepare_image(path, magic=None):
+    with open(path, mode='rb') as binary:
+        binary_data = binary.read() # read binary file to send
 
     while (len(binary_data) % 4) != 0:
         binary_data += b'\0' # append zero bytes for word alignment
 
     hash = zlib.crc32(binary_data)
-    # print(hex(hash))
 
-    binary_data += hash.to_bytes(4, "little")
-    # print(binary_data) 
+    if magic is not None:
+        # Header: magic + image size, crc is calculated over image only
+        binary_data = magic + len(binary_data).to_bytes(4, "little") + binary_data
+
+    return binary_data + hash.to_bytes(4, "little")
+
+#---------------------------------------------------------
+
+def wait_reply(dev, timeout):
+    # Log frames may come along with the reply: look for the tokens
+    dev.timeout = timeout
+    received = b''
+
+    while True:
+        chunk = dev.read(1)
+        if not chunk:
+            return None
+
+        received = (received + chunk)[-4:]
+
+        if received == LOADER_ACK:
+            return True
+        if received == LOADER_NAK:
+            return False
 
-    dev = serial_init(9600) 
+#---------------------------------------------------------
+
+def main():
+    magics = { '--firmware': FWUP_MAGIC, '--assets': ASSETS_MAGIC }
+
+    option = sys.argv[1] if len(sys.argv) == 3 else None
+    firmware = (option == '--firmware')
+
+    if len(sys.argv) not in (2, 3) or (option is not None and option not in magics):
+        print("Usage: sudo ./usart.py [--firmware | --assets] /path/to/binary")
+        sys.exit(1)
+
+    binary_data = prepare_image(sys.argv[-1], magics.get(option))
+
+    dev = serial_init(BAUDRATE)
     serial_send(dev, binary_data)
 
+    # Board replies once line is idle (receive timeout is 1.5 s)
+    reply = wait_reply(dev, 5)
+
+    if reply:
+        print("Firmware verified, board resets" if firmware else "Upload accepted")
+    else:
+        print("Upload failed: " + ("rejected by board" if reply is False else "no reply"))
+        sys.exit(1)
+
+#---------------------------------------------------------
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,702 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+//---------------------------------------------------------
+
+#include "vm.h"
+#include "memops.h"
+#include "log.h"
+
+//=========================================================
+
+#define VM_SYS_INDEX(NAME) (offsetof(struct API, NAME) / sizeof(void (*)(void)))
+#define VM_SYS_NUM         (sizeof(struct API) / sizeof(void (*)(void)))
+
+// Sys_args entry: callable flag and number of arguments
+#define VM_SYS_ARGS(NUM) (0x80U | (NUM))
+#define VM_SYS_ARGC(ARGS) ((ARGS) & 0x0FU)
+
+#define VM_ALIGN(SIZE) (((SIZE) + 3U) & ~3U)
+
+struct Vm_frame
+{
+    const uint8_t* ret;
+    int32_t* fp;
+};
+
+// Arguments taken from the stack, 0 for entries bytecode can not call
+static const uint8_t Sys_args[VM_SYS_NUM] =
+{
+    [VM_SYS_INDEX(blue_led_on)]       = VM_SYS_ARGS(0U),
+    [VM_SYS_INDEX(green_led_on)]      = VM_SYS_ARGS(0U),
+    [VM_SYS_INDEX(blue_led_off)]      = VM_SYS_ARGS(0U),
+    [VM_SYS_INDEX(green_led_off)]     = VM_SYS_ARGS(0U),
+    [VM_SYS_INDEX(is_button_pressed)] = VM_SYS_ARGS(1U),
+    [VM_SYS_INDEX(scrn_clear)]        = VM_SYS_ARGS(1U),
+    [VM_SYS_INDEX(scrn_draw)]         = VM_SYS_ARGS(0U),
+    [VM_SYS_INDEX(scrn_set_pxl)]      = VM_SYS_ARGS(2U),
+    [VM_SYS_INDEX(scrn_clr_pxl)]      = VM_SYS_ARGS(2U),
+    [VM_SYS_INDEX(scrn_inv_pxl)]      = VM_SYS_ARGS(2U),
+    [VM_SYS_INDEX(scrn_puts)]         = VM_SYS_ARGS(4U),
+    [VM_SYS_INDEX(scrn_xline)]        = VM_SYS_ARGS(3U),
+    [VM_SYS_INDEX(scrn_yline)]        = VM_SYS_ARGS(3U),
+    [VM_SYS_INDEX(scrn_box)]          = VM_SYS_ARGS(4U),
+    [VM_SYS_INDEX(kv_read)]           = VM_SYS_ARGS(3U),
+    [VM_SYS_INDEX(kv_write)]          = VM_SYS_ARGS(3U),
+    [VM_SYS_INDEX(kv_erase)]          = VM_SYS_ARGS(1U),
+    [VM_SYS_INDEX(set_perf_level)]    = VM_SYS_ARGS(1U),
+    [VM_SYS_INDEX(idle)]              = VM_SYS_ARGS(1U),
+    [VM_SYS_INDEX(serial_write)]      = VM_SYS_ARGS(2U),
+    [VM_SYS_INDEX(serial_read)]       = VM_SYS_ARGS(2U),
+    [VM_SYS_INDEX(link_start)]        = VM_SYS_ARGS(1U),
+    [VM_SYS_INDEX(link_step)]         = VM_SYS_ARGS(3U),
+    [VM_SYS_INDEX(sound_play)]        = VM_SYS_ARGS(4U),
+    [VM_SYS_INDEX(sound_stop)]        = VM_SYS_ARGS(1U),
+    [VM_SYS_INDEX(asset_size)]        = VM_SYS_ARGS(1U),
+    [VM_SYS_INDEX(asset_read)]        = VM_SYS_ARGS(3U),
+    [VM_SYS_INDEX(mem_usage)]         = VM_SYS_ARGS(1U),
+    [VM_SYS_INDEX(mem_copy)]          = VM_SYS_ARGS(3U),
+    [VM_SYS_INDEX(mem_fill)]          = VM_SYS_ARGS(3U),
+    [VM_SYS_INDEX(mem_move)]          = VM_SYS_ARGS(3U),
+    [VM_SYS_INDEX(scrn_select)]       = VM_SYS_ARGS(2U),
+    [VM_SYS_INDEX(scrn_draw_all)]     = VM_SYS_ARGS(0U),
+    [VM_SYS_INDEX(probe_now)]         = VM_SYS_ARGS(0U),
+    [VM_SYS_INDEX(probe_add)]         = VM_SYS_ARGS(2U),
+    [VM_SYS_INDEX(probe_take)]        = VM_SYS_ARGS(2U)
+
+    // log_write takes format addresses from .logstr, which bytecode has not got,
+    // scrn_putchar is not set in API_host, asset_map and mem_map give host addresses,
+    // div_u32 and div_s32 return two words while bytecode has DIV and MOD,
+    // frame_run calls back into Thumb code
+};
+
+//=========================================================
+
+int vm_check(const uint8_t* mem, size_t capacity)
+{
+    const struct Vm_header* header = (const struct Vm_header*) mem;
+
+    if (capacity < sizeof(*header) || header->magic != VM_MAGIC)
+        return VM_INV_IMAGE;
+
+    if (header->size <= sizeof(*header) || header->size > capacity)
+        return VM_INV_IMAGE;
+
+    if (VM_ALIGN(header->size) + header->globals * 4U > capacity)
+        return VM_INV_IMAGE;
+
+    return 0;
+}
+
+//---------------------------------------------------------
+
+uint32_t vm_footprint(const uint8_t* mem)
+{
+    const struct Vm_header* header = (const struct Vm_header*) mem;
+
+    return VM_ALIGN(header->size) + header->globals * 4U;
+}
+
+//---------------------------------------------------------
+
+// Guest address range to host pointer, NULL if it leaves guest area
+static void* vm_ptr(uint8_t* mem, size_t capacity, uint32_t addr, uint32_t len)
+{
+    if (addr > capacity || len > capacity - addr)
+        return NULL;
+
+    return mem + addr;
+}
+
+//---------------------------------------------------------
+
+static int vm_sys(struct API* api, unsigned index, const int32_t* args,
+                  uint8_t* mem, size_t capacity, int32_t* res)
+{
+    const uint32_t* arg = (const uint32_t*) args;
+    void* ptr = NULL;
+    const void* src = NULL;
+
+    *res = 0;
+
+    switch (index)
+    {
+        case VM_SYS_INDEX(blue_led_on):   api->blue_led_on();   break;
+        case VM_SYS_INDEX(green_led_on):  api->green_led_on();  break;
+        case VM_SYS_INDEX(blue_led_off):  api->blue_led_off();  break;
+        case VM_SYS_INDEX(green_led_off): api->green_led_off(); break;
+
+        case VM_SYS_INDEX(is_button_pressed): *res = api->is_button_pressed(arg[0]); break;
+
+        case VM_SYS_INDEX(scrn_clear): api->scrn_clear((uint8_t) arg[0]); break;
+        case VM_SYS_INDEX(scrn_draw):  api->scrn_draw();                  break;
+
+        case VM_SYS_INDEX(scrn_set_pxl): *res = api->scrn_set_pxl(arg[0], arg[1]);                     break;
+        case VM_SYS_INDEX(scrn_clr_pxl): *res = api->scrn_clr_pxl(arg[0], arg[1]);                     break;
+        case VM_SYS_INDEX(scrn_inv_pxl): *res = api->scrn_inv_pxl(arg[0], arg[1]);                     break;
+        case VM_SYS_INDEX(scrn_xline):   *res = api->scrn_xline(arg[0], arg[1], arg[2]);               break;
+        case VM_SYS_INDEX(scrn_yline):   *res = api->scrn_yline(arg[0], arg[1], arg[2]);               break;
+        case VM_SYS_INDEX(scrn_box):     *res = api->scrn_box(arg[0], arg[1], arg[2], arg[3]);         break;
+
+        case VM_SYS_INDEX(scrn_puts):
+            ptr = vm_ptr(mem, capacity, arg[2], arg[3]);
+            if (ptr == NULL) return VM_INV_ADDR;
+
+            *res = api->scrn_puts(arg[0], arg[1], ptr, arg[3]);
+            break;
+
+        case VM_SYS_INDEX(kv_read):
+            ptr = vm_ptr(mem, capacity, arg[1], arg[2]);
+            if (ptr == NULL) return VM_INV_ADDR;
+
+            *res = api->kv_read(arg[0], ptr, arg[2]);
+            break;
+
+        case VM_SYS_INDEX(kv_write):
+            ptr = vm_ptr(mem, capacity, arg[1], arg[2]);
+            if (ptr == NULL) return VM_INV_ADDR;
+
+            *res = api->kv_write(arg[0], ptr, arg[2]);
+            break;
+
+        case VM_SYS_INDEX(kv_erase):       *res = api->kv_erase(arg[0]);       break;
+        case VM_SYS_INDEX(set_perf_level): *res = api->set_perf_level(arg[0]); break;
+        case VM_SYS_INDEX(idle):           *res = api->idle(arg[0]);           break;
+
+        case VM_SYS_INDEX(serial_write):
+            ptr = vm_ptr(mem, capacity, arg[0], arg[1]);
+            if (ptr == NULL) return VM_INV_ADDR;
+
+            *res = api->serial_write(ptr, arg[1]);
+            break;
+
+        case VM_SYS_INDEX(serial_read):
+            ptr = vm_ptr(mem, capacity, arg[0], arg[1]);
+            if (ptr == NULL) return VM_INV_ADDR;
+
+            *res = api->serial_read(ptr, arg[1]);
+            break;
+
+        case VM_SYS_INDEX(link_start): *res = api->link_start(arg[0]); break;
+
+        case VM_SYS_INDEX(link_step):
+            ptr = vm_ptr(mem, capacity, arg[1], arg[2]);
+            if (ptr == NULL) return VM_INV_ADDR;
+
+            *res = api->link_step(arg[0], ptr, arg[2]);
+            break;
+
+        case VM_SYS_INDEX(sound_play): *res = api->sound_play(arg[0], arg[1], arg[2], arg[3]); break;
+        case VM_SYS_INDEX(sound_stop): *res = api->sound_stop(arg[0]);                         break;
+
+        case VM_SYS_INDEX(asset_size): *res = api->asset_size(arg[0]); break;
+
+        case VM_SYS_INDEX(asset_read):
+            ptr = vm_ptr(mem, capacity, arg[1], arg[2]);
+            if (ptr == NULL) return VM_INV_ADDR;
+
+            *res = api->asset_read(arg[0], ptr, arg[2]);
+            break;
+
+        case VM_SYS_INDEX(mem_usage):
+            ptr = vm_ptr(mem, capacity, arg[0], sizeof(struct Mem_usage));
+            if (ptr == NULL || (arg[0] & 3U) != 0U) return VM_INV_ADDR;
+
+            *res = api->mem_usage(ptr);
+            break;
+
+        // Result is the guest address of dst, not the host one
+        case VM_SYS_INDEX(mem_copy):
+        case VM_SYS_INDEX(mem_move):
+            ptr = vm_ptr(mem, capacity, arg[0], arg[2]);
+            src = vm_ptr(mem, capacity, arg[1], arg[2]);
+            if (ptr == NULL || src == NULL) return VM_INV_ADDR;
+
+            api->mem_move(ptr, src, arg[2]);
+            *res = (int32_t) arg[0];
+            break;
+
+        case VM_SYS_INDEX(mem_fill):
+            ptr = vm_ptr(mem, capacity, arg[0], arg[2]);
+            if (ptr == NULL) return VM_INV_ADDR;
+
+            api->mem_fill(ptr, (int) arg[1], arg[2]);
+            *res = (int32_t) arg[0];
+            break;
+
+        case VM_SYS_INDEX(scrn_select):
+            ptr = (arg[1] == 0U)? NULL : vm_ptr(mem, capacity, arg[1], SCRN_FB_BYTES);
+            if (arg[1] != 0U && ptr == NULL) return VM_INV_ADDR;
+
+            *res = api->scrn_select(arg[0], ptr);
+            break;
+
+        case VM_SYS_INDEX(scrn_draw_all): api->scrn_draw_all(); break;
+
+        case VM_SYS_INDEX(probe_now): *res = (int32_t) api->probe_now();     break;
+        case VM_SYS_INDEX(probe_add): *res = api->probe_add(arg[0], arg[1]); break;
+
+        case VM_SYS_INDEX(probe_take):
+            ptr = vm_ptr(mem, capacity, arg[1], sizeof(struct Probe_stats));
+            if (ptr == NULL || (arg[1] & 3U) != 0U) return VM_INV_ADDR;
+
+            *res = api->probe_take(arg[0], ptr);
+            break;
+
+        default:
+            return VM_INV_SYS;
+    }
+
+    return 0;
+}
+
+//=========================================================
+
+/*
+    Top of stack is kept in tos, the words below it in stack[] up to sp.
+    Slot 0 is never used: stack[1] takes the empty top spilled on the
+    first push, so a function's locals never sit in tos and can be read
+    through fp. sp - stack is the depth checked before a pop.
+
+    Dispatch jumps through a table of label addresses after every
+    opcode: on M0 that is a bound check of pc, ldrb, cmp, ldr and a 
+    jump, with no return into a shared switch. Code that runs off its
+    end without VM_HALT or VM_RET, or whose last instruction is cut
+    short of its operands, is stopped as a bad address.
+*/
+
+#define NEXT()                                      \
+    do                                              \
+    {                                               \
+        if (pc >= code_end) goto inv_addr;          \
+        unsigned op_ = *pc++;                       \
+        if (op_ >= VM_OPCODES_NUM) goto inv_op;     \
+        goto *Dispatch[op_];                        \
+    } while (0)
+
+#define PUSH(VALUE)                                 \
+    do                                              \
+    {                                               \
+        if (sp == stack_end) goto stack_err;        \
+        *++sp = tos;                                \
+        tos = (VALUE);                              \
+    } while (0)
+
+// NUM operand bytes left before the end of code
+#define OPERANDS(NUM)                               \
+    do                                              \
+    {                                               \
+        if (code_end - pc < (NUM)) goto inv_addr;   \
+    } while (0)
+
+// At least NUM words under the top
+#define NEED(NUM)                                   \
+    do                                              \
+    {                                               \
+        if (sp - stack < (NUM)) goto stack_err;     \
+    } while (0)
+
+// Wrapping arithmetic on two's complement words
+#define BINARY_U(OP) NEED(1); tos = (int32_t) ((uint32_t) *sp-- OP (uint32_t) tos); NEXT()
+#define BINARY(OP)   NEED(1); tos = *sp-- OP tos; NEXT()
+
+#define JUMP_TO(TARGET)                                             \
+    do                                                              \
+    {                                                               \
+        pc = (TARGET);                                              \
+        if (pc < code_start || pc >= code_end) goto inv_addr;       \
+    } while (0)
+
+#define OPERAND_S16(PTR) ((int16_t) ((PTR)[0] | (PTR)[1] << 8))
+#define OPERAND_U16(PTR) ((uint16_t) ((PTR)[0] | (PTR)[1] << 8))
+
+//---------------------------------------------------------
+
+int vm_run(uint8_t* mem, size_t capacity, struct API* api)
+{
+    static const void* const Dispatch[VM_OPCODES_NUM] =
+    {
+        [VM_HALT]      = &&op_halt,
+        [VM_PUSH8]     = &&op_push8,
+        [VM_PUSH16]    = &&op_push16,
+        [VM_PUSH32]    = &&op_push32,
+        [VM_DUP]       = &&op_dup,
+        [VM_DROP]      = &&op_drop,
+        [VM_SWAP]      = &&op_swap,
+        [VM_OVER]      = &&op_over,
+
+        [VM_LOCAL]     = &&op_local,
+        [VM_SETLOCAL]  = &&op_setlocal,
+        [VM_GLOBAL]    = &&op_global,
+        [VM_SETGLOBAL] = &&op_setglobal,
+        [VM_GADDR]     = &&op_gaddr,
+        [VM_LOADW]     = &&op_loadw,
+        [VM_STOREW]    = &&op_storew,
+        [VM_LOADB]     = &&op_loadb,
+        [VM_STOREB]    = &&op_storeb,
+
+        [VM_ADD]       = &&op_add,
+        [VM_SUB]       = &&op_sub,
+        [VM_MUL]       = &&op_mul,
+        [VM_DIV]       = &&op_div,
+        [VM_MOD]       = &&op_mod,
+        [VM_NEG]       = &&op_neg,
+        [VM_AND]       = &&op_and,
+        [VM_OR]        = &&op_or,
+        [VM_XOR]       = &&op_xor,
+        [VM_NOT]       = &&op_not,
+        [VM_SHL]       = &&op_shl,
+        [VM_SHR]       = &&op_shr,
+        [VM_ADDI]      = &&op_addi,
+
+        [VM_EQ]        = &&op_eq,
+        [VM_NE]        = &&op_ne,
+        [VM_LT]        = &&op_lt,
+        [VM_LE]        = &&op_le,
+        [VM_GT]        = &&op_gt,
+        [VM_GE]        = &&op_ge,
+
+        [VM_ABS]       = &&op_abs,
+        [VM_MIN]       = &&op_min,
+        [VM_MAX]       = &&op_max,
+
+        [VM_JMP]       = &&op_jmp,
+        [VM_JZ]        = &&op_jz,
+        [VM_JNZ]       = &&op_jnz,
+        [VM_CALL]      = &&op_call,
+        [VM_RET]       = &&op_ret,
+        [VM_ENTER]     = &&op_enter,
+
+        [VM_SYS]       = &&op_sys
+    };
+
+    int err = vm_check(mem, capacity);
+    if (err < 0)
+        return err;
+
+    const struct Vm_header* header = (const struct Vm_header*) mem;
+    const uint8_t* const code_start = mem + sizeof(*header);
+    const uint8_t* const code_end = mem + header->size;
+
+    const uint32_t globals_addr = VM_ALIGN(header->size);
+    const unsigned globals_num = header->globals;
+    int32_t* const globals = (int32_t*) (mem + globals_addr);
+
+    mem_fill(globals, 0, globals_num * sizeof(int32_t));
+
+    int32_t stack[VM_STACK_WORDS + 1U];
+    int32_t* const stack_end = &stack[VM_STACK_WORDS];
+
+    struct Vm_frame frames[VM_MAX_FRAMES];
+    unsigned depth = 0U;
+
+    // Top level is entered like a call without arguments
+    int32_t* sp = stack;
+    int32_t* fp = stack + 1;
+    int32_t tos = 0;
+
+    const uint8_t* pc = code_start;
+    int32_t* slot = NULL;
+    uint32_t addr = 0U;
+
+    NEXT();
+
+    //---------------------------------------------------------
+    // Stack
+    //---------------------------------------------------------
+
+op_push8:
+    OPERANDS(1);
+    PUSH((int8_t) pc[0]);
+    pc += 1;
+    NEXT();
+
+op_push16:
+    OPERANDS(2);
+    PUSH(OPERAND_S16(pc));
+    pc += 2;
+    NEXT();
+
+op_push32:
+    OPERANDS(4);
+    PUSH((int32_t) ((uint32_t) pc[0] | (uint32_t) pc[1] << 8 | (uint32_t) pc[2] << 16 | (uint32_t) pc[3] << 24));
+    pc += 4;
+    NEXT();
+
+op_dup:
+    PUSH(tos);
+    NEXT();
+
+op_drop:
+    NEED(1);
+    tos = *sp--;
+    NEXT();
+
+op_swap:
+    NEED(1);
+    {
+        int32_t under = *sp;
+        *sp = tos;
+        tos = under;
+    }
+    NEXT();
+
+op_over:
+    NEED(1);
+    PUSH(*sp);
+    NEXT();
+
+    //---------------------------------------------------------
+    // Variables and memory
+    //---------------------------------------------------------
+
+op_local:
+    OPERANDS(1);
+    slot = fp + *pc++;
+    if (slot > stack_end) goto stack_err;
+
+    PUSH(*slot);
+    NEXT();
+
+op_setlocal:
+    OPERANDS(1);
+    NEED(1);
+    slot = fp + *pc++;
+    if (slot > stack_end) goto stack_err;
+
+    *slot = tos;
+    tos = *sp--;
+    NEXT();
+
+op_global:
+    OPERANDS(1);
+    if (*pc >= globals_num) goto inv_addr;
+
+    PUSH(globals[*pc++]);
+    NEXT();
+
+op_setglobal:
+    OPERANDS(1);
+    NEED(1);
+    if (*pc >= globals_num) goto inv_addr;
+
+    globals[*pc++] = tos;
+    tos = *sp--;
+    NEXT();
+
+op_gaddr:
+    OPERANDS(1);
+    if (*pc >= globals_num) goto inv_addr;
+
+    PUSH((int32_t) (globals_addr + *pc++ * 4U));
+    NEXT();
+
+op_loadw:
+    addr = (uint32_t) tos;
+    if (addr > capacity - 4U || (addr & 3U) != 0U) goto inv_addr;
+
+    tos = *(const int32_t*) (mem + addr);
+    NEXT();
+
+op_storew:
+    NEED(2);
+    addr = (uint32_t) tos;
+    if (addr > capacity - 4U || (addr & 3U) != 0U) goto inv_addr;
+
+    *(int32_t*) (mem + addr) = *sp--;
+    tos = *sp--;
+    NEXT();
+
+op_loadb:
+    addr = (uint32_t) tos;
+    if (addr >= capacity) goto inv_addr;
+
+    tos = mem[addr];
+    NEXT();
+
+op_storeb:
+    NEED(2);
+    addr = (uint32_t) tos;
+    if (addr >= capacity) goto inv_addr;
+
+    mem[addr] = (uint8_t) *sp--;
+    tos = *sp--;
+    NEXT();
+
+    //---------------------------------------------------------
+    // Arithmetic
+    //---------------------------------------------------------
+
+op_add: BINARY_U(+);
+op_sub: BINARY_U(-);
+op_mul: BINARY_U(*);
+op_and: BINARY(&);
+op_or:  BINARY(|);
+op_xor: BINARY(^);
+
+op_div:
+    NEED(1);
+    if (tos == 0) goto div_zero;
+
+    // INT32_MIN / -1 traps on some cores and is undefined in C
+    tos = (tos == -1)? (int32_t) (0U - (uint32_t) *sp) : *sp / tos;
+    sp--;
+    NEXT();
+
+op_mod:
+    NEED(1);
+    if (tos == 0) goto div_zero;
+
+    tos = (tos == -1)? 0 : *sp % tos;
+    sp--;
+    NEXT();
+
+op_neg:
+    tos = (int32_t) (0U - (uint32_t) tos);
+    NEXT();
+
+op_not:
+    tos = ~tos;
+    NEXT();
+
+op_shl:
+    NEED(1);
+    tos = (int32_t) ((uint32_t) *sp-- << (tos & 31));
+    NEXT();
+
+op_shr:
+    NEED(1);
+    tos = *sp-- >> (tos & 31);
+    NEXT();
+
+op_addi:
+    OPERANDS(1);
+    tos = (int32_t) ((uint32_t) tos + (uint32_t) (int8_t) *pc++);
+    NEXT();
+
+op_eq: BINARY(==);
+op_ne: BINARY(!=);
+op_lt: BINARY(<);
+op_le: BINARY(<=);
+op_gt: BINARY(>);
+op_ge: BINARY(>=);
+
+op_abs:
+    tos = (tos < 0)? (int32_t) (0U - (uint32_t) tos) : tos;
+    NEXT();
+
+op_min:
+    NEED(1);
+    tos = (*sp < tos)? *sp : tos;
+    sp--;
+    NEXT();
+
+op_max:
+    NEED(1);
+    tos = (*sp > tos)? *sp : tos;
+    sp--;
+    NEXT();
+
+    //---------------------------------------------------------
+    // Control
+    //---------------------------------------------------------
+
+op_jmp:
+    OPERANDS(2);
+    JUMP_TO(pc + 2 + OPERAND_S16(pc));
+    NEXT();
+
+op_jz:
+    OPERANDS(2);
+    NEED(1);
+    if (tos == 0)
+        JUMP_TO(pc + 2 + OPERAND_S16(pc));
+    else
+        pc += 2;
+
+    tos = *sp--;
+    NEXT();
+
+op_jnz:
+    OPERANDS(2);
+    NEED(1);
+    if (tos != 0)
+        JUMP_TO(pc + 2 + OPERAND_S16(pc));
+    else
+        pc += 2;
+
+    tos = *sp--;
+    NEXT();
+
+op_call:
+    OPERANDS(3);
+    if (depth == VM_MAX_FRAMES) goto call_err;
+    if (sp == stack_end) goto stack_err;
+
+    // Arguments go to memory with the rest of the caller's stack
+    *++sp = tos;
+    if (sp - stack < pc[0]) goto stack_err;
+
+    frames[depth].ret = pc + 3;
+    frames[depth].fp = fp;
+    depth++;
+
+    fp = sp - pc[0] + 1;
+    JUMP_TO(mem + OPERAND_U16(pc + 1));
+    NEXT();
+
+op_enter:
+    OPERANDS(1);
+    if (stack_end - sp < *pc) goto stack_err;
+
+    for (unsigned num = *pc++; num != 0U; num--)
+        *++sp = 0;
+
+    NEXT();
+
+op_ret:
+    if (depth == 0U)
+        return 0;
+
+    // Result replaces arguments of the call
+    depth--;
+    sp = fp - 1;
+    fp = frames[depth].fp;
+    pc = frames[depth].ret;
+    NEXT();
+
+op_sys:
+    OPERANDS(1);
+    if (*pc >= VM_SYS_NUM || Sys_args[*pc] == 0U) goto inv_sys;
+    if (sp == stack_end) goto stack_err;
+
+    *++sp = tos;
+    if (sp - stack < VM_SYS_ARGC(Sys_args[*pc])) goto stack_err;
+
+    sp -= VM_SYS_ARGC(Sys_args[*pc]);
+
+    err = vm_sys(api, *pc, sp + 1, mem, capacity, &tos);
+    if (err < 0) goto fault;
+
+    pc++;
+    NEXT();
+
+op_halt:
+    return 0;
+
+    //---------------------------------------------------------
+    // Errors
+    //---------------------------------------------------------
+
+inv_op:   err = VM_INV_OP;    pc--; goto fault;
+inv_addr: err = VM_INV_ADDR;  goto fault;
+stack_err: err = VM_STACK_ERR; goto fault;
+call_err: err = VM_CALL_ERR;  goto fault;
+div_zero: err = VM_DIV_ZERO;  goto fault;
+inv_sys:  err = VM_INV_SYS;   goto fault;
+
+fault:
+    LOG("vm: error %d near 0x%04x", err, (uint32_t) (pc - mem));
+    return err;
+}
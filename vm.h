@@ -0,0 +1,129 @@
+#pragma once
+
+//=========================================================
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "common/api.h"
+
+//=========================================================
+
+/*
+    Bytecode guests: stack machine of 32-bit words interpreted from
+    host flash, so game logic goes over the wire as a few bytes per
+    statement instead of Thumb code. Drawing, input and storage are
+    SYS calls straight into struct API and run at native speed.
+
+    Image, as uploaded in place of Thumb code (see vmasm.py):
+
+        [Vm_header][code and constant data][globals ...]
+                   ^ address 0
+
+    Addresses are offsets from the image start and cover the whole
+    guest area: code, constants and word-aligned globals that follow
+    the image (zeroed at start). Everything is little-endian.
+
+    Operands follow the opcode: s8/s16/i32 constants, u8 slot numbers,
+    s16 jump offsets from the next opcode, u16 call addresses.
+    Binary operations take "a b" with b on top and leave "a op b".
+
+    CALL argc addr: the last argc words become the callee's first
+    locals, ENTER n adds n zeroed ones, RET leaves the top word in
+    place of the arguments. SYS n calls entry n of struct API with
+    its arguments from the stack and pushes the result (0 for void).
+*/
+
+#define VM_MAGIC 0x314D5642U // "BVM1"
+
+#define VM_STACK_WORDS 64U
+#define VM_MAX_FRAMES  16U
+
+struct Vm_header
+{
+    uint32_t magic;
+    uint16_t size;    // Header and code
+    uint16_t globals; // Words after code, aligned to word
+};
+
+enum Vm_error
+{
+    VM_INV_IMAGE = -48,
+    VM_INV_OP    = -49,
+    VM_INV_ADDR  = -50, // Memory access or jump out of guest area
+    VM_STACK_ERR = -51, // Stack overflow or underflow
+    VM_CALL_ERR  = -52, // Calls nested too deep
+    VM_DIV_ZERO  = -53,
+    VM_INV_SYS   = -54
+};
+
+// Keep in sync with OPCODES in vmasm.py
+enum Vm_opcode
+{
+    VM_HALT      = 0x00,
+    VM_PUSH8     = 0x01, // s8
+    VM_PUSH16    = 0x02, // s16
+    VM_PUSH32    = 0x03, // i32
+    VM_DUP       = 0x04,
+    VM_DROP      = 0x05,
+    VM_SWAP      = 0x06,
+    VM_OVER      = 0x07,
+
+    VM_LOCAL     = 0x08, // u8 slot
+    VM_SETLOCAL  = 0x09, // u8 slot
+    VM_GLOBAL    = 0x0A, // u8 slot
+    VM_SETGLOBAL = 0x0B, // u8 slot
+    VM_GADDR     = 0x0C, // u8 slot, pushes its address
+    VM_LOADW     = 0x0D, // addr -> word
+    VM_STOREW    = 0x0E, // word addr ->
+    VM_LOADB     = 0x0F, // addr -> byte
+    VM_STOREB    = 0x10, // byte addr ->
+
+    VM_ADD       = 0x11,
+    VM_SUB       = 0x12,
+    VM_MUL       = 0x13,
+    VM_DIV       = 0x14,
+    VM_MOD       = 0x15,
+    VM_NEG       = 0x16,
+    VM_AND       = 0x17,
+    VM_OR        = 0x18,
+    VM_XOR       = 0x19,
+    VM_NOT       = 0x1A,
+    VM_SHL       = 0x1B,
+    VM_SHR       = 0x1C, // Arithmetic
+    VM_ADDI      = 0x1D, // s8
+
+    VM_EQ        = 0x1E,
+    VM_NE        = 0x1F,
+    VM_LT        = 0x20,
+    VM_LE        = 0x21,
+    VM_GT        = 0x22,
+    VM_GE        = 0x23,
+
+    VM_ABS       = 0x24,
+    VM_MIN       = 0x25,
+    VM_MAX       = 0x26,
+
+    VM_JMP       = 0x27, // s16
+    VM_JZ        = 0x28, // s16
+    VM_JNZ       = 0x29, // s16
+    VM_CALL      = 0x2A, // u8 argc, u16 addr
+    VM_RET       = 0x2B,
+    VM_ENTER     = 0x2C, // u8 locals, first in function
+
+    VM_SYS       = 0x2D, // u8 struct API entry
+
+    VM_OPCODES_NUM
+};
+
+//=========================================================
+
+// Header of image loaded to mem, capacity is the whole guest area
+int vm_check(const uint8_t* mem, size_t capacity);
+
+// Bytes taken by image and its globals, image must pass vm_check
+uint32_t vm_footprint(const uint8_t* mem);
+
+// Runs until HALT or RET from top level. Stack and call frames
+// take about 0.4 KB of the caller's stack.
+int vm_run(uint8_t* mem, size_t capacity, struct API* api);
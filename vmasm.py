@@ -0,0 +1,322 @@
+#!/usr/bin/python3
+
+#=========================================================
+
+import argparse
+import re
+import struct
+import sys
+
+#=========================================================
+
+# Bytecode assembler, image format and opcodes are described in vm.h
+#
+#   ; comment
+#   label:
+#   .const  NAME value
+#   .global NAME [words]
+#   .byte   1, 2, 'a'
+#   .word   label, 100000
+#   .ascii  "text"
+#   .align
+#
+#   push <expr>            shortest of push8/16/32, labels take push16
+#   local | setlocal <n>   global | setglobal | gaddr <name>
+#   jmp | jz | jnz <label>
+#   call <label> <argc>    sys <struct API entry>
+#
+# Expressions are Python ones over numbers, labels and constants,
+# e.g. "push text_end - text" or ".const SPEED 2 * 3".
+
+VM_MAGIC = 0x314D5642 # "BVM1"
+
+HEADER_SIZE = 8
+
+# enum Vm_opcode in vm.h: name -> (code, operand formats)
+OPCODES = {
+    'halt':      (0x00, ''),
+    'push8':     (0x01, 'b'),
+    'push16':    (0x02, 'h'),
+    'push32':    (0x03, 'i'),
+    'dup':       (0x04, ''),
+    'drop':      (0x05, ''),
+    'swap':      (0x06, ''),
+    'over':      (0x07, ''),
+
+    'local':     (0x08, 'B'),
+    'setlocal':  (0x09, 'B'),
+    'global':    (0x0A, 'g'),
+    'setglobal': (0x0B, 'g'),
+    'gaddr':     (0x0C, 'g'),
+    'loadw':     (0x0D, ''),
+    'storew':    (0x0E, ''),
+    'loadb':     (0x0F, ''),
+    'storeb':    (0x10, ''),
+
+    'add':       (0x11, ''),
+    'sub':       (0x12, ''),
+    'mul':       (0x13, ''),
+    'div':       (0x14, ''),
+    'mod':       (0x15, ''),
+    'neg':       (0x16, ''),
+    'and':       (0x17, ''),
+    'or':        (0x18, ''),
+    'xor':       (0x19, ''),
+    'not':       (0x1A, ''),
+    'shl':       (0x1B, ''),
+    'shr':       (0x1C, ''),
+    'addi':      (0x1D, 'b'),
+
+    'eq':        (0x1E, ''),
+    'ne':        (0x1F, ''),
+    'lt':        (0x20, ''),
+    'le':        (0x21, ''),
+    'gt':        (0x22, ''),
+    'ge':        (0x23, ''),
+
+    'abs':       (0x24, ''),
+    'min':       (0x25, ''),
+    'max':       (0x26, ''),
+
+    'jmp':       (0x27, 'j'),
+    'jz':        (0x28, 'j'),
+    'jnz':       (0x29, 'j'),
+    'call':      (0x2A, 'c'),
+    'ret':       (0x2B, ''),
+    'enter':     (0x2C, 'B'),
+
+    'sys':       (0x2D, 's'),
+}
+
+# struct API in common/api.h, in order
+API = [
+    'blue_led_on', 'green_led_on', 'blue_led_off', 'green_led_off',
+    'is_button_pressed',
+    'scrn_clear', 'scrn_draw',
+    'scrn_set_pxl', 'scrn_clr_pxl', 'scrn_inv_pxl', 'scrn_putchar', 'scrn_puts',
+    'scrn_xline', 'scrn_yline', 'scrn_box',
+    'kv_read', 'kv_write', 'kv_erase',
+    'set_perf_level', 'idle', 'log_write',
+    'serial_write', 'serial_read',
+    'link_start', 'link_step',
+    'sound_play', 'sound_stop',
+    'asset_size', 'asset_map', 'asset_read',
+    'mem_usage', 'mem_map',
+    'mem_copy', 'mem_fill', 'mem_move',
+    'div_u32', 'div_s32',
+    'frame_run',
+    'scrn_select', 'scrn_draw_all',
+    'probe_now', 'probe_add', 'probe_take',
+]
+
+# Not callable from bytecode, see Sys_args in vm.c
+API_HOST_ONLY = ('log_write', 'scrn_putchar', 'asset_map', 'mem_map', 'div_u32', 'div_s32', 'frame_run')
+
+#=========================================================
+
+class AsmError(Exception):
+    pass
+
+#---------------------------------------------------------
+
+class Assembler:
+    def __init__(self):
+        self.labels = {}
+        self.consts = {}
+        self.globals = {}
+        self.globals_num = 0
+        self.wide = set() # push lines sized before their labels were known
+
+    def value(self, expr, final):
+        names = dict(self.consts)
+        names.update(self.labels)
+
+        try:
+            return int(eval(expr, {'__builtins__': {}}, names))
+        except NameError:
+            if final:
+                raise AsmError("undefined symbol in '%s'" % expr)
+            return None
+        except Exception:
+            raise AsmError("bad expression '%s'" % expr)
+
+    def split_operands(self, text):
+        return [op.strip() for op in re.split(r',(?=(?:[^"\']*["\'][^"\']*["\'])*[^"\']*$)', text) if op.strip()]
+
+    def encode(self, line_no, mnemonic, rest, pc, final):
+        if mnemonic == 'push':
+            value = self.value(rest, final)
+            if value is None or line_no in self.wide:
+                self.wide.add(line_no)
+                mnemonic = 'push16'
+            elif -0x80 <= value < 0x80:
+                mnemonic = 'push8'
+            elif -0x8000 <= value < 0x8000:
+                mnemonic = 'push16'
+            else:
+                mnemonic = 'push32'
+
+        if mnemonic not in OPCODES:
+            raise AsmError("unknown instruction '%s'" % mnemonic)
+
+        code, formats = OPCODES[mnemonic]
+        args = rest.split() if formats in ('c', 's', 'g') else ([rest] if rest else [])
+        out = bytes([code])
+
+        for fmt in formats:
+            if fmt == 'c':
+                if len(args) != 2:
+                    raise AsmError("call takes <label> <argc>")
+
+                target = self.value(args[0], final) or 0
+                argc = self.value(args[1], final) or 0
+                out += struct.pack('<BH', argc, target)
+                continue
+
+            if fmt == 's':
+                if len(args) != 1 or args[0] not in API or args[0] in API_HOST_ONLY:
+                    raise AsmError("unknown API entry '%s'" % rest)
+
+                out += bytes([API.index(args[0])])
+                continue
+
+            if fmt == 'g':
+                if len(args) != 1 or args[0] not in self.globals:
+                    raise AsmError("unknown global '%s'" % rest)
+
+                out += bytes([self.globals[args[0]]])
+                continue
+
+            if not args:
+                raise AsmError("'%s' takes an operand" % mnemonic)
+
+            value = self.value(args[0], final) or 0
+            if fmt == 'j':
+                value -= pc + 3 # Relative to next opcode
+                fmt = 'h'
+
+            try:
+                out += struct.pack('<' + fmt, value)
+            except struct.error:
+                raise AsmError("operand %d out of range for %s" % (value, mnemonic))
+
+        return out
+
+    def directive(self, name, rest, final):
+        if name == '.const':
+            parts = rest.split(None, 1)
+            if len(parts) != 2:
+                raise AsmError(".const takes <name> <value>")
+
+            value = self.value(parts[1], final)
+            if value is not None:
+                self.consts[parts[0]] = value
+            return b''
+
+        if name == '.global':
+            parts = rest.split()
+            if not parts or len(parts) > 2:
+                raise AsmError(".global takes <name> [words]")
+
+            if not final:
+                if self.globals_num > 0xFF:
+                    raise AsmError("global '%s' past slot 255" % parts[0])
+
+                self.globals[parts[0]] = self.globals_num
+                self.globals_num += int(parts[1], 0) if len(parts) == 2 else 1
+            return b''
+
+        if name == '.byte':
+            return bytes((self.value(op, final) or 0) & 0xFF for op in self.split_operands(rest))
+
+        if name == '.word':
+            return b''.join(struct.pack('<I', (self.value(op, final) or 0) & 0xFFFFFFFF)
+                            for op in self.split_operands(rest))
+
+        if name == '.ascii':
+            match = re.fullmatch(r'"((?:[^"\\]|\\.)*)"', rest)
+            if match is None:
+                raise AsmError(".ascii takes a quoted string")
+
+            return match.group(1).encode().decode('unicode_escape').encode('latin-1')
+
+        raise AsmError("unknown directive '%s'" % name)
+
+    def assemble_pass(self, lines, final):
+        out = bytearray()
+
+        for line_no, line in enumerate(lines, 1):
+            # ';' starts a comment unless it is in a string
+            line = re.sub(r';(?=(?:[^"\']*["\'][^"\']*["\'])*[^"\']*$).*', '', line).strip()
+
+            try:
+                while True:
+                    match = re.match(r'([A-Za-z_]\w*):\s*', line)
+                    if match is None:
+                        break
+
+                    label = match.group(1)
+                    if not final and (label in self.labels or label in self.consts):
+                        raise AsmError("'%s' defined twice" % label)
+
+                    self.labels[label] = HEADER_SIZE + len(out)
+                    line = line[match.end():]
+
+                if not line:
+                    continue
+
+                parts = line.split(None, 1)
+                name = parts[0].lower()
+                rest = parts[1].strip() if len(parts) > 1 else ''
+
+                if name == '.align':
+                    out += bytes(-(HEADER_SIZE + len(out)) % 4)
+                elif name.startswith('.'):
+                    out += self.directive(name, rest, final)
+                else:
+                    out += self.encode(line_no, name, rest, HEADER_SIZE + len(out), final)
+
+            except AsmError as err:
+                raise AsmError("line %d: %s" % (line_no, err))
+
+        return out
+
+    def assemble(self, lines):
+        self.assemble_pass(lines, False)
+        self.consts = {}
+        code = self.assemble_pass(lines, True)
+
+        size = HEADER_SIZE + len(code)
+        if size > 0xFFFF or self.globals_num > 0xFFFF:
+            raise AsmError("image too large")
+
+        return struct.pack('<IHH', VM_MAGIC, size, self.globals_num) + bytes(code)
+
+#=========================================================
+
+def main():
+    parser = argparse.ArgumentParser(description="Assemble bytecode guest image (see vm.h)")
+    parser.add_argument('source')
+    parser.add_argument('-o', '--output', default='build/vcode.bin')
+    args = parser.parse_args()
+
+    with open(args.source) as source:
+        lines = source.read().splitlines()
+
+    asm = Assembler()
+
+    try:
+        image = asm.assemble(lines)
+    except AsmError as err:
+        print("%s: %s" % (args.source, err))
+        sys.exit(1)
+
+    with open(args.output, 'wb') as output:
+        output.write(image)
+
+    print("%s: %d bytes, %d global word(s)" % (args.output, len(image), asm.globals_num))
+
+#---------------------------------------------------------
+
+if __name__ == '__main__':
+    main()